@@ -0,0 +1,305 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "Benchmark.h"
+
+namespace cg {
+namespace bench {
+
+BenchmarkState::BenchmarkState(uint64_t iterations) : iterations(iterations) {}
+
+bool BenchmarkState::keepRunning() {
+  if (!this->started) {
+    this->started = true;
+    if (!this->skipReason.empty()) {
+      return false;
+    }
+    resumeTiming();
+    return this->iterations > 0;
+  }
+
+  this->completed++;
+  if (this->completed < this->iterations) {
+    return true;
+  }
+
+  pauseTiming();
+  return false;
+}
+
+void BenchmarkState::pauseTiming() {
+  if (this->running) {
+    this->elapsed += Clock::now() - this->resumed;
+    this->running = false;
+  }
+}
+
+void BenchmarkState::resumeTiming() {
+  if (!this->running) {
+    this->resumed = Clock::now();
+    this->running = true;
+  }
+}
+
+uint64_t BenchmarkState::getIterations() const {
+  return this->iterations;
+}
+
+double BenchmarkState::getSeconds() const {
+  return std::chrono::duration<double>(this->elapsed).count();
+}
+
+void BenchmarkState::setItemsProcessed(uint64_t items) {
+  this->itemsProcessed = items;
+}
+
+void BenchmarkState::setBytesProcessed(uint64_t bytes) {
+  this->bytesProcessed = bytes;
+}
+
+void BenchmarkState::setCounter(const std::string &name, double value) {
+  this->counters[name] = value;
+}
+
+void BenchmarkState::skip(const std::string &reason) {
+  this->skipReason = reason;
+}
+
+uint64_t BenchmarkState::getItemsProcessed() const {
+  return this->itemsProcessed;
+}
+
+uint64_t BenchmarkState::getBytesProcessed() const {
+  return this->bytesProcessed;
+}
+
+const std::map<std::string, double> &BenchmarkState::getCounters() const {
+  return this->counters;
+}
+
+const std::string &BenchmarkState::getSkipReason() const {
+  return this->skipReason;
+}
+
+void BenchmarkRegistry::add(const std::string &name, const BenchmarkFunction &function, uint64_t fixedIterations) {
+  this->entries.push_back({name, function, fixedIterations});
+}
+
+std::vector<std::string> BenchmarkRegistry::getNames() const {
+  std::vector<std::string> names;
+  for (const Entry &entry : this->entries) {
+    names.push_back(entry.name);
+  }
+  return names;
+}
+
+static std::string FormatTime(double nanoseconds) {
+  char text[32];
+  if (nanoseconds < 1e3) {
+    snprintf(text, sizeof(text), "%.1f ns", nanoseconds);
+  } else if (nanoseconds < 1e6) {
+    snprintf(text, sizeof(text), "%.2f us", nanoseconds / 1e3);
+  } else if (nanoseconds < 1e9) {
+    snprintf(text, sizeof(text), "%.2f ms", nanoseconds / 1e6);
+  } else {
+    snprintf(text, sizeof(text), "%.2f s", nanoseconds / 1e9);
+  }
+  return text;
+}
+
+std::vector<BenchmarkResult> BenchmarkRegistry::run(const BenchmarkSettings &settings) {
+  std::vector<BenchmarkResult> results;
+
+  for (const Entry &entry : this->entries) {
+    if (!settings.filter.empty() && entry.name.find(settings.filter) == std::string::npos) {
+      continue;
+    }
+
+    BenchmarkResult result;
+    result.name = entry.name;
+
+    // Grow the iteration count until a single run is long enough to time reliably
+    uint64_t iterations = entry.fixedIterations > 0 ? entry.fixedIterations : 1;
+    while (entry.fixedIterations == 0) {
+      BenchmarkState state(iterations);
+      entry.function(state);
+      if (!state.getSkipReason().empty()) {
+        result.skipped = true;
+        result.skipReason = state.getSkipReason();
+        break;
+      }
+
+      double seconds = state.getSeconds();
+      if (seconds >= settings.minSeconds || iterations >= (1ull << 32)) {
+        break;
+      }
+
+      double scale = seconds > 0.0 ? settings.minSeconds * 1.4 / seconds : 10.0;
+      iterations = static_cast<uint64_t>(std::ceil(iterations * std::min(std::max(scale, 2.0), 10.0)));
+    }
+
+    if (result.skipped) {
+      printf("%-48s skipped: %s\n", entry.name.c_str(), result.skipReason.c_str());
+      results.push_back(result);
+      continue;
+    }
+
+    std::vector<double> times;
+    for (int repetition = 0; repetition < std::max(settings.repetitions, 1); repetition++) {
+      BenchmarkState state(iterations);
+      entry.function(state);
+      if (!state.getSkipReason().empty()) {
+        result.skipped = true;
+        result.skipReason = state.getSkipReason();
+        break;
+      }
+
+      double seconds = state.getSeconds();
+      times.push_back(seconds * 1e9 / iterations);
+      if (seconds > 0.0) {
+        result.itemsPerSecond = state.getItemsProcessed() / seconds;
+        result.bytesPerSecond = state.getBytesProcessed() / seconds;
+      }
+      result.counters = state.getCounters();
+    }
+
+    if (result.skipped) {
+      printf("%-48s skipped: %s\n", entry.name.c_str(), result.skipReason.c_str());
+      results.push_back(result);
+      continue;
+    }
+
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double time : times) {
+      sum += time;
+    }
+
+    result.iterations = iterations;
+    result.repetitions = static_cast<int>(times.size());
+    result.mean = sum / times.size();
+    result.median = sorted.size() % 2 == 1 ? sorted[sorted.size() / 2]
+                                           : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2.0;
+    result.min = sorted.front();
+    result.max = sorted.back();
+    double variance = 0.0;
+    for (double time : times) {
+      variance += (time - result.mean) * (time - result.mean);
+    }
+    result.stddev = times.size() > 1 ? std::sqrt(variance / (times.size() - 1)) : 0.0;
+
+    printf("%-48s %12s  +-%5.1f%%  %10llu it", entry.name.c_str(), FormatTime(result.median).c_str(),
+           result.mean > 0.0 ? result.stddev / result.mean * 100.0 : 0.0,
+           static_cast<unsigned long long>(iterations));
+    if (result.itemsPerSecond > 0.0) {
+      printf("  %10.3f M items/s", result.itemsPerSecond / 1e6);
+    }
+    printf("\n");
+    results.push_back(result);
+  }
+
+  return results;
+}
+
+static void WriteJsonString(std::ofstream &stream, const std::string &value) {
+  stream << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      stream << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      stream << escaped;
+    } else {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+
+bool BenchmarkRegistry::WriteJson(const std::string &path, const std::map<std::string, std::string> &context,
+                                  const std::vector<BenchmarkResult> &results) {
+  std::ofstream stream(path, std::ios::out | std::ios::trunc);
+  if (!stream.is_open()) {
+    fprintf(stderr, "Error: could not open result file '%s'\n", path.c_str());
+    return false;
+  }
+
+  stream.precision(17);
+  stream << "{\n  \"context\": {";
+  bool first = true;
+  for (const auto &entry : context) {
+    stream << (first ? "\n    " : ",\n    ");
+    WriteJsonString(stream, entry.first);
+    stream << ": ";
+    WriteJsonString(stream, entry.second);
+    first = false;
+  }
+  stream << "\n  },\n  \"benchmarks\": [";
+
+  first = true;
+  for (const BenchmarkResult &result : results) {
+    stream << (first ? "\n    {" : ",\n    {") << "\"name\": ";
+    WriteJsonString(stream, result.name);
+    if (result.skipped) {
+      stream << ", \"skipped\": true, \"reason\": ";
+      WriteJsonString(stream, result.skipReason);
+    } else {
+      stream << ", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+             << ", \"time_unit\": \"ns\", \"mean\": " << result.mean << ", \"median\": " << result.median
+             << ", \"stddev\": " << result.stddev << ", \"min\": " << result.min << ", \"max\": " << result.max;
+      if (result.itemsPerSecond > 0.0) {
+        stream << ", \"items_per_second\": " << result.itemsPerSecond;
+      }
+      if (result.bytesPerSecond > 0.0) {
+        stream << ", \"bytes_per_second\": " << result.bytesPerSecond;
+      }
+      if (!result.counters.empty()) {
+        stream << ", \"counters\": {";
+        bool firstCounter = true;
+        for (const auto &counter : result.counters) {
+          stream << (firstCounter ? "" : ", ");
+          WriteJsonString(stream, counter.first);
+          stream << ": " << counter.second;
+          firstCounter = false;
+        }
+        stream << "}";
+      }
+    }
+    stream << "}";
+    first = false;
+  }
+  stream << "\n  ]\n}\n";
+
+  return stream.good();
+}
+
+}
+}
@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_BENCH_BENCHMARK_H_
+#define RENDOR_BENCH_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cg {
+namespace bench {
+
+/// BenchmarkState - Drives the timed loop of one benchmark run.
+///
+///   void BenchmarkFoo(BenchmarkState &state) {
+///     Setup setup;                  // not timed
+///     while (state.keepRunning()) {
+///       foo(setup);                 // timed, repeated until the run is long enough
+///     }
+///     state.setItemsProcessed(state.getIterations() * setup.size());
+///   }
+class BenchmarkState {
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  uint64_t iterations;
+  uint64_t completed = 0;
+  bool started = false;
+  bool running = false;
+  Clock::time_point resumed;
+  Clock::duration elapsed = Clock::duration::zero();
+
+  uint64_t itemsProcessed = 0;
+  uint64_t bytesProcessed = 0;
+  std::map<std::string, double> counters;
+  std::string skipReason;
+
+ public:
+  explicit BenchmarkState(uint64_t iterations);
+
+  /// \return true while another iteration has to run, times everything between the first and the last call
+  bool keepRunning();
+
+  /// Excludes per-iteration setup (e.g. restoring a buffer an iteration modified) from the measurement.
+  void pauseTiming();
+  void resumeTiming();
+
+  uint64_t getIterations() const;
+  double getSeconds() const;
+
+  void setItemsProcessed(uint64_t items);
+  void setBytesProcessed(uint64_t bytes);
+  /// Records a value that is reported as is, e.g. the ACMR after an optimization.
+  void setCounter(const std::string &name, double value);
+
+  /// Skips the benchmark, e.g. when it needs an OpenGL context that could not be created.
+  void skip(const std::string &reason);
+
+  uint64_t getItemsProcessed() const;
+  uint64_t getBytesProcessed() const;
+  const std::map<std::string, double> &getCounters() const;
+  const std::string &getSkipReason() const;
+};
+
+typedef std::function<void(BenchmarkState &)> BenchmarkFunction;
+
+/// BenchmarkResult - Statistics over the repetitions of one benchmark, times per iteration in nanoseconds.
+struct BenchmarkResult {
+  std::string name;
+  uint64_t iterations = 0;
+  int repetitions = 0;
+  double mean = 0.0;
+  double median = 0.0;
+  double stddev = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+  double itemsPerSecond = 0.0;
+  double bytesPerSecond = 0.0;
+  std::map<std::string, double> counters;
+  bool skipped = false;
+  std::string skipReason;
+};
+
+struct BenchmarkSettings {
+  /// Each repetition runs at least this long, the iteration count is grown until it does.
+  double minSeconds = 0.25;
+  int repetitions = 5;
+  /// Only benchmarks whose name contains this string run.
+  std::string filter;
+};
+
+/// BenchmarkRegistry - Registered benchmarks, run in registration order.
+class BenchmarkRegistry {
+ private:
+  struct Entry {
+    std::string name;
+    BenchmarkFunction function;
+    uint64_t fixedIterations;
+  };
+
+  std::vector<Entry> entries;
+
+ public:
+  /// Registers a benchmark. Names are paths like "meshopt/vertex_cache/1000".
+  /// \param fixedIterations runs exactly this many iterations per repetition instead of calibrating, for
+  /// benchmarks that take seconds per iteration
+  void add(const std::string &name, const BenchmarkFunction &function, uint64_t fixedIterations = 0);
+
+  /// Runs every benchmark matching the filter and prints one line per benchmark.
+  std::vector<BenchmarkResult> run(const BenchmarkSettings &settings);
+
+  /// Lists the registered names.
+  std::vector<std::string> getNames() const;
+
+  /// Writes the results as JSON, together with free-form context (machine, renderer, build).
+  /// \return true if the file was written
+  static bool WriteJson(const std::string &path, const std::map<std::string, std::string> &context,
+                        const std::vector<BenchmarkResult> &results);
+};
+
+/// Keeps the compiler from optimizing away a computation whose result is otherwise unused.
+template<typename T>
+inline void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+}
+}
+
+#endif //RENDOR_BENCH_BENCHMARK_H_
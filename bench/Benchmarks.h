@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_BENCH_BENCHMARKS_H_
+#define RENDOR_BENCH_BENCHMARKS_H_
+
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace cg {
+namespace bench {
+
+/// Mesh sizes (in triangles) the mesh benchmarks run at, capped by --max-triangles.
+std::vector<size_t> GetMeshSizes(size_t maxTriangles);
+
+void RegisterImportBenchmarks(BenchmarkRegistry &registry, size_t maxTriangles);
+void RegisterMeshoptBenchmarks(BenchmarkRegistry &registry, size_t maxTriangles);
+void RegisterUniformBenchmarks(BenchmarkRegistry &registry);
+void RegisterMathBenchmarks(BenchmarkRegistry &registry);
+void RegisterJobBenchmarks(BenchmarkRegistry &registry);
+void RegisterTransformBenchmarks(BenchmarkRegistry &registry);
+
+/// Creates the headless OpenGL context on first use and skips the benchmark if that fails.
+/// \return true if a context is current
+bool RequireGLContext(BenchmarkState &state);
+
+/// Gets GL_RENDERER and GL_VERSION of the benchmark context, empty if no GL benchmark ran.
+std::string GetGLDescription();
+
+}
+}
+
+#endif //RENDOR_BENCH_BENCHMARKS_H_
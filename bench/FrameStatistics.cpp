@@ -0,0 +1,257 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "FrameStatistics.h"
+
+namespace cg {
+namespace bench {
+
+double Percentile(std::vector<double> sorted, double percentile) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+
+  std::sort(sorted.begin(), sorted.end());
+  double rank = percentile / 100.0 * (sorted.size() - 1);
+  size_t lower = static_cast<size_t>(std::floor(rank));
+  size_t upper = std::min(lower + 1, sorted.size() - 1);
+  double fraction = rank - lower;
+  return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+FrameSummary Summarize(const std::vector<double> &times) {
+  FrameSummary summary;
+  if (times.empty()) {
+    return summary;
+  }
+
+  double sum = 0.0;
+  for (double time : times) {
+    sum += time;
+  }
+  summary.mean = sum / times.size();
+  summary.p50 = Percentile(times, 50.0);
+  summary.p95 = Percentile(times, 95.0);
+  summary.p99 = Percentile(times, 99.0);
+  summary.worst = *std::max_element(times.begin(), times.end());
+  return summary;
+}
+
+double MannWhitneyPValue(const std::vector<double> &first, const std::vector<double> &second) {
+  size_t n1 = first.size();
+  size_t n2 = second.size();
+  if (n1 == 0 || n2 == 0) {
+    return 1.0;
+  }
+
+  struct Sample {
+    double value;
+    bool fromFirst;
+  };
+  std::vector<Sample> samples;
+  samples.reserve(n1 + n2);
+  for (double value : first) samples.push_back({value, true});
+  for (double value : second) samples.push_back({value, false});
+  std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) { return a.value < b.value; });
+
+  // Tied values share their average rank
+  double rankSumFirst = 0.0;
+  double tieCorrection = 0.0;
+  for (size_t i = 0; i < samples.size();) {
+    size_t j = i;
+    while (j < samples.size() && samples[j].value == samples[i].value) {
+      j++;
+    }
+    double rank = (i + 1 + j) / 2.0;
+    for (size_t k = i; k < j; k++) {
+      if (samples[k].fromFirst) rankSumFirst += rank;
+    }
+    double ties = static_cast<double>(j - i);
+    tieCorrection += ties * ties * ties - ties;
+    i = j;
+  }
+
+  double u = rankSumFirst - n1 * (n1 + 1) / 2.0;
+  double n = static_cast<double>(n1 + n2);
+  double mean = n1 * n2 / 2.0;
+  double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+  if (variance <= 0.0) {
+    return 1.0;
+  }
+
+  double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+  return std::erfc(std::max(z, 0.0) / std::sqrt(2.0));
+}
+
+static void WriteArray(std::ofstream &stream, const std::vector<double> &values) {
+  stream << "[";
+  for (size_t i = 0; i < values.size(); i++) {
+    stream << (i % 16 == 0 ? "\n    " : " ") << values[i] << (i + 1 < values.size() ? "," : "");
+  }
+  stream << "\n  ]";
+}
+
+static void WriteSummary(std::ofstream &stream, const FrameSummary &summary) {
+  stream << "{\"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95
+         << ", \"p99\": " << summary.p99 << ", \"worst\": " << summary.worst << "}";
+}
+
+bool WriteFlythroughJson(const std::string &path, const FlythroughResult &result) {
+  std::ofstream stream(path, std::ios::out | std::ios::trunc);
+  if (!stream.is_open()) {
+    fprintf(stderr, "Error: could not open result file '%s'\n", path.c_str());
+    return false;
+  }
+
+  stream.precision(6);
+  stream << std::fixed << "{\n  \"context\": {";
+  bool first = true;
+  for (const auto &entry : result.context) {
+    // Context values are plain identifiers and numbers, quotes and backslashes are dropped
+    std::string value;
+    for (char c : entry.second) {
+      if (c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20) value += c;
+    }
+    stream << (first ? "\n    \"" : ",\n    \"") << entry.first << "\": \"" << value << "\"";
+    first = false;
+  }
+  stream << "\n  },\n";
+  stream << "  \"frames\": " << result.cpuTimes.size() << ",\n";
+  stream << "  \"draw_calls\": " << result.drawCalls << ",\n";
+  stream << "  \"triangles\": " << result.triangles << ",\n";
+  stream << "  \"cpu\": ";
+  WriteSummary(stream, Summarize(result.cpuTimes));
+  stream << ",\n  \"gpu\": ";
+  WriteSummary(stream, Summarize(result.gpuTimes));
+  stream << ",\n  \"cpu_times\": ";
+  WriteArray(stream, result.cpuTimes);
+  stream << ",\n  \"gpu_times\": ";
+  WriteArray(stream, result.gpuTimes);
+  stream << "\n}\n";
+
+  return stream.good();
+}
+
+/// Finds "key": in the text and returns the position after the colon, std::string::npos if missing.
+static size_t FindKey(const std::string &text, const std::string &key) {
+  size_t position = text.find("\"" + key + "\"");
+  if (position == std::string::npos) {
+    return position;
+  }
+  position = text.find(':', position + key.size() + 2);
+  return position == std::string::npos ? position : position + 1;
+}
+
+static bool ReadNumber(const std::string &text, const std::string &key, double &value) {
+  size_t position = FindKey(text, key);
+  if (position == std::string::npos) {
+    return false;
+  }
+  value = std::strtod(text.c_str() + position, nullptr);
+  return true;
+}
+
+static bool ReadArray(const std::string &text, const std::string &key, std::vector<double> &values) {
+  size_t position = FindKey(text, key);
+  if (position == std::string::npos) {
+    return false;
+  }
+  size_t begin = text.find('[', position);
+  size_t end = text.find(']', begin);
+  if (begin == std::string::npos || end == std::string::npos) {
+    return false;
+  }
+
+  values.clear();
+  std::string list = text.substr(begin + 1, end - begin - 1);
+  std::replace(list.begin(), list.end(), ',', ' ');
+  std::istringstream stream(list);
+  double value;
+  while (stream >> value) {
+    values.push_back(value);
+  }
+  return true;
+}
+
+bool ReadFlythroughJson(const std::string &path, FlythroughResult &result) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    fprintf(stderr, "Error: could not open result file '%s'\n", path.c_str());
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  if (!ReadArray(text, "cpu_times", result.cpuTimes) || !ReadArray(text, "gpu_times", result.gpuTimes)) {
+    fprintf(stderr, "Error: '%s' is not a flythrough result\n", path.c_str());
+    return false;
+  }
+  ReadNumber(text, "draw_calls", result.drawCalls);
+  ReadNumber(text, "triangles", result.triangles);
+  return true;
+}
+
+static bool CompareMetric(const char *name, const std::vector<double> &baseline, const std::vector<double> &candidate,
+                          double threshold, double significance) {
+  if (baseline.empty() || candidate.empty()) {
+    printf("%-4s  no samples\n", name);
+    return false;
+  }
+
+  FrameSummary before = Summarize(baseline);
+  FrameSummary after = Summarize(candidate);
+  double change = before.p50 > 0.0 ? (after.p50 - before.p50) / before.p50 : 0.0;
+  double p = MannWhitneyPValue(baseline, candidate);
+  bool significant = p < significance;
+  bool regressed = significant && change > threshold;
+  bool improved = significant && change < -threshold;
+
+  printf("%-4s  p50 %8.3f -> %8.3f ms (%+6.2f%%)  p95 %8.3f -> %8.3f  p99 %8.3f -> %8.3f  p=%.4f  %s\n", name,
+         before.p50, after.p50, change * 100.0, before.p95, after.p95, before.p99, after.p99, p,
+         regressed ? "REGRESSION" : improved ? "improved" : "no significant change");
+  return regressed;
+}
+
+bool CompareFlythroughs(const FlythroughResult &baseline, const FlythroughResult &candidate, double threshold,
+                        double significance) {
+  bool regressed = CompareMetric("CPU", baseline.cpuTimes, candidate.cpuTimes, threshold, significance);
+  regressed |= CompareMetric("GPU", baseline.gpuTimes, candidate.gpuTimes, threshold, significance);
+
+  if (baseline.drawCalls != candidate.drawCalls || baseline.triangles != candidate.triangles) {
+    printf("Warning: the runs drew different scenes (%.0f -> %.0f draw calls, %.0f -> %.0f triangles)\n",
+           baseline.drawCalls, candidate.drawCalls, baseline.triangles, candidate.triangles);
+  }
+  return regressed;
+}
+
+}
+}
@@ -0,0 +1,78 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_BENCH_FRAMESTATISTICS_H_
+#define RENDOR_BENCH_FRAMESTATISTICS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cg {
+namespace bench {
+
+/// FrameSummary - Distribution of per-frame times in milliseconds.
+struct FrameSummary {
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double worst = 0.0;
+};
+
+/// FlythroughResult - Everything one flythrough run records, as written to and read from its JSON file.
+struct FlythroughResult {
+  std::map<std::string, std::string> context;
+  std::vector<double> cpuTimes;
+  std::vector<double> gpuTimes;
+  double drawCalls = 0.0;
+  double triangles = 0.0;
+};
+
+/// Gets the percentile (0..100) with linear interpolation between the closest ranks.
+double Percentile(std::vector<double> sorted, double percentile);
+
+FrameSummary Summarize(const std::vector<double> &times);
+
+/// Two-sided Mann-Whitney U test, which does not assume normally distributed frame times.
+/// \return the p-value of both samples coming from the same distribution (normal approximation with tie correction)
+double MannWhitneyPValue(const std::vector<double> &first, const std::vector<double> &second);
+
+/// \return true if the file was written
+bool WriteFlythroughJson(const std::string &path, const FlythroughResult &result);
+
+/// Reads a file written by WriteFlythroughJson, this is not a general JSON parser.
+/// \return true if the file was read
+bool ReadFlythroughJson(const std::string &path, FlythroughResult &result);
+
+/// Compares two runs and prints a table. A metric regresses when its median got slower by more than the threshold
+/// (relative, e.g. 0.02 for 2%) and the difference is significant at the given level.
+/// \return true if any metric regressed
+bool CompareFlythroughs(const FlythroughResult &baseline, const FlythroughResult &candidate, double threshold,
+                        double significance);
+
+}
+}
+
+#endif //RENDOR_BENCH_FRAMESTATISTICS_H_
@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+
+#include "cg/InfoImporter.h"
+#include "Benchmarks.h"
+#include "SyntheticMesh.h"
+
+namespace cg {
+namespace bench {
+
+// Import is orders of magnitude slower than the mesh processing, larger files would dominate the run
+static const size_t kMaxImportTriangles = 1000000;
+
+static std::string GetObjPath(size_t triangles) {
+  static std::map<size_t, std::string> written;
+  auto found = written.find(triangles);
+  if (found != written.end()) {
+    return found->second;
+  }
+
+  std::string path = "rendor_bench_" + std::to_string(triangles) + ".obj";
+  if (!WriteObj(path, GenerateGrid(triangles))) {
+    return "";
+  }
+  written[triangles] = path;
+  return path;
+}
+
+static void BenchmarkAssimpImport(BenchmarkState &state, size_t triangles, unsigned int flags) {
+  std::string path = GetObjPath(triangles);
+  if (path.empty()) {
+    state.skip("could not write the test mesh");
+    return;
+  }
+
+  Assimp::Importer importer;
+  while (state.keepRunning()) {
+    const aiScene *scene = importer.ReadFile(path, flags);
+    DoNotOptimize(scene);
+
+    state.pauseTiming();
+    importer.FreeScene();
+    state.resumeTiming();
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+}
+
+static void BenchmarkConvertMesh(BenchmarkState &state, size_t triangles) {
+  std::string path = GetObjPath(triangles);
+  if (path.empty()) {
+    state.skip("could not write the test mesh");
+    return;
+  }
+
+  Assimp::Importer importer;
+  const aiScene *scene = importer.ReadFile(path, AsyncInfoImporter::GetImportFlags());
+  if (scene == nullptr || scene->mNumMeshes == 0) {
+    state.skip(std::string("import failed: ") + importer.GetErrorString());
+    return;
+  }
+
+  std::vector<cg::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  while (state.keepRunning()) {
+    AsyncInfoImporter::ConvertMesh(scene->mMeshes[0], vertices, indices);
+    DoNotOptimize(vertices.data());
+    DoNotOptimize(indices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+  state.setBytesProcessed(state.getIterations() * (vertices.size() * sizeof(cg::Vertex)
+      + indices.size() * sizeof(unsigned int)));
+}
+
+void RegisterImportBenchmarks(BenchmarkRegistry &registry, size_t maxTriangles) {
+  for (size_t triangles : GetMeshSizes(std::min(maxTriangles, kMaxImportTriangles))) {
+    std::string suffix = "/" + std::to_string(triangles);
+    registry.add("import/assimp" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkAssimpImport(state, triangles, AsyncInfoImporter::GetImportFlags());
+    });
+    // The import used to weld in Assimp as well as after conversion, this is what that step cost
+    registry.add("import/assimp_join_vertices" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkAssimpImport(state, triangles, AsyncInfoImporter::GetImportFlags() | aiProcess_JoinIdenticalVertices);
+    });
+    registry.add("import/convert" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkConvertMesh(state, triangles);
+    });
+  }
+}
+
+}
+}
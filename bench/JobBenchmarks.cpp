@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "cg/JobSystem.h"
+#include "Benchmarks.h"
+
+namespace cg {
+namespace bench {
+
+static const size_t kJobs = 1024;
+static const size_t kElements = 1 << 20;
+
+/// Overhead of starting and waiting for empty jobs.
+static void BenchmarkEmptyJobs(BenchmarkState &state) {
+  JobSystem &jobs = JobSystem::Get();
+  while (state.keepRunning()) {
+    JobCounter counter;
+    for (size_t i = 0; i < kJobs; i++) {
+      jobs.run([]() {}, &counter);
+    }
+    jobs.wait(counter);
+  }
+  state.setItemsProcessed(state.getIterations() * kJobs);
+  state.setCounter("threads", jobs.getThreadCount());
+}
+
+/// A chain of jobs that each start once the previous finished, the latency of a dependency.
+static void BenchmarkDependencyChain(BenchmarkState &state) {
+  JobSystem &jobs = JobSystem::Get();
+  while (state.keepRunning()) {
+    JobCounter counters[64];
+    jobs.run([]() {}, &counters[0]);
+    for (size_t i = 1; i < 64; i++) {
+      jobs.runAfter(counters[i - 1], []() {}, &counters[i]);
+    }
+    jobs.wait(counters[63]);
+  }
+  state.setItemsProcessed(state.getIterations() * 64);
+}
+
+static void Transform(std::vector<float> &values, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    values[i] = std::sqrt(values[i] * 1.5f + 1.0f);
+  }
+}
+
+/// Baseline for parallel_for: the same loop on one thread.
+static void BenchmarkSerialFor(BenchmarkState &state) {
+  std::vector<float> values(kElements, 1.0f);
+  while (state.keepRunning()) {
+    Transform(values, 0, values.size());
+    DoNotOptimize(values.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kElements);
+}
+
+static void BenchmarkParallelFor(BenchmarkState &state) {
+  JobSystem &jobs = JobSystem::Get();
+  std::vector<float> values(kElements, 1.0f);
+  while (state.keepRunning()) {
+    jobs.parallelFor(values.size(), 4096, [&values](size_t begin, size_t end) { Transform(values, begin, end); });
+    DoNotOptimize(values.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kElements);
+  state.setCounter("threads", jobs.getThreadCount());
+}
+
+void RegisterJobBenchmarks(BenchmarkRegistry &registry) {
+  registry.add("jobs/empty", BenchmarkEmptyJobs);
+  registry.add("jobs/dependency_chain", BenchmarkDependencyChain);
+  registry.add("jobs/serial_for", BenchmarkSerialFor);
+  registry.add("jobs/parallel_for", BenchmarkParallelFor);
+}
+
+}
+}
@@ -0,0 +1,204 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "cg/Camera.h"
+#include "Benchmarks.h"
+
+namespace cg {
+namespace bench {
+
+// Every iteration processes a batch, so the loop overhead does not dominate single matrix operations
+static const size_t kBatch = 1024;
+
+struct TransformInput {
+  glm::vec3 position;
+  glm::vec3 angles;
+  glm::vec3 scale;
+};
+
+static std::vector<TransformInput> GenerateTransforms() {
+  std::vector<TransformInput> transforms(kBatch);
+  for (size_t i = 0; i < kBatch; i++) {
+    float f = static_cast<float>(i);
+    transforms[i].position = glm::vec3(f * 0.5f, f * 0.25f - 10.0f, -f);
+    transforms[i].angles = glm::vec3(f * 0.3f, f * 0.7f, f * 0.1f);
+    transforms[i].scale = glm::vec3(1.0f + f * 0.001f);
+  }
+  return transforms;
+}
+
+/// A local transform matrix the straightforward way: translation * rotation * scale.
+static void BenchmarkModelMatrix(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  std::vector<glm::quat> rotations(kBatch);
+  for (size_t i = 0; i < kBatch; i++) {
+    rotations[i] = glm::quat(glm::radians(transforms[i].angles));
+  }
+
+  std::vector<glm::mat4> matrices(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      matrices[i] = glm::translate(transforms[i].position) * glm::mat4_cast(rotations[i])
+          * glm::scale(transforms[i].scale);
+    }
+    DoNotOptimize(matrices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// Euler angles to a quaternion, as editor rotation fields need.
+static void BenchmarkEulerToQuat(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  std::vector<glm::quat> rotations(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      rotations[i] = glm::normalize(glm::quat(glm::radians(transforms[i].angles)));
+    }
+    DoNotOptimize(rotations.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// What the old demo camera did on every update: view, general inverse of the view and view-projection.
+static void BenchmarkCameraUpdate(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  glm::vec3 forward(0.0f, 0.0f, -1.0f);
+  glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+  std::vector<glm::mat4> viewProjections(kBatch);
+  std::vector<glm::mat4> inverseViews(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      glm::mat4 view = glm::lookAt(transforms[i].position, transforms[i].position + forward, up);
+      inverseViews[i] = glm::inverse(view);
+      viewProjections[i] = projection * view;
+    }
+    DoNotOptimize(viewProjections.data());
+    DoNotOptimize(inverseViews.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// The same through cg::Camera, which inverts the rigid view transform directly.
+static void BenchmarkCameraMoving(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  Camera camera = Camera::Perspective(45.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+  std::vector<glm::mat4> viewProjections(kBatch);
+  std::vector<glm::mat4> inverseViews(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      camera.setPosition(transforms[i].position);
+      inverseViews[i] = camera.getInverseViewMatrix();
+      viewProjections[i] = camera.getViewProjectionMatrix();
+    }
+    DoNotOptimize(viewProjections.data());
+    DoNotOptimize(inverseViews.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// A camera that did not move returns its cached matrices and frustum.
+static void BenchmarkCameraStill(BenchmarkState &state) {
+  Camera camera = Camera::Perspective(45.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+  camera.setPosition(glm::vec3(0.0f, 9.0f, 15.0f));
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      DoNotOptimize(&camera.getViewProjectionMatrix());
+      DoNotOptimize(&camera.getFrustum());
+    }
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// Bounding boxes against the cached frustum, as culling would.
+static void BenchmarkFrustumCull(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  Camera camera = Camera::Perspective(45.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+  camera.setPosition(glm::vec3(0.0f, 9.0f, 15.0f));
+  camera.lookAt(glm::vec3(0.0f));
+  const Frustum &frustum = camera.getFrustum();
+
+  size_t visible = 0;
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      glm::vec3 center = transforms[i].position;
+      visible += frustum.intersectsBox(center - glm::vec3(1.0f), center + glm::vec3(1.0f)) ? 1 : 0;
+    }
+    DoNotOptimize(&visible);
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+static void BenchmarkPerspective(BenchmarkState &state) {
+  std::vector<glm::mat4> projections(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      projections[i] = glm::perspective(glm::radians(30.0f + i * 0.01f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    }
+    DoNotOptimize(projections.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+/// Mesh::draw of the demo: model-view-projection per draw.
+static void BenchmarkModelViewProjection(BenchmarkState &state) {
+  std::vector<TransformInput> transforms = GenerateTransforms();
+  std::vector<glm::mat4> models(kBatch);
+  for (size_t i = 0; i < kBatch; i++) {
+    models[i] = glm::translate(transforms[i].position);
+  }
+  glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f)
+      * glm::lookAt(glm::vec3(0.0f, 9.0f, 15.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+  std::vector<glm::mat4> mvps(kBatch);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < kBatch; i++) {
+      mvps[i] = viewProjection * models[i];
+    }
+    DoNotOptimize(mvps.data());
+  }
+  state.setItemsProcessed(state.getIterations() * kBatch);
+}
+
+void RegisterMathBenchmarks(BenchmarkRegistry &registry) {
+  registry.add("math/model_matrix", BenchmarkModelMatrix);
+  registry.add("math/euler_to_quat", BenchmarkEulerToQuat);
+  registry.add("math/camera_update", BenchmarkCameraUpdate);
+  registry.add("math/camera_moving", BenchmarkCameraMoving);
+  registry.add("math/camera_still", BenchmarkCameraStill);
+  registry.add("math/frustum_cull", BenchmarkFrustumCull);
+  registry.add("math/perspective", BenchmarkPerspective);
+  registry.add("math/model_view_projection", BenchmarkModelViewProjection);
+}
+
+}
+}
@@ -0,0 +1,243 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <meshoptimizer.h>
+#include <memory>
+
+#include "cg/InfoImporter.h"
+#include "cg/VertexWelder.h"
+#include "Benchmarks.h"
+#include "SyntheticMesh.h"
+
+namespace cg {
+namespace bench {
+
+/// Test meshes of the size that is currently being benchmarked. Only one size is kept, the 10M triangle meshes take
+/// gigabytes.
+struct MeshSet {
+  size_t triangles = 0;
+  SyntheticMesh welded;
+  SyntheticMesh unwelded;
+  std::vector<unsigned int> cacheOptimized;
+};
+
+static const MeshSet &GetMeshSet(size_t triangles) {
+  static std::unique_ptr<MeshSet> current;
+  if (!current || current->triangles != triangles) {
+    current.reset();
+    current.reset(new MeshSet());
+    current->triangles = triangles;
+    current->welded = GenerateGrid(triangles);
+    current->unwelded = Unweld(current->welded);
+
+    const SyntheticMesh &mesh = current->welded;
+    current->cacheOptimized.resize(mesh.indices.size());
+    meshopt_optimizeVertexCache(current->cacheOptimized.data(), mesh.indices.data(), mesh.indices.size(),
+                                mesh.vertices.size());
+  }
+  return *current;
+}
+
+static void BenchmarkGenerateRemap(BenchmarkState &state, size_t triangles) {
+  const SyntheticMesh &mesh = GetMeshSet(triangles).unwelded;
+  std::vector<unsigned int> remap(mesh.indices.size());
+  size_t unique = 0;
+  while (state.keepRunning()) {
+    unique = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                         mesh.vertices.data(), mesh.vertices.size(), sizeof(cg::Vertex));
+    DoNotOptimize(unique);
+  }
+  state.setItemsProcessed(state.getIterations() * mesh.indices.size());
+  state.setCounter("unique_vertices", static_cast<double>(unique));
+}
+
+static void BenchmarkRemapBuffers(BenchmarkState &state, size_t triangles) {
+  const SyntheticMesh &mesh = GetMeshSet(triangles).unwelded;
+  std::vector<unsigned int> remap(mesh.indices.size());
+  size_t unique = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                              mesh.vertices.data(), mesh.vertices.size(), sizeof(cg::Vertex));
+
+  std::vector<unsigned int> indices(mesh.indices.size());
+  std::vector<cg::Vertex> vertices(unique);
+  while (state.keepRunning()) {
+    meshopt_remapIndexBuffer(indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+    meshopt_remapVertexBuffer(vertices.data(), mesh.vertices.data(), mesh.vertices.size(), sizeof(cg::Vertex),
+                              remap.data());
+    DoNotOptimize(indices.data());
+    DoNotOptimize(vertices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * mesh.indices.size());
+}
+
+/// WeldVertices replaces generate_remap plus the vertex half of remap_buffers, compare it against their sum.
+static void BenchmarkWeldVertices(BenchmarkState &state, size_t triangles, float epsilon) {
+  const SyntheticMesh &mesh = GetMeshSet(triangles).unwelded;
+  std::vector<unsigned int> remap(mesh.vertices.size());
+  std::vector<cg::Vertex> vertices(mesh.vertices.size());
+  size_t unique = 0;
+  while (state.keepRunning()) {
+    unique = WeldVertices(remap.data(), vertices.data(), mesh.indices.data(), mesh.indices.size(),
+                          mesh.vertices.data(), mesh.vertices.size(), epsilon);
+    DoNotOptimize(unique);
+    DoNotOptimize(vertices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * mesh.indices.size());
+  state.setCounter("unique_vertices", static_cast<double>(unique));
+
+  if (epsilon == 0.0f) {
+    std::vector<unsigned int> expected(mesh.vertices.size());
+    meshopt_generateVertexRemap(expected.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(),
+                                mesh.vertices.size(), sizeof(cg::Vertex));
+    state.setCounter("matches_meshopt", remap == expected ? 1.0 : 0.0);
+  }
+}
+
+static void BenchmarkVertexCache(BenchmarkState &state, size_t triangles) {
+  const SyntheticMesh &mesh = GetMeshSet(triangles).welded;
+  std::vector<unsigned int> indices(mesh.indices.size());
+  while (state.keepRunning()) {
+    meshopt_optimizeVertexCache(indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    DoNotOptimize(indices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+
+  meshopt_VertexCacheStatistics before = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                                                    mesh.vertices.size(), 32, 32, 32);
+  meshopt_VertexCacheStatistics after = meshopt_analyzeVertexCache(indices.data(), indices.size(),
+                                                                   mesh.vertices.size(), 32, 32, 32);
+  state.setCounter("acmr_before", before.acmr);
+  state.setCounter("acmr_after", after.acmr);
+}
+
+static void BenchmarkOverdraw(BenchmarkState &state, size_t triangles) {
+  const MeshSet &set = GetMeshSet(triangles);
+  const SyntheticMesh &mesh = set.welded;
+  std::vector<unsigned int> indices(mesh.indices.size());
+  while (state.keepRunning()) {
+    meshopt_optimizeOverdraw(indices.data(), set.cacheOptimized.data(), set.cacheOptimized.size(),
+                             &mesh.vertices[0].position.x, mesh.vertices.size(), sizeof(cg::Vertex), 1.05f);
+    DoNotOptimize(indices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+}
+
+static void BenchmarkVertexFetch(BenchmarkState &state, size_t triangles) {
+  const MeshSet &set = GetMeshSet(triangles);
+  const SyntheticMesh &mesh = set.welded;
+  std::vector<unsigned int> indices;
+  std::vector<cg::Vertex> vertices(mesh.vertices.size());
+  while (state.keepRunning()) {
+    // The indices are rewritten in place
+    state.pauseTiming();
+    indices = set.cacheOptimized;
+    state.resumeTiming();
+
+    meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), mesh.vertices.data(),
+                                mesh.vertices.size(), sizeof(cg::Vertex));
+    DoNotOptimize(vertices.data());
+  }
+  state.setItemsProcessed(state.getIterations() * mesh.vertices.size());
+}
+
+static void BenchmarkAnalyze(BenchmarkState &state, size_t triangles) {
+  const MeshSet &set = GetMeshSet(triangles);
+  const SyntheticMesh &mesh = set.welded;
+  while (state.keepRunning()) {
+    meshopt_VertexCacheStatistics cache = meshopt_analyzeVertexCache(set.cacheOptimized.data(),
+                                                                     set.cacheOptimized.size(),
+                                                                     mesh.vertices.size(), 32, 32, 32);
+    meshopt_OverdrawStatistics overdraw = meshopt_analyzeOverdraw(set.cacheOptimized.data(),
+                                                                  set.cacheOptimized.size(),
+                                                                  &mesh.vertices[0].position.x,
+                                                                  mesh.vertices.size(), sizeof(cg::Vertex));
+    meshopt_VertexFetchStatistics fetch = meshopt_analyzeVertexFetch(set.cacheOptimized.data(),
+                                                                     set.cacheOptimized.size(),
+                                                                     mesh.vertices.size(), sizeof(cg::Vertex));
+    DoNotOptimize(cache);
+    DoNotOptimize(overdraw);
+    DoNotOptimize(fetch);
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+}
+
+static void BenchmarkSimplify(BenchmarkState &state, size_t triangles, int percent) {
+  const MeshSet &set = GetMeshSet(triangles);
+  const SyntheticMesh &mesh = set.welded;
+  size_t reduction = set.cacheOptimized.size() * percent / 100 / 3 * 3;
+
+  size_t removed = 0;
+  while (state.keepRunning()) {
+    // Simplify works in place, every iteration starts from the full mesh
+    state.pauseTiming();
+    cg::MeshInfo info(std::vector<cg::Vertex>(mesh.vertices), std::vector<unsigned int>(set.cacheOptimized));
+    state.resumeTiming();
+
+    removed = info.Simplify(reduction, 0.25f);
+    DoNotOptimize(removed);
+  }
+  state.setItemsProcessed(state.getIterations() * triangles);
+  state.setCounter("indices_removed", static_cast<double>(removed));
+}
+
+void RegisterMeshoptBenchmarks(BenchmarkRegistry &registry, size_t maxTriangles) {
+  for (size_t triangles : GetMeshSizes(maxTriangles)) {
+    std::string suffix = "/" + std::to_string(triangles);
+
+    // Multi-second stages on the largest meshes run a fixed number of iterations instead of calibrating
+    uint64_t fixed = triangles >= 10000000 ? 1 : 0;
+    registry.add("meshopt/generate_remap" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkGenerateRemap(state, triangles);
+    }, fixed);
+    registry.add("meshopt/remap_buffers" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkRemapBuffers(state, triangles);
+    }, fixed);
+    registry.add("weld/exact" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkWeldVertices(state, triangles, 0.0f);
+    }, fixed);
+    registry.add("weld/epsilon" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkWeldVertices(state, triangles, 1.0e-4f);
+    }, fixed);
+    registry.add("meshopt/vertex_cache" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkVertexCache(state, triangles);
+    }, fixed);
+    registry.add("meshopt/overdraw" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkOverdraw(state, triangles);
+    }, fixed);
+    registry.add("meshopt/vertex_fetch" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkVertexFetch(state, triangles);
+    }, fixed);
+    registry.add("meshopt/analyze" + suffix, [triangles](BenchmarkState &state) {
+      BenchmarkAnalyze(state, triangles);
+    }, fixed);
+
+    for (int percent : {25, 50, 75}) {
+      registry.add("simplify/" + std::to_string(percent) + "%" + suffix, [triangles, percent](BenchmarkState &state) {
+        BenchmarkSimplify(state, triangles, percent);
+      }, fixed);
+    }
+  }
+}
+
+}
+}
@@ -0,0 +1,116 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "SyntheticMesh.h"
+
+namespace cg {
+namespace bench {
+
+SyntheticMesh GenerateGrid(size_t triangles, bool shuffle) {
+  size_t cells = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(triangles) / 2.0)));
+  cells = cells < 1 ? 1 : cells;
+  size_t side = cells + 1;
+
+  SyntheticMesh mesh;
+  mesh.vertices.resize(side * side);
+  for (size_t z = 0; z < side; z++) {
+    for (size_t x = 0; x < side; x++) {
+      float u = static_cast<float>(x) / cells;
+      float v = static_cast<float>(z) / cells;
+      float height = 0.1f * std::sin(u * 25.0f) * std::cos(v * 17.0f);
+
+      cg::Vertex &vertex = mesh.vertices[z * side + x];
+      vertex = cg::Vertex();
+      vertex.position = glm::vec3(u * 2.0f - 1.0f, height, v * 2.0f - 1.0f);
+      vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+      vertex.color = glm::vec3(1.0f, 1.0f, 1.0f);
+      vertex.uv = glm::vec2(u, v);
+    }
+  }
+
+  mesh.indices.reserve(cells * cells * 6);
+  for (size_t z = 0; z < cells; z++) {
+    for (size_t x = 0; x < cells; x++) {
+      unsigned int corner = static_cast<unsigned int>(z * side + x);
+      unsigned int right = corner + 1;
+      unsigned int below = corner + static_cast<unsigned int>(side);
+      unsigned int diagonal = below + 1;
+      mesh.indices.insert(mesh.indices.end(), {corner, below, right, right, below, diagonal});
+    }
+  }
+
+  if (shuffle) {
+    // Fisher-Yates over whole triangles with a fixed xorshift seed, so every run sees the same mesh
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    size_t count = mesh.indices.size() / 3;
+    for (size_t i = count - 1; i > 0; i--) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      size_t j = state % (i + 1);
+      for (size_t k = 0; k < 3; k++) {
+        std::swap(mesh.indices[i * 3 + k], mesh.indices[j * 3 + k]);
+      }
+    }
+  }
+
+  return mesh;
+}
+
+SyntheticMesh Unweld(const SyntheticMesh &mesh) {
+  SyntheticMesh unwelded;
+  unwelded.vertices.reserve(mesh.indices.size());
+  unwelded.indices.reserve(mesh.indices.size());
+  for (unsigned int index : mesh.indices) {
+    unwelded.indices.push_back(static_cast<unsigned int>(unwelded.vertices.size()));
+    unwelded.vertices.push_back(mesh.vertices[index]);
+  }
+  return unwelded;
+}
+
+bool WriteObj(const std::string &path, const SyntheticMesh &mesh) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Error: could not open '%s' for writing\n", path.c_str());
+    return false;
+  }
+
+  for (const cg::Vertex &vertex : mesh.vertices) {
+    fprintf(file, "v %f %f %f\n", vertex.position.x, vertex.position.y, vertex.position.z);
+  }
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    fprintf(file, "f %u %u %u\n", mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1);
+  }
+
+  bool written = ferror(file) == 0;
+  fclose(file);
+  return written;
+}
+
+}
+}
@@ -0,0 +1,55 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_BENCH_SYNTHETICMESH_H_
+#define RENDOR_BENCH_SYNTHETICMESH_H_
+
+#include <string>
+#include <vector>
+
+#include "cg/Vertex.h"
+
+namespace cg {
+namespace bench {
+
+struct SyntheticMesh {
+  std::vector<cg::Vertex> vertices;
+  std::vector<unsigned int> indices;
+};
+
+/// Generates a displaced grid with at least the given number of triangles. The triangle order is shuffled
+/// deterministically so the cache and overdraw optimizers have work to do, like on meshes from most exporters.
+SyntheticMesh GenerateGrid(size_t triangles, bool shuffle = true);
+
+/// Gives every triangle corner its own vertex, the way an importer hands meshes over before vertices are welded.
+SyntheticMesh Unweld(const SyntheticMesh &mesh);
+
+/// Writes the mesh as a Wavefront OBJ file for the import benchmarks.
+/// \return true if the file was written
+bool WriteObj(const std::string &path, const SyntheticMesh &mesh);
+
+}
+}
+
+#endif //RENDOR_BENCH_SYNTHETICMESH_H_
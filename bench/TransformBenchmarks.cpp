@@ -0,0 +1,124 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <random>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "cg/JobSystem.h"
+#include "cg/TransformHierarchy.h"
+#include "Benchmarks.h"
+
+namespace cg {
+namespace bench {
+
+static const size_t kNodes = 100000;
+
+/// A scene-like forest: a few hundred roots, most nodes a few levels deep.
+static void BuildHierarchy(TransformHierarchy &hierarchy) {
+  std::mt19937 random(7);
+  hierarchy.reserve(kNodes);
+  for (size_t i = 0; i < kNodes; i++) {
+    uint32_t parent = TransformHierarchy::kNone;
+    if (i >= 256) {
+      // Parents from the first quarter keep the hierarchy around five levels deep
+      std::uniform_int_distribution<size_t> pick(0, i / 4);
+      parent = static_cast<uint32_t>(pick(random));
+    }
+
+    uint32_t node = hierarchy.create(parent);
+    float f = static_cast<float>(i);
+    hierarchy.setLocal(node, glm::vec3(f * 0.01f, 1.0f, -f * 0.02f),
+                       glm::angleAxis(f * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+  }
+  hierarchy.update(nullptr);
+}
+
+/// Every root moves, so the whole hierarchy is recomputed.
+static void BenchmarkFullUpdate(BenchmarkState &state, JobSystem *jobs) {
+  TransformHierarchy hierarchy;
+  BuildHierarchy(hierarchy);
+
+  float angle = 0.0f;
+  while (state.keepRunning()) {
+    angle += 0.01f;
+    for (uint32_t root = 0; root < 256; root++) {
+      hierarchy.setRotation(root, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+    hierarchy.update(jobs);
+    DoNotOptimize(hierarchy.getWorldMatrices().data());
+  }
+  state.setItemsProcessed(state.getIterations() * kNodes);
+  state.setCounter("updated", static_cast<double>(hierarchy.getUpdatedCount()));
+}
+
+static void BenchmarkFullUpdateSerial(BenchmarkState &state) {
+  BenchmarkFullUpdate(state, nullptr);
+}
+
+static void BenchmarkFullUpdateParallel(BenchmarkState &state) {
+  BenchmarkFullUpdate(state, &JobSystem::Get());
+  state.setCounter("threads", JobSystem::Get().getThreadCount());
+}
+
+/// One percent of the nodes move, only their subtrees are recomputed.
+static void BenchmarkPartialUpdate(BenchmarkState &state) {
+  TransformHierarchy hierarchy;
+  BuildHierarchy(hierarchy);
+
+  float offset = 0.0f;
+  while (state.keepRunning()) {
+    offset += 0.01f;
+    for (uint32_t node = 0; node < kNodes; node += 100) {
+      hierarchy.setPosition(node, glm::vec3(offset, 1.0f, 0.0f));
+    }
+    hierarchy.update(&JobSystem::Get());
+    DoNotOptimize(hierarchy.getWorldMatrices().data());
+  }
+  state.setItemsProcessed(state.getIterations() * kNodes);
+  state.setCounter("updated", static_cast<double>(hierarchy.getUpdatedCount()));
+}
+
+/// Nothing moved, the cost of finding that out.
+static void BenchmarkIdleUpdate(BenchmarkState &state) {
+  TransformHierarchy hierarchy;
+  BuildHierarchy(hierarchy);
+
+  while (state.keepRunning()) {
+    hierarchy.update(&JobSystem::Get());
+    DoNotOptimize(hierarchy.getWorldMatrices().data());
+  }
+  state.setItemsProcessed(state.getIterations() * kNodes);
+}
+
+void RegisterTransformBenchmarks(BenchmarkRegistry &registry) {
+  registry.add("transforms/full_serial", BenchmarkFullUpdateSerial);
+  registry.add("transforms/full_parallel", BenchmarkFullUpdateParallel);
+  registry.add("transforms/partial", BenchmarkPartialUpdate);
+  registry.add("transforms/idle", BenchmarkIdleUpdate);
+}
+
+}
+}
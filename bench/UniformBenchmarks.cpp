@@ -0,0 +1,158 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <memory>
+
+#include "cg/HeadlessContext.h"
+#include "cg/common/Program.h"
+#include "Benchmarks.h"
+
+namespace cg {
+namespace bench {
+
+static const char *kVertexSource = R"(#version 450 core
+layout(location = 0) in vec3 position;
+uniform mat4 E_MODEL;
+uniform mat4 E_VIEW;
+uniform mat4 E_PROJ;
+void main() {
+  gl_Position = E_PROJ * E_VIEW * E_MODEL * vec4(position, 1.0);
+}
+)";
+
+static const char *kFragmentSource = R"(#version 450 core
+uniform vec4 color;
+out vec4 fragColor;
+void main() {
+  fragColor = color;
+}
+)";
+
+static std::unique_ptr<HeadlessContext> context;
+static bool contextFailed = false;
+static std::string description;
+
+bool RequireGLContext(BenchmarkState &state) {
+  if (!context && !contextFailed) {
+    context.reset(new HeadlessContext());
+    contextFailed = !context->create(4, 5);
+    if (!contextFailed) {
+      description = std::string(reinterpret_cast<const char *>(glGetString(GL_RENDERER))) + ", "
+          + reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    }
+  }
+
+  if (contextFailed) {
+    state.skip("no OpenGL 4.5 context");
+    return false;
+  }
+  return true;
+}
+
+std::string GetGLDescription() {
+  return description;
+}
+
+static ShaderProgram *GetProgram() {
+  static std::unique_ptr<ShaderProgram> program;
+  if (!program) {
+    program.reset(ShaderProgram::FromSources({{ShaderType::VertexShader, kVertexSource},
+                                              {ShaderType::FragmentShader, kFragmentSource}}));
+  }
+  return program.get();
+}
+
+static void BenchmarkSetUniformMat4(BenchmarkState &state) {
+  if (!RequireGLContext(state)) return;
+  ShaderProgram *program = GetProgram();
+  glm::mat4 model(1.0f);
+  while (state.keepRunning()) {
+    program->setUniformMat4f("E_MODEL", model);
+  }
+  glFinish();
+  state.setItemsProcessed(state.getIterations());
+}
+
+static void BenchmarkSetUniform4f(BenchmarkState &state) {
+  if (!RequireGLContext(state)) return;
+  ShaderProgram *program = GetProgram();
+  glm::vec4 color(1.0f, 0.7f, 0.3f, 1.0f);
+  while (state.keepRunning()) {
+    program->setUniform4f("color", color);
+  }
+  glFinish();
+  state.setItemsProcessed(state.getIterations());
+}
+
+static void BenchmarkGetUniformLocation(BenchmarkState &state) {
+  if (!RequireGLContext(state)) return;
+  ShaderProgram *program = GetProgram();
+  while (state.keepRunning()) {
+    DoNotOptimize(program->getUniformLocation("E_PROJ"));
+  }
+  state.setItemsProcessed(state.getIterations());
+}
+
+/// Baseline for the named setters: the location is looked up once and the raw GL call is made.
+static void BenchmarkCachedLocation(BenchmarkState &state) {
+  if (!RequireGLContext(state)) return;
+  ShaderProgram *program = GetProgram();
+  int location = program->getUniformLocation("E_MODEL");
+  glm::mat4 model(1.0f);
+  while (state.keepRunning()) {
+    glProgramUniformMatrix4fv(program->getHandle(), location, 1, GL_FALSE, &model[0][0]);
+  }
+  glFinish();
+  state.setItemsProcessed(state.getIterations());
+}
+
+/// The uniforms Mesh::draw sets for every draw.
+static void BenchmarkDrawUniforms(BenchmarkState &state) {
+  if (!RequireGLContext(state)) return;
+  ShaderProgram *program = GetProgram();
+  glm::mat4 model(1.0f);
+  glm::mat4 view(1.0f);
+  glm::mat4 projection(1.0f);
+  glm::vec4 color(1.0f, 0.7f, 0.3f, 1.0f);
+  while (state.keepRunning()) {
+    program->setUniformMat4f("E_MODEL", model);
+    program->setUniformMat4f("E_VIEW", view);
+    program->setUniformMat4f("E_PROJ", projection);
+    program->setUniform4f("color", color);
+  }
+  glFinish();
+  state.setItemsProcessed(state.getIterations());
+}
+
+void RegisterUniformBenchmarks(BenchmarkRegistry &registry) {
+  registry.add("uniforms/setUniformMat4f", BenchmarkSetUniformMat4);
+  registry.add("uniforms/setUniform4f", BenchmarkSetUniform4f);
+  registry.add("uniforms/getUniformLocation", BenchmarkGetUniformLocation);
+  registry.add("uniforms/cached_location", BenchmarkCachedLocation);
+  registry.add("uniforms/mesh_draw", BenchmarkDrawUniforms);
+}
+
+}
+}
@@ -0,0 +1,384 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cg/Application.h>
+#include <cg/Camera.h>
+#include <cg/HeapStatistics.h>
+#include <cg/MaterialTable.h>
+#include <cg/Mesh.h>
+#include <cg/Profiler.h>
+#include <cg/TextureStreamer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "FrameStatistics.h"
+#include "SyntheticMesh.h"
+
+static const char *kVertexSource = R"(#version 450 core
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+uniform mat4 E_MODEL;
+uniform mat4 E_VIEW;
+uniform mat4 E_PROJ;
+out vec3 worldNormal;
+out vec2 textureCoordinates;
+void main() {
+  worldNormal = mat3(E_MODEL) * normal;
+  textureCoordinates = uv;
+  gl_Position = E_PROJ * E_VIEW * E_MODEL * vec4(position, 1.0);
+}
+)";
+
+// Follows the '#version' line and the material table declarations
+static const char *kFragmentSource = R"(
+in vec3 worldNormal;
+in vec2 textureCoordinates;
+out vec4 fragColor;
+void main() {
+  Material material = materials[E_MATERIAL];
+  vec4 color = material.baseColor * SampleBaseColor(material, textureCoordinates);
+  float light = max(dot(normalize(worldNormal), normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  fragColor = vec4(color.rgb * (0.2 + 0.8 * light), color.a);
+}
+)";
+
+/// Base colors of the materials the grid cells cycle through
+static const glm::vec4 kMaterialColors[] = {
+    {1.0f, 0.7f, 0.3f, 1.0f}, {0.3f, 0.7f, 1.0f, 1.0f}, {0.5f, 0.9f, 0.4f, 1.0f}, {0.9f, 0.4f, 0.6f, 1.0f}
+};
+
+struct FlythroughSettings {
+  uint64_t frames = 600;
+  uint64_t warmupFrames = 60;
+  int gridSize = 8;
+  size_t trianglesPerMesh = 20000;
+  double timestep = 1.0 / 60.0;
+  double loopSeconds = 10.0;
+
+  /// Streamed as the base color texture of the first material, a generated checkerboard if empty
+  std::string texturePath;
+};
+
+/// Writes a checkerboard as a binary PPM, which stb_image reads, so the benchmark needs no image files.
+/// \return false if the file could not be written
+static bool WriteCheckerboard(const std::string &path, int size) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "Error: could not write '%s'\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", size, size);
+  std::vector<unsigned char> row(static_cast<size_t>(size) * 3);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      unsigned char value = ((x / 32 + y / 32) % 2) ? 255 : 64;
+      row[x * 3] = value;
+      row[x * 3 + 1] = value;
+      row[x * 3 + 2] = static_cast<unsigned char>(x * 255 / size);
+    }
+    fwrite(row.data(), 1, row.size(), file);
+  }
+  return fclose(file) == 0;
+}
+
+struct VisibleCell {
+  glm::mat4 model;
+  uint32_t material;
+};
+
+/// Renders a fixed grid of meshes while the camera follows a closed Catmull-Rom spline around it. The camera time is
+/// frame index * timestep, so every run renders exactly the same frames no matter how fast they are produced. Meshes
+/// outside the camera frustum are skipped.
+class Flythrough : public cg::Application {
+ private:
+  FlythroughSettings settings;
+  std::unique_ptr<cg::ShaderProgram> program;
+  std::unique_ptr<cg::Mesh> mesh;
+  // Declared before the materials, which refer to its textures and are destroyed first
+  std::unique_ptr<cg::TextureStreamer> textures;
+  cg::StreamedTexture *texture = nullptr;
+  std::unique_ptr<cg::MaterialTable> materials;
+  std::vector<glm::vec3> controlPoints;
+  cg::Camera camera;
+  uint64_t renderedFrames = 0;
+
+ public:
+  uint64_t drawCalls = 0;
+  uint64_t triangles = 0;
+  uint64_t allocations = 0;
+  cg::TextureStreamingStats textureStats;
+  int textureLevel = -1;
+
+  Flythrough(const FlythroughSettings &settings, const cg::HeadlessSettings &headless)
+      : cg::Application(4, 5, "Flythrough", 1280, 720, headless), settings(settings) {}
+
+ protected:
+  void onInit() override {
+    Application::onInit();
+
+    cg::FrameLoopSettings loop;
+    loop.presentMode = cg::PresentMode::Uncapped;
+    setFrameLoopSettings(loop);
+
+    std::string texturePath = settings.texturePath;
+    if (texturePath.empty()) {
+      texturePath = "rendor_flythrough_texture.ppm";
+      if (!WriteCheckerboard(texturePath, 1024)) {
+        texturePath.clear();
+      }
+    }
+    textures.reset(new cg::TextureStreamer());
+    texture = texturePath.empty() ? nullptr : textures->load(texturePath);
+
+    materials.reset(new cg::MaterialTable());
+    for (const glm::vec4 &color : kMaterialColors) {
+      cg::Material material;
+      material.baseColor = color;
+      material.baseColorTexture = materials->size() == 0 ? texture : nullptr;
+      materials->add(material);
+    }
+
+    std::string fragmentSource = "#version 450 core\n" + materials->getGlslDeclarations() + kFragmentSource;
+    program.reset(cg::ShaderProgram::FromSources({{cg::ShaderType::VertexShader, kVertexSource},
+                                                  {cg::ShaderType::FragmentShader, fragmentSource}}));
+    cg::bench::SyntheticMesh grid = cg::bench::GenerateGrid(settings.trianglesPerMesh, false);
+    mesh.reset(new cg::Mesh(std::move(grid.vertices), std::move(grid.indices), cg::MeshRetention::DropAfterUpload));
+
+    float extent = static_cast<float>(settings.gridSize) * 2.5f;
+    controlPoints = {
+        {-extent, 3.0f, -extent}, {0.0f, 6.0f, -extent * 1.2f}, {extent, 2.0f, -extent},
+        {extent * 1.2f, 5.0f, 0.0f}, {extent, 1.5f, extent}, {0.0f, 8.0f, extent * 1.2f},
+        {-extent, 2.5f, extent}, {-extent * 1.2f, 4.0f, 0.0f}
+    };
+    camera = cg::Camera::Perspective(60.0f, static_cast<float>(getWidth()) / getHeight(), 0.1f, 500.0f);
+  }
+
+  void onRender(float alpha) override {
+    double time = renderedFrames * settings.timestep;
+    renderedFrames++;
+
+    // The timings are of the previous frame, which is a measured one from the second frame after the warmup on
+    if (renderedFrames > settings.warmupFrames + 1) {
+      allocations += getFrameTimings().allocations;
+    }
+
+    camera.setPosition(sample(time));
+    camera.lookAt(sample(time + 0.25));
+    const glm::mat4 &view = camera.getViewMatrix();
+    const glm::mat4 &projection = camera.getProjectionMatrix();
+    const cg::Frustum &frustum = camera.getFrustum();
+
+    // Pixels per world unit at a distance of 1, for the on-screen size the streamer picks the texture levels by
+    float pixelsPerUnit = getHeight() / (2.0f * std::tan(glm::radians(30.0f)));
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Cull first and draw the visible list afterwards, the list only lives until the end of the frame
+    cg::ArenaVector<VisibleCell> visible{cg::ArenaAllocator<VisibleCell>(getFrameArena())};
+    visible.reserve(static_cast<size_t>(settings.gridSize) * settings.gridSize);
+    float offset = (settings.gridSize - 1) * 2.5f;
+    for (int z = 0; z < settings.gridSize; z++) {
+      for (int x = 0; x < settings.gridSize; x++) {
+        // The grid mesh spans [-1, 1] on x and z with small waves on y, scaled by 2
+        glm::vec3 center(x * 5.0f - offset, 0.0f, z * 5.0f - offset);
+        if (frustum.intersectsBox(center - glm::vec3(2.0f, 0.2f, 2.0f), center + glm::vec3(2.0f, 0.2f, 2.0f))) {
+          uint32_t material = static_cast<uint32_t>((x + z) % materials->size());
+          visible.push_back({glm::translate(center) * glm::scale(glm::vec3(2.0f)), material});
+          if (texture && material == 0) {
+            float distance = std::max(glm::length(center - camera.getPosition()), 0.1f);
+            textures->markUsed(texture, 4.0f * pixelsPerUnit / distance);
+          }
+        }
+      }
+    }
+
+    // One binding for all materials, a draw only selects its index. The material follows the levels the streamer
+    // uploaded this frame.
+    textures->update();
+    textureStats = textures->getStats();
+    textureLevel = texture && texture->getTexture() ? texture->getResidentLevel() : -1;
+    materials->update();
+    materials->bind();
+    for (const VisibleCell &cell : visible) {
+      mesh->draw(program.get(), cell.model, view, projection, cell.material);
+      drawCalls++;
+      triangles += mesh->getIndexCount() / 3;
+    }
+  }
+
+ private:
+  glm::vec3 sample(double time) const {
+    double loop = std::fmod(time / settings.loopSeconds, 1.0) * controlPoints.size();
+    size_t segment = static_cast<size_t>(loop);
+    float t = static_cast<float>(loop - segment);
+
+    size_t count = controlPoints.size();
+    const glm::vec3 &p0 = controlPoints[(segment + count - 1) % count];
+    const glm::vec3 &p1 = controlPoints[segment % count];
+    const glm::vec3 &p2 = controlPoints[(segment + 1) % count];
+    const glm::vec3 &p3 = controlPoints[(segment + 2) % count];
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+        + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+  }
+};
+
+static void PrintSummary(const char *name, const std::vector<double> &times) {
+  cg::bench::FrameSummary summary = cg::bench::Summarize(times);
+  printf("%-4s  mean %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  worst %8.3f ms  (%zu frames)\n", name, summary.mean,
+         summary.p50, summary.p95, summary.p99, summary.worst, times.size());
+}
+
+static void PrintUsage() {
+  printf("Usage: rendor_flythrough [options]\n"
+         "       rendor_flythrough --compare <baseline.json> <candidate.json> [--threshold 0.02] [--alpha 0.01]\n"
+         "  --json <file>       write the per-frame results\n"
+         "  --frames <n>        measured frames (default 600)\n"
+         "  --warmup <n>        frames rendered before measuring (default 60)\n"
+         "  --grid <n>          n x n meshes in the scene (default 8)\n"
+         "  --triangles <n>     triangles per mesh (default 20000)\n"
+         "  --texture <file>    base color texture of the first material (default a generated checkerboard)\n"
+         "  --window            render in a window instead of headless\n");
+}
+
+int main(int argc, char **argv) {
+  FlythroughSettings settings;
+  cg::HeadlessSettings headless;
+  headless.enabled = true;
+  std::string jsonPath;
+  double threshold = 0.02;
+  double significance = 0.01;
+  std::vector<std::string> compare;
+
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (argument == "--json" && hasValue) {
+      jsonPath = argv[++i];
+    } else if (argument == "--frames" && hasValue) {
+      settings.frames = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "--warmup" && hasValue) {
+      settings.warmupFrames = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "--grid" && hasValue) {
+      settings.gridSize = std::atoi(argv[++i]);
+    } else if (argument == "--triangles" && hasValue) {
+      settings.trianglesPerMesh = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "--texture" && hasValue) {
+      settings.texturePath = argv[++i];
+    } else if (argument == "--window") {
+      headless.enabled = false;
+    } else if (argument == "--compare" && i + 2 < argc) {
+      compare.push_back(argv[++i]);
+      compare.push_back(argv[++i]);
+    } else if (argument == "--threshold" && hasValue) {
+      threshold = std::atof(argv[++i]);
+    } else if (argument == "--alpha" && hasValue) {
+      significance = std::atof(argv[++i]);
+    } else {
+      PrintUsage();
+      return argument == "--help" ? 0 : 1;
+    }
+  }
+
+  if (!compare.empty()) {
+    cg::bench::FlythroughResult baseline;
+    cg::bench::FlythroughResult candidate;
+    if (!cg::bench::ReadFlythroughJson(compare[0], baseline) || !cg::bench::ReadFlythroughJson(compare[1], candidate)) {
+      return 2;
+    }
+    return cg::bench::CompareFlythroughs(baseline, candidate, threshold, significance) ? 1 : 0;
+  }
+
+  uint64_t totalFrames = settings.warmupFrames + settings.frames;
+  headless.maxFrames = totalFrames;
+  cg::Profiler &profiler = cg::Profiler::Get();
+  profiler.setHistorySize(totalFrames);
+
+  Flythrough flythrough(settings, headless);
+  flythrough.run();
+  profiler.flush();
+
+  cg::bench::FlythroughResult result;
+  for (size_t i = 0; i < profiler.getFrameCount(); i++) {
+    const cg::ProfileFrame &frame = profiler.getFrame(i);
+    if (frame.index <= settings.warmupFrames) {
+      continue;
+    }
+
+    result.cpuTimes.push_back((frame.end - frame.start) / 1e6);
+    for (const cg::ProfileEvent &event : frame.gpuEvents) {
+      if (event.depth == 0 && std::strcmp(event.name, "Render") == 0) {
+        result.gpuTimes.push_back((event.end - event.start) / 1e6);
+      }
+    }
+  }
+
+  if (result.cpuTimes.empty()) {
+    fprintf(stderr, "Error: no frames were recorded\n");
+    return 2;
+  }
+
+  result.drawCalls = static_cast<double>(flythrough.drawCalls) / totalFrames;
+  result.triangles = static_cast<double>(flythrough.triangles) / totalFrames;
+  result.context["renderer"] = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+  result.context["version"] = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+  result.context["frames"] = std::to_string(settings.frames);
+  result.context["grid"] = std::to_string(settings.gridSize);
+  result.context["triangles_per_mesh"] = std::to_string(settings.trianglesPerMesh);
+  if (cg::HeapStatistics::IsTracking()) {
+    double allocations = static_cast<double>(flythrough.allocations) / std::max<uint64_t>(settings.frames - 1, 1);
+    result.context["allocations_per_frame"] = std::to_string(allocations);
+    printf("%.2f heap allocations per frame\n", allocations);
+  }
+
+  if (flythrough.textureLevel >= 0) {
+    result.context["texture_resident_level"] = std::to_string(flythrough.textureLevel);
+    printf("Texture streamed down to level %d, %zu KB resident\n", flythrough.textureLevel,
+           flythrough.textureStats.residentBytes / 1024);
+  }
+
+  PrintSummary("CPU", result.cpuTimes);
+  PrintSummary("GPU", result.gpuTimes);
+  printf("%.0f draw calls, %.0f triangles per frame\n", result.drawCalls, result.triangles);
+
+  if (!jsonPath.empty() && !cg::bench::WriteFlythroughJson(jsonPath, result)) {
+    return 2;
+  }
+  return 0;
+}
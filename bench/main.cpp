@@ -0,0 +1,129 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+#include "Benchmarks.h"
+
+namespace cg {
+namespace bench {
+
+std::vector<size_t> GetMeshSizes(size_t maxTriangles) {
+  std::vector<size_t> sizes;
+  for (size_t triangles = 1000; triangles <= maxTriangles && triangles <= 10000000; triangles *= 10) {
+    sizes.push_back(triangles);
+  }
+  return sizes;
+}
+
+}
+}
+
+static void PrintUsage() {
+  printf("Usage: rendor_bench [options]\n"
+         "  --filter <text>        only run benchmarks whose name contains text\n"
+         "  --json <file>          write the results as JSON\n"
+         "  --min-time <seconds>   minimum time per repetition (default 0.25)\n"
+         "  --repetitions <n>      repetitions per benchmark (default 5)\n"
+         "  --max-triangles <n>    largest synthetic mesh (default 1000000, up to 10000000 which needs ~4 GB)\n"
+         "  --list                 list the benchmarks and exit\n");
+}
+
+int main(int argc, char **argv) {
+  cg::bench::BenchmarkSettings settings;
+  std::string jsonPath;
+  size_t maxTriangles = 1000000;
+  bool list = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (argument == "--filter" && hasValue) {
+      settings.filter = argv[++i];
+    } else if (argument == "--json" && hasValue) {
+      jsonPath = argv[++i];
+    } else if (argument == "--min-time" && hasValue) {
+      settings.minSeconds = std::atof(argv[++i]);
+    } else if (argument == "--repetitions" && hasValue) {
+      settings.repetitions = std::atoi(argv[++i]);
+    } else if (argument == "--max-triangles" && hasValue) {
+      maxTriangles = static_cast<size_t>(std::atoll(argv[++i]));
+    } else if (argument == "--list") {
+      list = true;
+    } else {
+      PrintUsage();
+      return argument == "--help" ? 0 : 1;
+    }
+  }
+
+  cg::bench::BenchmarkRegistry registry;
+  cg::bench::RegisterImportBenchmarks(registry, maxTriangles);
+  cg::bench::RegisterMeshoptBenchmarks(registry, maxTriangles);
+  cg::bench::RegisterUniformBenchmarks(registry);
+  cg::bench::RegisterMathBenchmarks(registry);
+  cg::bench::RegisterJobBenchmarks(registry);
+  cg::bench::RegisterTransformBenchmarks(registry);
+
+  if (list) {
+    for (const std::string &name : registry.getNames()) {
+      printf("%s\n", name.c_str());
+    }
+    return 0;
+  }
+
+  std::vector<cg::bench::BenchmarkResult> results = registry.run(settings);
+
+  if (!jsonPath.empty()) {
+    std::map<std::string, std::string> context;
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    context["date"] = date;
+#ifdef NDEBUG
+    context["build"] = "release";
+#else
+    context["build"] = "debug";
+#endif
+#if defined(__clang__)
+    context["compiler"] = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    context["compiler"] = std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    context["compiler"] = "msvc " + std::to_string(_MSC_VER);
+#endif
+    context["gl"] = cg::bench::GetGLDescription();
+    context["min_time"] = std::to_string(settings.minSeconds);
+    context["repetitions"] = std::to_string(settings.repetitions);
+
+    if (!cg::bench::BenchmarkRegistry::WriteJson(jsonPath, context, results)) {
+      return 1;
+    }
+    printf("Wrote %zu results to %s\n", results.size(), jsonPath.c_str());
+  }
+
+  return 0;
+}
@@ -27,7 +27,10 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <cstdint>
+#include <fstream>
 #include <string>
+#include <vector>
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD
 #include <imgui.h>
@@ -35,8 +38,31 @@
 #include <examples/imgui_impl_glfw.h>
 #include <examples/imgui_impl_opengl3.h>
 
+#include "cg/FrameLoop.h"
+#include "cg/HeadlessContext.h"
+#include "cg/Input.h"
+#include "cg/LoaderThread.h"
+#include "cg/ScratchAllocator.h"
+#include "cg/common/Framebuffer.h"
+
 namespace cg {
 
+/// HeadlessSettings - Runs the application without a window, rendering into an offscreen framebuffer (e.g. for
+/// benchmarks, image tests and CI). Input callbacks are never called in headless mode.
+struct HeadlessSettings {
+  bool enabled = false;
+
+  /// Stops run() after this many frames, 0 runs until requestStop() is called.
+  uint64_t maxFrames = 0;
+
+  /// Writes every dumpInterval-th frame as a PPM image into this directory, empty disables dumps.
+  std::string dumpDirectory;
+  uint64_t dumpInterval = 1;
+
+  /// Without a swap chain nothing stops the CPU from queueing frames, run() waits once this many are queued.
+  size_t maxFramesInFlight = 2;
+};
+
 class Application {
  public:
   enum class KeyInputType {
@@ -53,17 +79,40 @@ class Application {
   };
 
  private:
-  GLFWwindow *handle;
+  GLFWwindow *handle = nullptr;
   std::string title;
   int width;
   int height;
 
+  HeadlessSettings headlessSettings;
+  HeadlessContext headlessContext;
+  Framebuffer *framebuffer = nullptr;
+  std::vector<GLsync> frameFences;
+  bool stopRequested = false;
+
+  Input input;
+  LoaderThread loader;
+
+  FrameLoopSettings frameLoopSettings;
+  FrameTimings frameTimings;
+  FramePacer framePacer;
+  ScratchAllocator frameArena;
+
  public:
-  Application(int glMajor, int glMinor, const std::string &title, int width, int height);
+  Application(int glMajor, int glMinor, const std::string &title, int width, int height,
+              const HeadlessSettings &headless = HeadlessSettings());
   ~Application();
 
   void run();
 
+  /// Makes run() return after the current frame.
+  void requestStop();
+
+  bool isHeadless();
+
+  /// Gets the offscreen framebuffer that headless frames render into, nullptr when running in a window.
+  Framebuffer *getFramebuffer();
+
   void setTitle(const std::string &title);
   const std::string &getTitle();
 
@@ -72,20 +121,50 @@ class Application {
   int getWidth();
   int getHeight();
 
+  /// Sets how run() paces frames and steps the simulation. Can be changed while running.
+  void setFrameLoopSettings(const FrameLoopSettings &settings);
+  const FrameLoopSettings &getFrameLoopSettings();
+
+  /// Gets the timings of the last completed frame.
+  const FrameTimings &getFrameTimings();
+
+  /// Gets the input sampled for the current frame, see cg::Input.
+  const Input &getInput();
+
+  /// Gets the arena for temporaries that live until the end of the frame. It is reset after the frame was presented
+  /// and must only be used from the thread that called run(), jobs use ScratchAllocator::Get.
+  ScratchAllocator &getFrameArena();
+
+  /// Gets the loader thread, whose context shares objects with the render context. run() publishes its finished
+  /// work before onRender.
+  LoaderThread &getLoader();
+
  protected:
   virtual void onInit() {
     ImGui::CreateContext();
     ImGuiIO &io = ImGui::GetIO();
     (void) io;
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-    ImFont *font = io.Fonts->AddFontFromFileTTF("Inter-Regular.ttf", 14.0f);
+    // ImGui asserts on missing font files, keep the default font when it is not next to the executable
+    if (std::ifstream("Inter-Regular.ttf").good()) {
+      io.Fonts->AddFontFromFileTTF("Inter-Regular.ttf", 14.0f);
+    }
 
-    ImGui_ImplGlfw_InitForOpenGL(this->handle, true);
+    // Headless frames feed ImGui's display size and time in run() instead of the GLFW backend
+    if (!isHeadless()) {
+      ImGui_ImplGlfw_InitForOpenGL(this->handle, true);
+    }
     ImGui_ImplOpenGL3_Init("#version 450");
     ImGui::StyleColorsLight();
 
   }
+  /// Called once per frame on the thread that called run(), after the input was sampled and before the updates.
+  /// Consume the per-frame input (key edges, mouse and scroll deltas) here, onUpdate may run any number of times.
+  virtual void onFrame(const Input &input) {}
   virtual void onUpdate(float delta) {}
+  /// Called once per frame after the updates. With a fixed timestep, alpha is how far the frame lies between the last
+  /// two simulation steps (0..1) and can be used to interpolate; otherwise it is always 1.
+  virtual void onRender(float alpha) {}
   virtual void onGui() {}
   virtual void onViewportResize(int width, int height) {}
   virtual void onKeyInput(int key, int scancode, KeyInputType action, int mods) {}
@@ -93,22 +172,40 @@ class Application {
   virtual void onMouseMove(double x, double y) {}
 
  private:
+  void applyPresentMode();
+  bool shouldClose(uint64_t frame);
+  void dumpFrame(uint64_t frame);
+  void throttleFrames();
+
   inline static void OnViewportResizeCallback(GLFWwindow *window, int width, int height) {
     auto *application = (Application *) glfwGetWindowUserPointer(window);
     application->onViewportResize(width, height);
   }
 
   inline static void OnMouseMoveCallback(GLFWwindow *window, double x, double y) {
-    if (!ImGui::IsAnyWindowFocused()) {
-      auto *application = (Application *) glfwGetWindowUserPointer(window);
+    auto *application = (Application *) glfwGetWindowUserPointer(window);
+    application->input.recordCursor(x, y);
 
+    if (!ImGui::IsAnyWindowFocused()) {
       application->onMouseMove(x, y);
     }
   }
 
+  inline static void OnMouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
+    auto *application = (Application *) glfwGetWindowUserPointer(window);
+    application->input.recordMouseButton(button, action);
+  }
+
+  inline static void OnScrollCallback(GLFWwindow *window, double x, double y) {
+    auto *application = (Application *) glfwGetWindowUserPointer(window);
+    application->input.recordScroll(x, y);
+  }
+
   inline static void OnKeyInputCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    auto *application = (Application *) glfwGetWindowUserPointer(window);
+    application->input.recordKey(key, action);
+
     if (!ImGui::IsAnyWindowFocused()) {
-      auto *application = (Application *) glfwGetWindowUserPointer(window);
 
       KeyInputType inputAction;
       KeyInputModifier inputModifier;
@@ -0,0 +1,184 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_CAMERA_H_
+#define RENDOR_INCLUDE_CG_CAMERA_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace cg {
+
+/// The clip space depth range a projection maps to.
+enum class ClipDepth {
+  /// OpenGL's default, near maps to -1 and far to 1
+  NegativeOneToOne,
+
+  /// Reversed Z with glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE), near maps to 1 and far (or infinity) to 0
+  ReversedZeroToOne
+};
+
+/// Frustum - The planes bounding what a camera sees, normals pointing inwards.
+class Frustum {
+ public:
+  enum Side { Left, Right, Bottom, Top, Near, Far };
+
+ private:
+  /// xyz is the unit normal, w the distance, a point p is inside a plane if dot(xyz, p) + w >= 0
+  glm::vec4 planes[6];
+  int planeCount = 0;
+
+ public:
+  Frustum() = default;
+
+  /// Extracts the planes from a (view-)projection matrix. An infinite projection has no far plane.
+  static Frustum FromMatrix(const glm::mat4 &matrix, ClipDepth depth);
+
+  /// Gets the number of planes, 5 for infinite projections where Far is missing.
+  int getPlaneCount() const { return planeCount; }
+  const glm::vec4 &getPlane(int index) const { return planes[index]; }
+
+  bool containsPoint(const glm::vec3 &point) const;
+
+  /// \return false only if the sphere is entirely outside, spheres near the corners can pass without being visible
+  bool intersectsSphere(const glm::vec3 &center, float radius) const;
+
+  /// \return false only if the axis-aligned box is entirely outside one of the planes
+  bool intersectsBox(const glm::vec3 &min, const glm::vec3 &max) const;
+};
+
+enum class ProjectionType {
+  Perspective,
+
+  /// Perspective without a far plane, using reversed Z (see ClipDepth::ReversedZeroToOne)
+  InfinitePerspective,
+  Orthographic
+};
+
+/// Camera - Position, orientation and projection, with the matrices and frustum derived from them.
+///
+/// Derived values are computed on first use after an input changed and cached until the next change, so a camera
+/// that does not move costs nothing per frame. Setters that do not change a value keep the cache. The camera looks
+/// down its local -Z axis with +Y up, like OpenGL's eye space.
+///
+/// An infinite perspective uses reversed Z, which needs glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE), a depth clear
+/// value of 0 and glDepthFunc(GL_GREATER). Check getClipDepth() to configure the pipeline.
+class Camera {
+ private:
+  enum Stale : unsigned int {
+    ViewStale = 1 << 0,
+    ProjectionStale = 1 << 1,
+    ViewProjectionStale = 1 << 2,
+    InverseProjectionStale = 1 << 3,
+    InverseViewProjectionStale = 1 << 4,
+    FrustumStale = 1 << 5,
+    All = 0x3F
+  };
+
+  glm::vec3 position;
+  glm::quat rotation;
+
+  ProjectionType projectionType = ProjectionType::Perspective;
+  float fov = 60.0f;
+  float aspect = 16.0f / 9.0f;
+  float nearPlane = 0.1f;
+  float farPlane = 1000.0f;
+  float height = 10.0f;
+
+  mutable unsigned int stale = All;
+  mutable glm::mat4 view;
+  mutable glm::mat4 inverseView;
+  mutable glm::mat4 projection;
+  mutable glm::mat4 inverseProjection;
+  mutable glm::mat4 viewProjection;
+  mutable glm::mat4 inverseViewProjection;
+  mutable Frustum frustum;
+
+ public:
+  /// A perspective camera at the origin looking down -Z.
+  Camera();
+
+  /// \param fov vertical field of view in degrees
+  static Camera Perspective(float fov, float aspect, float nearPlane, float farPlane);
+
+  /// \param fov vertical field of view in degrees
+  static Camera InfinitePerspective(float fov, float aspect, float nearPlane);
+
+  /// \param height the visible height in world units, the width follows from the aspect ratio
+  static Camera Orthographic(float height, float aspect, float nearPlane, float farPlane);
+
+  void setPosition(const glm::vec3 &position);
+  void setRotation(const glm::quat &rotation);
+
+  /// Turns the camera towards a point.
+  void lookAt(const glm::vec3 &target, const glm::vec3 &up = glm::vec3(0.0f, 1.0f, 0.0f));
+
+  /// Moves the camera along its own axes, x to the right, y up and z forward.
+  void moveLocal(const glm::vec3 &offset);
+
+  void setProjectionType(ProjectionType type);
+
+  /// \param degrees vertical field of view, used by the perspective projections
+  void setFov(float degrees);
+  void setAspectRatio(float aspect);
+  void setAspectRatio(float width, float height);
+  void setNearPlane(float nearPlane);
+
+  /// Ignored by the infinite perspective.
+  void setFarPlane(float farPlane);
+
+  /// \param height the visible height in world units, used by the orthographic projection
+  void setOrthographicHeight(float height);
+
+  const glm::vec3 &getPosition() const { return position; }
+  const glm::quat &getRotation() const { return rotation; }
+  glm::vec3 getForward() const;
+  glm::vec3 getRight() const;
+  glm::vec3 getUp() const;
+
+  ProjectionType getProjectionType() const { return projectionType; }
+  ClipDepth getClipDepth() const;
+  float getFov() const { return fov; }
+  float getAspectRatio() const { return aspect; }
+  float getNearPlane() const { return nearPlane; }
+  float getFarPlane() const { return farPlane; }
+  float getOrthographicHeight() const { return height; }
+
+  const glm::mat4 &getViewMatrix() const;
+  const glm::mat4 &getInverseViewMatrix() const;
+  const glm::mat4 &getProjectionMatrix() const;
+  const glm::mat4 &getInverseProjectionMatrix() const;
+  const glm::mat4 &getViewProjectionMatrix() const;
+  const glm::mat4 &getInverseViewProjectionMatrix() const;
+
+  /// Gets the world space frustum.
+  const Frustum &getFrustum() const;
+
+ private:
+  void invalidate(unsigned int flags);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_CAMERA_H_
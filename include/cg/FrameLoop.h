@@ -0,0 +1,148 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_FRAMELOOP_H_
+#define RENDOR_INCLUDE_CG_FRAMELOOP_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cg {
+
+/// How frames are presented and paced by Application::run.
+enum class PresentMode {
+  /// Wait for vertical sync on every swap
+  VSync,
+  /// Wait for vertical sync, but tear instead of waiting a whole refresh when a frame is late. Falls back to VSync
+  /// when the driver does not support swap control tear
+  AdaptiveVSync,
+  /// Never wait, render as fast as possible. Meant for benchmarking throughput
+  Uncapped,
+  /// No vertical sync, but limit the frame rate to FrameLoopSettings::targetFrameRate
+  Limited
+};
+
+struct FrameLoopSettings {
+  PresentMode presentMode = PresentMode::VSync;
+
+  /// Frames per second for PresentMode::Limited
+  double targetFrameRate = 60.0;
+
+  /// Run onUpdate with a fixed delta (possibly several times per frame) and pass the interpolation factor between
+  /// the last two simulation steps to onRender. When false, onUpdate runs once per frame with the frame's delta
+  bool fixedTimestep = false;
+  double fixedDelta = 1.0 / 60.0;
+
+  /// Upper bound on simulation steps per frame, so a slow frame cannot make the next one slower still
+  int maxUpdatesPerFrame = 8;
+
+  /// Run onUpdate on a simulation thread. While the simulation computes frame N+1, onRender submits frame N from the
+  /// snapshot the previous update published (see cg::TripleBuffer), which adds one frame of latency. onGui runs after
+  /// the update finished and may touch simulation state. All OpenGL calls stay on the thread that called run()
+  bool threadedSimulation = false;
+};
+
+/// FrameTimings - Where the time of a frame went, in milliseconds.
+struct FrameTimings {
+  uint64_t frame = 0;
+  double update = 0.0;
+  double render = 0.0;
+  double gui = 0.0;
+  double swap = 0.0;
+  double wait = 0.0;
+  double total = 0.0;
+
+  /// Number of onUpdate calls in this frame
+  int updates = 0;
+
+  /// Interpolation factor passed to onRender
+  float alpha = 1.0f;
+
+  /// Heap allocations made through operator new during the frame on any thread, see cg::HeapStatistics
+  uint64_t allocations = 0;
+};
+
+/// FrameWorker - A thread that runs one task per frame: kick() hands it the task, wait() blocks until it is done.
+class FrameWorker {
+ private:
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::function<void()> task;
+  bool pending = false;
+  bool quit = false;
+
+ public:
+  /// \param name the thread's name in the profiler
+  explicit FrameWorker(const std::string &name);
+  ~FrameWorker();
+
+  FrameWorker(const FrameWorker &otherCopy) = delete;
+  FrameWorker(const FrameWorker &&otherMove) = delete;
+
+  /// Starts the task, the previous one must have been waited for.
+  void kick(const std::function<void()> &task);
+  void wait();
+
+ private:
+  void work(const std::string &name);
+};
+
+/// FramePacer - Waits until the next frame of a fixed frame rate is due. Sleeps while the remaining time is larger
+/// than the (measured) sleep overshoot of the OS scheduler, then spins for the rest, which keeps frame times tight
+/// without burning a core for the whole frame.
+class FramePacer {
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::duration period;
+  Clock::time_point deadline;
+
+  // Running estimate of how long a 1 ms sleep really takes
+  double sleepEstimate = 5e-3;
+  double sleepMean = 1e-3;
+  double sleepM2 = 0.0;
+  uint64_t sleepCount = 1;
+
+ public:
+  explicit FramePacer(double framesPerSecond = 60.0);
+
+  void setTargetFrameRate(double framesPerSecond);
+
+  /// Waits for the next frame deadline.
+  /// \return the time spent waiting in seconds
+  double wait();
+
+  /// Restarts pacing from now, e.g. after a long stall.
+  void reset();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_FRAMELOOP_H_
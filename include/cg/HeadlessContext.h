@@ -0,0 +1,80 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_HEADLESSCONTEXT_H_
+#define RENDOR_INCLUDE_CG_HEADLESSCONTEXT_H_
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+namespace cg {
+
+/// HeadlessContext - An OpenGL context without a visible window.
+///
+/// When built with RENDOR_HEADLESS_EGL the context is created through EGL, surfaceless when the driver supports
+/// EGL_KHR_surfaceless_context and with a 1x1 pbuffer otherwise, so it works without a display server (e.g. Mesa's
+/// llvmpipe on CI). Without EGL it falls back to a hidden GLFW window, which still needs a display (or Xvfb).
+/// Rendering always goes into a framebuffer object, see cg::Framebuffer.
+class HeadlessContext {
+ private:
+  GLFWwindow *window = nullptr;
+  void *display = nullptr;
+  void *context = nullptr;
+  void *surface = nullptr;
+  bool ownsDisplay = true;
+
+ public:
+  HeadlessContext() = default;
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext &otherCopy) = delete;
+  HeadlessContext(const HeadlessContext &&otherMove) = delete;
+
+  /// Creates a core profile context, makes it current and loads the GL functions.
+  /// \param glMajor the requested major version
+  /// \param glMinor the requested minor version
+  /// \param share context to share buffers, textures, programs and syncs with, nullptr for none
+  /// \return true if the context is current and usable
+  bool create(int glMajor, int glMinor, const HeadlessContext *share = nullptr);
+
+  /// Creates a context with the version and profile of a window's context that shares its objects, in a hidden GLFW
+  /// window, and makes it current. Must be called on the thread that created the window.
+  /// \return true if the context is current and usable
+  bool createShared(GLFWwindow *share);
+
+  void makeCurrent();
+
+  /// Makes no context current on the calling thread if this one is, so another thread can make it current.
+  void release();
+  void destroy();
+
+  bool isCreated() const;
+
+  /// Gets the hidden window of the GLFW fallback or of createShared, nullptr when created through EGL.
+  GLFWwindow *getWindow();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_HEADLESSCONTEXT_H_
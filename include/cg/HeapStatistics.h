@@ -0,0 +1,56 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_HEAPSTATISTICS_H_
+#define RENDOR_INCLUDE_CG_HEAPSTATISTICS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cg {
+
+/// HeapStatistics - Counts general heap allocations made through operator new, on every thread.
+///
+/// The library never replaces the global allocator itself. An executable opts in by compiling lib/HeapTracking.cpp,
+/// whose operator new and delete replacements report to RecordAllocation; the RENDOR_TRACK_ALLOCATIONS option does
+/// that for the bench and demo targets. Without it every count stays 0. Allocations made with malloc directly (ImGui,
+/// Assimp's C parts, drivers) are not seen. Application::run reports the allocations of every frame in FrameTimings.
+class HeapStatistics {
+ public:
+  /// \return true if allocations are counted
+  static bool IsTracking();
+
+  /// Gets the number of allocations since the program started.
+  static uint64_t GetAllocationCount();
+
+  /// Gets the number of bytes requested since the program started.
+  static uint64_t GetAllocatedBytes();
+
+  /// Counts an allocation, called by the operator new replacements in lib/HeapTracking.cpp or an application's own.
+  static void RecordAllocation(size_t bytes);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_HEAPSTATISTICS_H_
@@ -0,0 +1,78 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_IMAGE_H_
+#define RENDOR_INCLUDE_CG_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cg {
+
+/// How Image::generateMips computes a level from the one above it.
+enum class MipFilter {
+  /// Average of 2x2 pixels, fast but blurry and prone to aliasing
+  Box,
+  /// Kaiser windowed sinc over 8x8 pixels, sharper levels with less aliasing
+  Kaiser
+};
+
+/// ImageLevel - One level of an Image, RGBA8 pixels with the bottom row first as OpenGL expects them.
+struct ImageLevel {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+/// Image - Decoded RGBA8 image with its mip chain, levels[0] is the full size image. The levels have the sizes OpenGL
+/// uses for a full mip chain: each one is half the size of the one above it, rounded down and at least 1.
+class Image {
+ public:
+  std::vector<ImageLevel> levels;
+
+  /// Decodes an image file (PNG, JPEG, TGA, BMP, PSD, GIF, HDR or PIC) into levels[0], any channel count is expanded
+  /// to RGBA. Safe to call from any thread.
+  /// \return true if the file was decoded
+  static bool Load(const std::string &path, Image &image);
+
+  /// Generates every level below levels[0] down to 1x1, replacing the existing ones. Filtering works on the stored
+  /// values, it does not convert sRGB to linear first.
+  void generateMips(MipFilter filter = MipFilter::Kaiser);
+
+  int getWidth() const;
+  int getHeight() const;
+  int getLevelCount() const;
+
+  /// Gets the bytes the pixels of all levels occupy.
+  size_t getSize() const;
+
+  /// Computes the next level of an RGBA8 image, the destination has to be allocated by the caller.
+  static void Downsample(const ImageLevel &source, ImageLevel &destination, MipFilter filter);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_IMAGE_H_
@@ -25,36 +25,80 @@
 #ifndef RENDOR_INCLUDE_CG_COMMON_INFOIMPORTER_H_
 #define RENDOR_INCLUDE_CG_COMMON_INFOIMPORTER_H_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <future>
+#include "cg/JobSystem.h"
+#include "cg/MemoryTracker.h"
 #include "cg/Mesh.h"
+#include "cg/ScratchAllocator.h"
 
 namespace cg {
 
+/// MeshInfo - Imported vertices and indices. Move-only, so the data travels from the importer to the GPU upload
+/// without being copied, read it through the spans or release it into a Mesh.
 class MeshInfo {
  private:
   std::vector<cg::Vertex> vertices_;
   std::vector<unsigned int> indices_;
+  cg::TrackedMemory memory_;
 
  public:
   MeshInfo() {}
 
-  MeshInfo(std::vector<cg::Vertex> vertices,
-           std::vector<unsigned int> indices) : vertices_(vertices), indices_(indices) {}
+  MeshInfo(std::vector<cg::Vertex> &&vertices,
+           std::vector<unsigned int> &&indices) : vertices_(std::move(vertices)), indices_(std::move(indices)),
+                                                  memory_(cg::MemoryCategory::MeshData) {
+    TrackSize();
+  }
+
+  MeshInfo(const MeshInfo &otherCopy) = delete;
+  MeshInfo &operator=(const MeshInfo &otherCopy) = delete;
+  MeshInfo(MeshInfo &&otherMove) = default;
+  MeshInfo &operator=(MeshInfo &&otherMove) = default;
 
   ~MeshInfo() {}
 
-  const std::vector<cg::Vertex> Vertices() const { return vertices_; }
-  const std::vector<unsigned int> Indices() const { return indices_; }
+  /// Sets the asset the data is accounted to in the MemoryTracker.
+  void SetAssetName(const std::string &name) { memory_.rename(name); }
+
+  cg::Span<const cg::Vertex> Vertices() const { return vertices_; }
+  cg::Span<const unsigned int> Indices() const { return indices_; }
+
+  /// Moves the vertices out, e.g. into a Mesh, leaving this empty.
+  std::vector<cg::Vertex> ReleaseVertices() {
+    std::vector<cg::Vertex> released = std::move(vertices_);
+    vertices_.clear();
+    TrackSize();
+    return released;
+  }
+
+  /// Moves the indices out, e.g. into a Mesh, leaving this empty.
+  std::vector<unsigned int> ReleaseIndices() {
+    std::vector<unsigned int> released = std::move(indices_);
+    indices_.clear();
+    TrackSize();
+    return released;
+  }
+
   size_t Simplify(size_t reduction, float error) {
-    std::vector<unsigned int> simplified(indices_.size());
+    // The result is never larger, so it is written back into the existing index buffer
+    cg::ScratchScope scratch;
+    cg::ArenaVector<unsigned int> simplified(indices_.size());
     size_t before = indices_.size();
     simplified.resize(meshopt_simplify(&simplified[0], &indices_[0], indices_.size(), &vertices_[0].position.x, vertices_.size(),
                                        sizeof(cg::Vertex), indices_.size() - reduction, error));
-    indices_ = simplified;
-    size_t opt = before - simplified.size();
+    indices_.assign(simplified.begin(), simplified.end());
+    size_t opt = before - indices_.size();
     return opt;
   }
+
+ private:
+  void TrackSize() {
+    memory_.resize(vertices_.capacity() * sizeof(cg::Vertex) + indices_.capacity() * sizeof(unsigned int), 0);
+  }
 };
 
 struct OptimizationStats {
@@ -70,46 +114,168 @@ struct OptimizationStats {
   unsigned int indices_after;
 };
 
+/// The steps of an import in the order they run.
+enum class ImportStage {
+  Idle,
+  /// Assimp reads the file and runs its post-processing
+  Reading,
+  /// The scene's mesh is converted into vertices and indices
+  Converting,
+  /// Identical vertices are merged
+  Welding,
+  /// Vertex cache, overdraw and vertex fetch optimization
+  Optimizing,
+  Simplifying,
+  Done,
+  Failed,
+  Cancelled
+};
+
+const char *GetImportStageName(ImportStage stage);
+
+/// ImportStatus - Progress of an import. Written by the import job and read from any thread, e.g. every frame by
+/// the GUI.
+class ImportStatus {
+ private:
+  std::atomic<int> stage_{static_cast<int>(ImportStage::Idle)};
+  std::atomic<float> stage_progress_{0.0f};
+  std::atomic<uint64_t> bytes_processed_{0};
+  std::atomic<uint64_t> bytes_total_{0};
+  std::atomic<uint64_t> start_time_{0};
+  std::atomic<uint64_t> end_time_{0};
+  std::atomic<bool> cancel_requested_{false};
+
+ public:
+  ImportStage GetStage() const;
+
+  /// Gets how far the current stage is, 0 to 1.
+  float GetStageProgress() const;
+
+  /// Gets how far the whole import is, 0 to 1, with every stage weighted by its usual share of the time.
+  float GetProgress() const;
+
+  /// Gets the bytes the current stage processed of its input, the file while reading and the mesh data afterwards.
+  uint64_t GetBytesProcessed() const;
+  uint64_t GetBytesTotal() const;
+
+  double GetElapsedSeconds() const;
+
+  /// Estimates the remaining time from the progress so far.
+  /// \return the seconds, negative while there is too little progress to tell
+  double GetEtaSeconds() const;
+
+  /// \return true from the start of an import until it is done, failed or cancelled
+  bool IsRunning() const;
+
+  /// Asks the import to stop, it does so at the next stage or Assimp progress update.
+  void RequestCancel();
+  bool IsCancelRequested() const;
+
+  /// Resets the status for a new import, called by the import job.
+  void Begin();
+
+  /// Starts a stage, called by the import job.
+  void SetStage(ImportStage stage, uint64_t bytes_total = 0);
+
+  /// Reports progress within the current stage, called by the import job.
+  void SetStageProgress(float progress);
+};
+
+/// AsyncInfoImporter - Imports and optimizes a mesh as a job on the shared JobSystem.
+///
+/// An import can be cancelled at any time: the job checks for it between the optimization stages and tells Assimp
+/// to abort through the progress handler, and frees what it allocated on the way out. Loading another file cancels
+/// the import that is still running without waiting for it, so abandoned loads neither keep a core busy nor stall
+/// the caller.
 class AsyncInfoImporter {
  private:
-  std::future<cg::MeshInfo> future_;
-  bool ready_ = false;
-  float progress = 0.0f;
-  OptimizationStats stats_;
+  // Counts every import job, including cancelled ones that did not stop yet
+  cg::JobCounter job_;
+
+  // Every import has a status of its own, so a new one can start while a cancelled one is still winding down, the
+  // job keeps its status alive until it is done
+  std::shared_ptr<ImportStatus> status_ = std::make_shared<ImportStatus>();
+
+  // Written by the job before it sets ready_, and only if generation_ still is the one it was started with
+  std::mutex result_mutex_;
+  cg::MeshInfo result_;
+  OptimizationStats stats_ = {};
+  uint64_t generation_ = 0;
+  std::atomic<bool> ready_{false};
 
  public:
   AsyncInfoImporter() = default;
-  ~AsyncInfoImporter() {}
 
+  /// Cancels an import that is still running and waits for every import job to stop.
+  ~AsyncInfoImporter();
+
+  /// Starts importing a file without blocking, an import that is still running is cancelled and its result dropped.
   void LoadAsync(const std::string &file);
 
+  /// Asks the running import to stop without waiting for it.
+  void Cancel();
+
+  /// \return true if an import finished and its result was not taken yet
   bool IsReady();
 
+  /// \return true while an import is running
   bool IsBusy();
 
+  /// Takes the result, waiting for the import jobs to finish. Empty if the import failed or was cancelled.
   cg::MeshInfo Get();
 
-  OptimizationStats GetOptimizationStats() { return stats_; }
+  /// Takes the result if an import finished, without waiting.
+  /// \return false if no result is ready, info is left untouched then
+  bool TryGet(cg::MeshInfo &info);
+
+  OptimizationStats GetOptimizationStats();
+
+  /// Gets the status of the latest import, the reference is valid until the next LoadAsync.
+  const ImportStatus &GetStatus() const { return *status_; }
 
   float GetProgress() {
-    return progress;
+    return status_->GetProgress();
   }
 
+  /// The Assimp post-processing steps imports run with.
+  static unsigned int GetImportFlags();
+
+  /// Converts an imported mesh into interleaved vertices and a triangle index list. Available for std::vector and
+  /// cg::ArenaVector.
+  template<typename VertexVector, typename IndexVector>
+  static void ConvertMesh(const aiMesh *mesh, VertexVector &vertices, IndexVector &indices);
+
+  /// Reads a mesh of a file, welds it and optimizes it for the vertex cache, overdraw and vertex fetch. The pipeline
+  /// behind both the asynchronous import and Mesh::ImportData, it runs on any thread.
+  /// \param status receives the stages, the import stops at the next stage once a cancel is requested
+  /// \param flags the Assimp post-processing steps, see GetImportFlags
+  /// \param stats optional, receives the statistics before and after optimizing, which take extra passes
+  /// \return false if the file could not be read, has no such mesh or no triangles, or the import was cancelled, the
+  /// status tells which
+  static bool ImportOptimized(ImportStatus &status, const std::string &file, unsigned int index, unsigned int flags,
+                              std::vector<cg::Vertex> &vertices, std::vector<unsigned int> &indices,
+                              OptimizationStats *stats = nullptr);
+
  private:
   class Handler : public Assimp::ProgressHandler {
    private:
-    AsyncInfoImporter *async_info_importer_;
+    ImportStatus *status_;
 
    public:
-    Handler(AsyncInfoImporter *i) : async_info_importer_(i) {}
+    Handler(ImportStatus *status) : status_(status) {}
 
+    /// \return false to make Assimp abort the import
     bool Update(float percentage) override {
-      async_info_importer_->progress = percentage;
-      return percentage==1.0f;
+      if (percentage >= 0.0f) {
+        status_->SetStageProgress(percentage);
+      }
+      return !status_->IsCancelRequested();
     }
   };
 
-  static cg::MeshInfo ImportMeshInfo(AsyncInfoImporter *importer, const std::string &file, unsigned int index);
+  /// \return false if the import failed or was cancelled, the status tells which
+  static bool ImportMeshInfo(ImportStatus &status, const std::string &file, unsigned int index, cg::MeshInfo &info,
+                             OptimizationStats &stats);
 };
 
 }
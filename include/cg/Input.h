@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_INPUT_H_
+#define RENDOR_INCLUDE_CG_INPUT_H_
+
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <glm/vec2.hpp>
+
+namespace cg {
+
+/// Input - Keyboard and mouse state, sampled once per frame.
+///
+/// The window callbacks only record into a pending state: key and button levels plus whether they went down or up
+/// since the last sample, the latest cursor position and the accumulated scroll. Application::run polls the events
+/// right before the update and calls sample(), after which the update reads a consistent snapshot: a key tapped
+/// within one frame still reports wasKeyPressed, and every cursor event of the frame is coalesced into one delta.
+/// Edges and deltas belong to the frame, not to a simulation step: with a fixed timestep they are read once in
+/// Application::onFrame and handed to the steps from there.
+class Input {
+ public:
+  static const int kKeyCount = GLFW_KEY_LAST + 1;
+  static const int kMouseButtonCount = GLFW_MOUSE_BUTTON_LAST + 1;
+
+ private:
+  enum ButtonBits : uint8_t {
+    Down = 0x01,
+    Pressed = 0x02,
+    Released = 0x04
+  };
+
+  uint8_t pendingKeys[kKeyCount] = {};
+  uint8_t pendingButtons[kMouseButtonCount] = {};
+  glm::dvec2 pendingCursor = glm::dvec2(0.0);
+  glm::dvec2 pendingScroll = glm::dvec2(0.0);
+  bool cursorKnown = false;
+
+  uint8_t keys[kKeyCount] = {};
+  uint8_t buttons[kMouseButtonCount] = {};
+  glm::dvec2 cursor = glm::dvec2(0.0);
+  glm::dvec2 cursorDelta = glm::dvec2(0.0);
+  glm::dvec2 scroll = glm::dvec2(0.0);
+  bool sampledCursor = false;
+
+ public:
+  /// Records a key event, action is GLFW_PRESS, GLFW_REPEAT or GLFW_RELEASE.
+  void recordKey(int key, int action);
+  void recordMouseButton(int button, int action);
+  void recordCursor(double x, double y);
+  void recordScroll(double x, double y);
+
+  /// Takes the snapshot the next frame reads and clears the transitions. Captured devices (e.g. while an ImGui window
+  /// has focus) report no input until they are released, keys held down while capturing read as up.
+  void sample(bool keyboardCaptured, bool mouseCaptured);
+
+  bool isKeyDown(int key) const;
+  /// \return true if the key went down since the previous sample, even if it was released again already
+  bool wasKeyPressed(int key) const;
+  bool wasKeyReleased(int key) const;
+
+  bool isMouseButtonDown(int button) const;
+  bool wasMouseButtonPressed(int button) const;
+  bool wasMouseButtonReleased(int button) const;
+
+  /// Gets the cursor position in screen coordinates relative to the window.
+  glm::vec2 getMousePosition() const;
+  /// Gets how far the cursor moved since the previous sample.
+  glm::vec2 getMouseDelta() const;
+  /// Gets the scroll offset accumulated since the previous sample.
+  glm::vec2 getScrollDelta() const;
+
+ private:
+  static void RecordButton(uint8_t *states, int count, int index, int action);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_INPUT_H_
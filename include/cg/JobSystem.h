@@ -0,0 +1,269 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_JOBSYSTEM_H_
+#define RENDOR_INCLUDE_CG_JOBSYSTEM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cg {
+
+class JobCounter;
+class JobSystem;
+
+/// Job - A function waiting to run on the JobSystem. Functors up to kInlineSize bytes are stored in the job itself,
+/// larger ones are moved to the heap, so starting the usual lambda with a few captures does not allocate.
+class Job {
+  friend class JobSystem;
+
+ public:
+  static const size_t kInlineSize = 48;
+
+ private:
+  typedef void (*Operation)(void *storage);
+
+  template<typename Functor, bool Inline = (sizeof(Functor) <= kInlineSize
+      && alignof(Functor) <= alignof(std::max_align_t))>
+  struct Storage {
+    template<typename F>
+    static void Construct(void *storage, F &&function) {
+      new(storage) Functor(std::forward<F>(function));
+    }
+    static void Invoke(void *storage) {
+      (*static_cast<Functor *>(storage))();
+    }
+    static void Destroy(void *storage) {
+      static_cast<Functor *>(storage)->~Functor();
+    }
+  };
+
+  template<typename Functor>
+  struct Storage<Functor, false> {
+    template<typename F>
+    static void Construct(void *storage, F &&function) {
+      *static_cast<Functor **>(storage) = new Functor(std::forward<F>(function));
+    }
+    static void Invoke(void *storage) {
+      (**static_cast<Functor **>(storage))();
+    }
+    static void Destroy(void *storage) {
+      delete *static_cast<Functor **>(storage);
+    }
+  };
+
+  alignas(std::max_align_t) unsigned char storage[kInlineSize];
+  Operation invoke = nullptr;
+  Operation destroy = nullptr;
+  JobCounter *counter = nullptr;
+
+  /// Jobs come from a per-thread pool (see JobSystem::allocate), busy marks a pooled job that is in use
+  std::atomic<bool> busy;
+  bool pooled = false;
+
+  template<typename F>
+  void assign(F &&function, JobCounter *counter) {
+    typedef Storage<typename std::decay<F>::type> Functor;
+    Functor::Construct(this->storage, std::forward<F>(function));
+    this->invoke = &Functor::Invoke;
+    this->destroy = &Functor::Destroy;
+    this->counter = counter;
+  }
+
+ public:
+  Job() : busy(false) {}
+
+  Job(const Job &otherCopy) = delete;
+  Job(const Job &&otherMove) = delete;
+};
+
+/// JobCounter - Counts the unfinished jobs that were started with it, a job or thread waits for all of them through
+/// JobSystem::wait, and JobSystem::runAfter starts a job once the counter reaches zero.
+class JobCounter {
+  friend class JobSystem;
+
+ private:
+  std::atomic<int> pending;
+  std::mutex mutex;
+  std::vector<Job *> continuations;
+
+  // Threads sleeping in JobSystem::wait, guarded by mutex
+  std::condition_variable done;
+  int waiters = 0;
+
+ public:
+  JobCounter() : pending(0) {}
+
+  /// Waits for the job that finished last to let go of the counter, the counter itself must be done.
+  ~JobCounter() {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+
+  JobCounter(const JobCounter &otherCopy) = delete;
+  JobCounter(const JobCounter &&otherMove) = delete;
+
+  bool isDone() const {
+    return pending.load(std::memory_order_acquire) == 0;
+  }
+};
+
+/// JobSystem - Runs small jobs on a fixed pool of worker threads.
+///
+/// Every worker owns a lock-free work-stealing deque (Chase-Lev): it pushes and pops its own jobs at the bottom, idle
+/// workers steal from the top of a random other deque. The thread that constructed the job system owns a deque as
+/// well, so a job it starts can be stolen right away. Jobs started from any other thread go through a shared queue.
+/// A worker that waits for a counter executes other jobs meanwhile, any other thread spins briefly and then sleeps
+/// until the counter is done, so a frame never waits for an unrelated job it picked up.
+///
+/// Jobs should be short and must not block on anything but JobSystem::wait. Long running work such as an import
+/// may run here too, it just occupies one worker until it is done. Threads that own a deque take their jobs from a
+/// pool of their own, so starting a job does not touch the general heap once the pools are warm.
+class JobSystem {
+ private:
+  class Deque;
+  class Pool;
+
+  std::vector<Deque *> deques;
+  std::vector<Pool *> pools;
+  std::vector<std::thread> workers;
+
+  // Ring of jobs started by threads without a deque
+  std::mutex sharedMutex;
+  std::vector<Job *> shared;
+  size_t sharedHead = 0;
+  size_t sharedCount = 0;
+
+  std::atomic<int> queued;
+  std::atomic<int> sleeping;
+  std::atomic<bool> quit;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+
+ public:
+  /// Starts the workers, the calling thread becomes the owner of deque 0.
+  /// \param workers the number of worker threads in addition to the calling thread
+  explicit JobSystem(unsigned int workers);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &otherCopy) = delete;
+  JobSystem(const JobSystem &&otherMove) = delete;
+
+  /// Gets the shared job system with one worker per hardware thread besides the caller. The first call decides which
+  /// thread owns deque 0, so it should come from the main thread.
+  static JobSystem &Get();
+
+  /// Gets the number of threads that execute jobs, including the owner thread.
+  unsigned int getThreadCount() const;
+
+  /// Starts a job.
+  /// \param job any callable without arguments
+  /// \param counter incremented now and decremented when the job finished, may be null
+  template<typename F>
+  void run(F &&job, JobCounter *counter = nullptr) {
+    Job *allocated = allocate(counter);
+    allocated->assign(std::forward<F>(job), counter);
+    push(allocated);
+  }
+
+  /// Starts a job once every job of the dependency has finished, right away if it already has.
+  /// \param counter incremented now and decremented when the job finished, may be null
+  template<typename F>
+  void runAfter(JobCounter &dependency, F &&job, JobCounter *counter = nullptr) {
+    Job *allocated = allocate(counter);
+    allocated->assign(std::forward<F>(job), counter);
+    pushAfter(dependency, allocated);
+  }
+
+  /// Waits until every job of the counter has finished. Workers execute other jobs meanwhile, other threads sleep.
+  void wait(JobCounter &counter);
+
+  /// Calls body(begin, end) for ranges that together cover [0, count) and returns once all of them are done. The
+  /// calling thread takes part, it only works on the ranges of this call.
+  /// \param grain the smallest range worth a job of its own
+  template<typename Body>
+  void parallelFor(size_t count, size_t grain, const Body &body) {
+    if (count == 0) {
+      return;
+    }
+
+    // A few ranges per thread leave room to balance uneven work through stealing
+    size_t ranges = static_cast<size_t>(getThreadCount()) * 4;
+    size_t size = std::max(std::max(grain, static_cast<size_t>(1)), (count + ranges - 1) / ranges);
+    if (size >= count) {
+      body(static_cast<size_t>(0), count);
+      return;
+    }
+
+    // Every job and the caller claim ranges until none are left, so the caller finishes the ranges no worker got to
+    // and only waits for the ones in progress
+    size_t rangeCount = (count + size - 1) / size;
+    std::atomic<size_t> next(1);
+    auto claim = [&body, &next, rangeCount, size, count]() {
+      for (size_t range = next.fetch_add(1); range < rangeCount; range = next.fetch_add(1)) {
+        body(range * size, std::min((range + 1) * size, count));
+      }
+    };
+
+    JobCounter counter;
+    for (size_t i = 1; i < rangeCount; i++) {
+      run([&claim]() { claim(); }, &counter);
+    }
+    body(static_cast<size_t>(0), size);
+    claim();
+    wait(counter);
+  }
+
+  /// Executes one job that is waiting to run, so a thread can help while it has nothing else to do.
+  /// \return true if a job was executed
+  bool runPending();
+
+ private:
+  /// Takes a job from the calling thread's pool, or from the heap when the pool is exhausted.
+  /// \param counter incremented for the job
+  Job *allocate(JobCounter *counter);
+  void release(Job *job);
+  void push(Job *job);
+  void pushAfter(JobCounter &dependency, Job *job);
+  Job *pop();
+
+  /// Executes the newest job of the calling thread's deque if it was started with the counter.
+  bool runOwn(int index, JobCounter &counter);
+  void execute(Job *job);
+  void finish(JobCounter *counter);
+  int getThreadIndex() const;
+  void work(unsigned int index);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_JOBSYSTEM_H_
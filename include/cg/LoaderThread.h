@@ -0,0 +1,152 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_LOADERTHREAD_H_
+#define RENDOR_INCLUDE_CG_LOADERTHREAD_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cg/HeadlessContext.h"
+#include "cg/Vertex.h"
+#include "cg/common/Program.h"
+
+namespace cg {
+
+class Mesh;
+class ProgramBinaryCache;
+enum class MeshRetention;
+
+/// LoaderThread - Creates and fills OpenGL objects on a thread with its own context, shared with the render context.
+///
+/// Work runs on the loader thread in submission order. After each piece of work the thread inserts a fence, and once
+/// the render thread sees it signalled in update() the work's publish function runs there, so the render thread only
+/// ever binds objects that are complete. Buffers, textures, programs and syncs are shared between the contexts;
+/// vertex arrays and framebuffers are not and have to be created on the render thread (Mesh does so on its first
+/// draw). Without a running loader thread, work and publish run right away on the calling thread. Everything except
+/// the work itself must be called from the render thread.
+class LoaderThread {
+ private:
+  struct Task {
+    std::function<void()> work;
+    std::function<void()> publish;
+  };
+
+  struct Completion {
+    GLsync fence;
+    std::function<void()> publish;
+  };
+
+  struct MeshLoad {
+    Mesh *mesh;
+    std::vector<cg::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+  };
+
+  HeadlessContext context;
+  std::thread thread;
+  bool running = false;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Task> tasks;
+  std::vector<Completion> finished;
+  bool stopping = false;
+
+  // Render thread only
+  std::deque<Completion> completions;
+  std::vector<std::shared_ptr<MeshLoad>> meshLoads;
+  size_t pending = 0;
+
+ public:
+  LoaderThread() = default;
+
+  /// Stops the thread, see stop().
+  ~LoaderThread();
+
+  LoaderThread(const LoaderThread &otherCopy) = delete;
+  LoaderThread(const LoaderThread &&otherMove) = delete;
+
+  /// Creates a context shared with a window's and starts the thread. Must be called on the thread that created the
+  /// window, whose context is current again afterwards.
+  /// \return false if the context could not be created, work then runs on the calling thread
+  bool start(GLFWwindow *share);
+
+  /// Creates a context shared with a headless context and starts the thread, the headless context is current again
+  /// afterwards.
+  /// \return false if the context could not be created, work then runs on the calling thread
+  bool start(int glMajor, int glMinor, HeadlessContext &share);
+
+  /// Finishes the work that is running, drops the work that did not start and the publish functions that did not
+  /// run, and destroys the context. The render context has to be current.
+  void stop();
+
+  bool isRunning() const;
+
+  /// Queues work for the loader thread.
+  /// \param work runs on the loader thread with its context current
+  /// \param publish runs on the render thread in update() once the GPU completed the work's commands
+  void run(std::function<void()> work, std::function<void()> publish = std::function<void()>());
+
+  /// Creates a mesh whose buffers are created and filled on the loader thread. The mesh is drawable, and has its data
+  /// retained as the retention policy asks, once update() published it.
+  Mesh *uploadMesh(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices,
+                   MeshRetention retention);
+
+  /// Compiles and links a program on the loader thread.
+  /// \param done receives the program on the render thread, nullptr if compiling or linking failed
+  /// \param cache optional binary cache the program is loaded from or stored to, see ProgramBinaryCache
+  /// \param defines the permutation defines the stages were built with, part of the cache key
+  void loadProgram(const std::vector<ShaderStageSource> &stages,
+                   std::function<void(std::unique_ptr<ShaderProgram>)> done,
+                   ProgramBinaryCache *cache = nullptr,
+                   const std::string &defines = std::string());
+
+  /// Forgets a mesh that is still loading, its buffers are deleted once they are done. Called by the mesh's
+  /// destructor.
+  void cancel(const Mesh *mesh);
+
+  /// Runs the publish functions of the work the GPU completed, in submission order. Call it once per frame.
+  void update();
+
+  /// Gets the number of submitted pieces of work whose publish functions did not run yet.
+  size_t getPendingCount() const;
+
+ private:
+  void loop();
+  void publishMesh(const std::shared_ptr<MeshLoad> &load);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_LOADERTHREAD_H_
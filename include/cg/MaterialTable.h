@@ -0,0 +1,150 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_MATERIALTABLE_H_
+#define RENDOR_INCLUDE_CG_MATERIALTABLE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "cg/MemoryTracker.h"
+#include "cg/TextureStreamer.h"
+
+namespace cg {
+
+/// Material - Surface parameters of everything drawn with the same material index.
+struct Material {
+  glm::vec4 baseColor = glm::vec4(1.0f);
+  glm::vec3 emissive = glm::vec3(0.0f);
+  float metallic = 0.0f;
+  float roughness = 1.0f;
+
+  /// Multiplied with baseColor, optional. Sampled with whatever levels the streamer has resident.
+  StreamedTexture *baseColorTexture = nullptr;
+};
+
+/// MaterialTable - Every material in one shader storage buffer, so a draw selects its material with an index instead
+/// of setting its parameters and textures.
+///
+/// update() uploads the changed materials and bind() binds the buffer and the textures once for all draws. Shaders
+/// get the table through getGlslDeclarations() and select a material with the E_MATERIAL uniform, which
+/// Mesh::draw sets. With ARB_bindless_texture the materials store texture handles, otherwise the textures are bound
+/// to kTextureSlots units and the materials store the unit, which limits a table to that many different textures.
+/// Textures have to stay loaded while a material refers to them. Must be used on the thread that owns the OpenGL
+/// context.
+class MaterialTable {
+ public:
+  /// Shader storage buffer binding of the table
+  static const unsigned int kBinding = 3;
+
+  /// Texture units used without bindless textures, starting at unit 0
+  static const unsigned int kTextureSlots = 16;
+
+  static const uint32_t kNoTexture = 0xFFFFFFFFu;
+
+ private:
+  /// Layout of a material in the buffer, matches the std430 struct in getGlslDeclarations()
+  struct GpuMaterial {
+    glm::vec4 baseColor;
+    glm::vec3 emissive;
+    float metallic;
+    float roughness;
+    uint32_t flags;
+    uint32_t baseColorSlot;
+    uint32_t padding;
+    uint64_t baseColorHandle;
+    uint64_t padding2;
+  };
+
+  /// A texture the materials refer to, its index is the unit it is bound to without bindless textures.
+  struct TextureBinding {
+    StreamedTexture *texture;
+    unsigned int name;
+    int residentLevel;
+    unsigned int view;
+    GLuint64 handle;
+  };
+
+  /// A bindless view that was replaced, deleted once the frames that may still use it are done.
+  struct RetiredView {
+    unsigned int view;
+    GLuint64 handle;
+    uint64_t frame;
+  };
+
+  bool bindless;
+  std::vector<Material> materials;
+  std::vector<GpuMaterial> records;
+  bool dirty = false;
+
+  std::vector<TextureBinding> textures;
+  std::vector<unsigned int> slotNames;
+  std::vector<RetiredView> retired;
+  uint64_t frame = 0;
+
+  unsigned int buffer = 0;
+  size_t capacity = 0;
+  TrackedMemory memory{MemoryCategory::Buffer, "Materials"};
+
+ public:
+  /// Creates an empty table, bindless textures are used if the context supports them.
+  MaterialTable();
+  ~MaterialTable();
+
+  MaterialTable(const MaterialTable &otherCopy) = delete;
+  MaterialTable(const MaterialTable &&otherMove) = delete;
+
+  /// \return the index of the new material
+  uint32_t add(const Material &material);
+  void set(uint32_t index, const Material &material);
+  const Material &get(uint32_t index) const;
+  size_t size() const;
+
+  /// \return true if textures are accessed through ARB_bindless_texture handles
+  bool isBindless() const;
+
+  /// Gets the GLSL that declares the table, to be inserted right after the '#version' line since it may enable an
+  /// extension. It declares 'Material materials[]', 'uniform uint E_MATERIAL' and
+  /// 'vec4 SampleBaseColor(Material material, vec2 uv)'.
+  std::string getGlslDeclarations() const;
+
+  /// Uploads changed materials and follows textures whose resident levels changed. Call it once per frame before
+  /// drawing, after TextureStreamer::update.
+  void update();
+
+  /// Binds the table and its textures for every draw that follows.
+  void bind();
+
+ private:
+  uint32_t findTexture(StreamedTexture *texture);
+  void refreshTexture(TextureBinding &binding);
+  void upload();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_MATERIALTABLE_H_
@@ -0,0 +1,164 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_MEMORYTRACKER_H_
+#define RENDOR_INCLUDE_CG_MEMORYTRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cg {
+
+/// What a tracked resource is, the categories the memory totals are broken down into.
+enum class MemoryCategory {
+  /// Vertices and indices kept in system memory, by a Mesh or a MeshInfo
+  MeshData,
+  /// OpenGL buffer objects
+  Buffer,
+  /// Vertex array objects, counted but without a size since the driver does not report one
+  VertexArray,
+  /// Linked programs, sized by their program binary
+  Program,
+  Texture,
+  Framebuffer,
+  Other
+};
+
+static const size_t kMemoryCategoryCount = 7;
+
+const char *GetMemoryCategoryName(MemoryCategory category);
+
+struct MemoryUsage {
+  size_t cpuBytes = 0;
+  size_t gpuBytes = 0;
+
+  /// Number of registered resources
+  size_t resources = 0;
+};
+
+/// AssetMemory - Everything registered under one asset name.
+struct AssetMemory {
+  std::string name;
+  MemoryUsage total;
+  MemoryUsage categories[kMemoryCategoryCount];
+};
+
+/// MemoryTracker - Accounts the CPU and GPU memory of every resource under a category and an asset name.
+///
+/// Resources register themselves through a TrackedMemory member and update their sizes when they change, so the
+/// totals are always current. Sizes are what the resource asked for (vector capacities, buffer sizes), not what the
+/// allocator or driver really reserved. All functions may be called from any thread.
+class MemoryTracker {
+ public:
+  static const uint32_t kInvalid = 0xFFFFFFFFu;
+
+ private:
+  struct Record {
+    MemoryCategory category;
+    std::string asset;
+    size_t cpuBytes;
+    size_t gpuBytes;
+    bool live;
+  };
+
+  mutable std::mutex mutex;
+  std::vector<Record> records;
+  std::vector<uint32_t> freeRecords;
+
+  MemoryUsage totals[kMemoryCategoryCount];
+  MemoryUsage highWater[kMemoryCategoryCount];
+  MemoryUsage total;
+  MemoryUsage totalHighWater;
+
+  size_t cpuBudget = 0;
+  size_t gpuBudget = 0;
+
+  MemoryTracker() = default;
+
+ public:
+  MemoryTracker(const MemoryTracker &otherCopy) = delete;
+  MemoryTracker(const MemoryTracker &&otherMove) = delete;
+
+  static MemoryTracker &Get();
+
+  /// Registers a resource, prefer a TrackedMemory member.
+  /// \return the id to update and remove the resource with
+  uint32_t add(MemoryCategory category, const std::string &asset, size_t cpuBytes, size_t gpuBytes);
+  void resize(uint32_t id, size_t cpuBytes, size_t gpuBytes);
+  void rename(uint32_t id, const std::string &asset);
+  void remove(uint32_t id);
+
+  MemoryUsage getTotal() const;
+  MemoryUsage getTotal(MemoryCategory category) const;
+
+  /// Gets the largest totals seen since the start or the last resetHighWater. CPU and GPU bytes peak independently.
+  MemoryUsage getHighWater() const;
+  MemoryUsage getHighWater(MemoryCategory category) const;
+  void resetHighWater();
+
+  /// Gets the memory of every asset, the largest first. Resources registered without a name are listed under an
+  /// empty one.
+  std::vector<AssetMemory> getAssets() const;
+
+  /// Sets the totals isOverBudget compares against, 0 means no budget.
+  void setBudget(size_t cpuBytes, size_t gpuBytes);
+
+  /// \return true if the CPU or GPU total is above its budget
+  bool isOverBudget() const;
+
+  /// Draws the memory window with the totals per category and the per-asset breakdown.
+  void showWindow(bool *open = nullptr);
+
+ private:
+  void account(MemoryCategory category, int64_t cpuBytes, int64_t gpuBytes, int64_t resources);
+};
+
+/// TrackedMemory - Registers a resource with the MemoryTracker for as long as it lives. Movable, so it can be a
+/// member of movable resources.
+class TrackedMemory {
+ private:
+  uint32_t id = MemoryTracker::kInvalid;
+
+ public:
+  TrackedMemory() = default;
+  explicit TrackedMemory(MemoryCategory category, const std::string &asset = std::string(), size_t cpuBytes = 0,
+                         size_t gpuBytes = 0);
+  ~TrackedMemory();
+
+  TrackedMemory(const TrackedMemory &otherCopy) = delete;
+  TrackedMemory &operator=(const TrackedMemory &otherCopy) = delete;
+  TrackedMemory(TrackedMemory &&otherMove) noexcept;
+  TrackedMemory &operator=(TrackedMemory &&otherMove) noexcept;
+
+  /// Sets the current size, does nothing if the resource is not registered.
+  void resize(size_t cpuBytes, size_t gpuBytes);
+  void rename(const std::string &asset);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_MEMORYTRACKER_H_
@@ -26,6 +26,8 @@
 #define RENDOR_INCLUDE_CG_MESH_H_
 
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <meshoptimizer.h>
 #include <glad/glad.h>
@@ -36,145 +38,307 @@
 #include <assimp/ProgressHandler.hpp>
 
 #include "cg/common/VertexArray.h"
+#include "cg/LoaderThread.h"
+#include "cg/MemoryTracker.h"
+#include "cg/MeshUploader.h"
+#include "cg/Span.h"
 #include "cg/Vertex.h"
+#include "cg/VertexWelder.h"
 #include "cg/common/Shader.h"
 #include "cg/common/Program.h"
+#include "cg/common/ProgramPipeline.h"
 
 #include <future>
 #include <thread>
 
 namespace cg {
 
+/// What a Mesh keeps in system memory once its data is on the GPU.
+enum class MeshRetention {
+  /// Vertices and indices, e.g. to process the mesh again later
+  Keep,
+
+  /// Nothing, the GPU buffers are the only copy
+  DropAfterUpload,
+
+  /// Positions and indices, enough for picking and collision
+  PositionsOnly
+};
+
 class Mesh {
+  friend class LoaderThread;
+  friend class MeshUploader;
+
  public:
+  std::vector<cg::Vertex> boundingBoxVertices;
+ private:
+  // Vertex arrays are not shared between contexts, it is created by the first draw on the thread that draws
+  std::unique_ptr<cg::VertexArray> vao;
+  unsigned int vertexBuffer = 0;
+  unsigned int indexBuffer = 0;
+  std::string assetName;
+
+  MeshRetention retention;
+  size_t vertexCount;
+  size_t indexCount;
+
+  // What the GPU buffers hold, the low detail version while the mesh is evicted
+  size_t gpuIndexCount = 0;
+  size_t gpuSize = 0;
+  bool lowDetail = false;
+
+  // Set while a MeshUploader or LoaderThread still fills the buffers, the mesh is not drawn until they are complete
+  MeshUploader *uploader = nullptr;
+  LoaderThread *loader = nullptr;
+  bool drawable = true;
+
   std::vector<cg::Vertex> vertices;
+  std::vector<glm::vec3> positions;
   std::vector<unsigned int> indices;
 
-  std::vector<cg::Vertex> boundingBoxVertices;
- private:
-  cg::VertexArray vao;
-  unsigned int vertexBuffer;
-  unsigned int indexBuffer;
+  TrackedMemory bufferMemory{MemoryCategory::Buffer};
+  TrackedMemory dataMemory{MemoryCategory::MeshData};
 
  public:
-  Mesh(std::vector<cg::Vertex> verts, std::vector<unsigned int> indices)
-      : vertices(verts), indices(indices) {
-
-    vao.bind();
-    glGenBuffers(1, &vertexBuffer);
-    glGenBuffers(1, &indexBuffer);
+  /// Takes the data over without copying it, uploads it and keeps what the retention policy asks for.
+  Mesh(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices,
+       MeshRetention retention = MeshRetention::Keep)
+      : retention(retention), vertexCount(vertices.size()), indexCount(indices.size()) {
+    upload(vertices, indices);
+    retain(std::move(vertices), std::move(indices));
+  }
 
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(vertices[0]), &vertices[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, position));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, color));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, normal));
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  /// Uploads data owned by someone else, only what the retention policy asks for is copied.
+  Mesh(Span<const cg::Vertex> vertices, Span<const unsigned int> indices,
+       MeshRetention retention = MeshRetention::Keep)
+      : retention(retention), vertexCount(vertices.size()), indexCount(indices.size()) {
+    upload(vertices, indices);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(indices[0]), &indices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    vao.unbind();
+    if (retention == MeshRetention::Keep) {
+      this->vertices.assign(vertices.begin(), vertices.end());
+    } else if (retention == MeshRetention::PositionsOnly) {
+      retainPositions(vertices);
+    }
+    if (retention != MeshRetention::DropAfterUpload) {
+      this->indices.assign(indices.begin(), indices.end());
+    }
+    trackRetained();
   }
+
   ~Mesh() {
+    if (uploader) {
+      uploader->cancel(this);
+    }
+    if (loader) {
+      loader->cancel(this);
+    }
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+  }
+
+  Mesh(const Mesh &otherCopy) = delete;
+  Mesh(const Mesh &&otherMove) = delete;
+
+  /// Sets the asset the mesh's buffers and retained data are accounted to in the MemoryTracker.
+  void setAssetName(const std::string &name) {
+    assetName = name;
+    if (vao) {
+      vao->setAssetName(name);
+    }
+    bufferMemory.rename(name);
+    dataMemory.rename(name);
+  }
+
+  MeshRetention getRetention() const { return retention; }
+  size_t getVertexCount() const { return vertexCount; }
+  size_t getIndexCount() const { return indexCount; }
+
+  /// Gets the bytes of the vertex and index buffers on the GPU.
+  size_t getGpuSize() const { return gpuSize; }
+
+  /// \return true while the GPU buffers hold a low detail version, see replaceGpuData
+  bool isLowDetail() const { return lowDetail; }
+
+  /// \return false while a MeshUploader or LoaderThread still fills the buffers, draw() does nothing until then
+  bool isDrawable() const { return drawable; }
+
+  /// Replaces the vertex and index buffers, e.g. with a low detail version to free video memory and later with the
+  /// full mesh again. The retained data and the vertex and index counts are those of the full mesh and only change
+  /// when the full mesh is uploaded.
+  /// \param lowDetail true if the data is a low detail version of the mesh
+  void replaceGpuData(Span<const cg::Vertex> vertices, Span<const unsigned int> indices, bool lowDetail) {
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteBuffers(1, &indexBuffer);
+    upload(vertices, indices);
+    this->lowDetail = lowDetail;
+    if (!lowDetail) {
+      vertexCount = vertices.size();
+      indexCount = indices.size();
+    }
   }
 
-  void draw(cg::ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection) {
+  /// Gets the retained vertices, empty unless the mesh was created with MeshRetention::Keep.
+  Span<const cg::Vertex> getVertices() const { return vertices; }
+
+  /// Gets the retained positions, empty unless the mesh was created with MeshRetention::PositionsOnly.
+  Span<const glm::vec3> getPositions() const { return positions; }
+
+  /// Gets the retained indices, empty if the mesh was created with MeshRetention::DropAfterUpload.
+  Span<const unsigned int> getIndices() const { return indices; }
+
+  /// Draws the mesh with a program.
+  /// \param material index into the bound MaterialTable, set as the E_MATERIAL uniform
+  void draw(cg::ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+            uint32_t material = 0) {
     glm::mat4 mvp = projection*view*model;
 
-    vao.bind();
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    if (!drawable) {
+      return;
+    }
+
+    bindVertexArray();
 
     glUseProgram(program->getHandle());
     program->setUniformMat4f("E_MODEL", model);
     program->setUniformMat4f("E_VIEW", view);
     program->setUniformMat4f("E_PROJ", projection);
-    program->setUniform4f("color", glm::vec4(1.0f, 0.7f, 0.3f, 1.0f));
+    program->setUniform1u("E_MATERIAL", material);
+
+    glDrawElements(GL_TRIANGLES, gpuIndexCount, GL_UNSIGNED_INT, 0);
+  }
+
+  void draw(cg::ProgramPipeline *pipeline, glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+            uint32_t material = 0) {
+    cg::ShaderProgram *vertexStage = pipeline->getStageProgram(cg::ShaderType::VertexShader);
+    cg::ShaderProgram *fragmentStage = pipeline->getStageProgram(cg::ShaderType::FragmentShader);
+
+    if (!drawable) {
+      return;
+    }
+
+    bindVertexArray();
+
+    pipeline->bind();
+    if (vertexStage) {
+      vertexStage->setUniformMat4f("E_MODEL", model);
+      vertexStage->setUniformMat4f("E_VIEW", view);
+      vertexStage->setUniformMat4f("E_PROJ", projection);
+    }
+    if (fragmentStage) {
+      fragmentStage->setUniform1u("E_MATERIAL", material);
+    }
 
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, gpuIndexCount, GL_UNSIGNED_INT, 0);
   }
 
-  static Mesh *LoadMesh(const std::string file, unsigned int index) {
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(file, aiProcess_Triangulate | aiProcess_OptimizeGraph
-        | aiProcess_OptimizeMeshes | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices
-    );
-    if (!scene) {
-      std::cerr << "Import error: " << importer.GetErrorString() << "\n";
+  static Mesh *LoadMesh(const std::string file, unsigned int index, MeshRetention retention = MeshRetention::Keep) {
+    std::vector<cg::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    if (!ImportData(file, index, vertices, indices)) {
       return nullptr;
     }
 
-    aiMesh *mesh = scene->mMeshes[index];
-    std::vector<cg::Vertex> verts;
-    std::vector<unsigned int> inds;
-    for (int i = 0; i < mesh->mNumVertices; ++i) {
-      cg::Vertex vertex;
-      vertex.position.x = mesh->mVertices[i].x;
-      vertex.position.y = mesh->mVertices[i].y;
-      vertex.position.z = mesh->mVertices[i].z;
-      vertex.normal.x = mesh->mNormals[i].x;
-      vertex.normal.y = mesh->mNormals[i].y;
-      vertex.normal.z = mesh->mNormals[i].z;
-      verts.push_back(vertex);
+    Mesh *loaded = new Mesh(std::move(vertices), std::move(indices), retention);
+    loaded->setAssetName(file);
+    return loaded;
+  }
+
+  /// Imports and optimizes the data LoadMesh uploads without creating any OpenGL objects, so it can run on any thread.
+  /// \return false if the file could not be imported, has no mesh with that index or the mesh has no triangles
+  static bool ImportData(const std::string &file, unsigned int index, std::vector<cg::Vertex> &vertices,
+                         std::vector<unsigned int> &indices);
+
+ private:
+  /// Creates an undrawable mesh without any OpenGL objects, for a MeshUploader or LoaderThread to give buffers.
+  Mesh(size_t vertexCount, size_t indexCount, MeshRetention retention)
+      : retention(retention), vertexCount(vertexCount), indexCount(indexCount), drawable(false) {}
+
+  void upload(Span<const cg::Vertex> vertices, Span<const unsigned int> indices) {
+    allocate(vertices.sizeBytes(), vertices.data(), indices.size(), indices.data());
+  }
+
+  /// Creates the buffers, the data may be nullptr to leave them uninitialized.
+  void allocate(size_t vertexBytes, const void *vertexData, size_t indexCount, const void *indexData) {
+    unsigned int createdVertexBuffer;
+    unsigned int createdIndexBuffer;
+    CreateBuffers(vertexBytes, vertexData, indexCount * sizeof(unsigned int), indexData, createdVertexBuffer,
+                  createdIndexBuffer);
+    setBuffers(createdVertexBuffer, createdIndexBuffer, indexCount, vertexBytes + indexCount * sizeof(unsigned int));
+  }
+
+  /// Creates and fills buffers without touching any other state, so it can run on a context shared with the one
+  /// that draws.
+  static void CreateBuffers(size_t vertexBytes, const void *vertexData, size_t indexBytes, const void *indexData,
+                            unsigned int &vertexBuffer, unsigned int &indexBuffer) {
+    glCreateBuffers(1, &vertexBuffer);
+    glNamedBufferData(vertexBuffer, vertexBytes, vertexData, GL_STATIC_DRAW);
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferData(indexBuffer, indexBytes, indexData, GL_STATIC_DRAW);
+  }
+
+  /// Takes over buffers, the vertex array is set up again by the next draw.
+  void setBuffers(unsigned int vertexBuffer, unsigned int indexBuffer, size_t indexCount, size_t size) {
+    this->vertexBuffer = vertexBuffer;
+    this->indexBuffer = indexBuffer;
+    vao.reset();
+
+    gpuIndexCount = indexCount;
+    gpuSize = size;
+    bufferMemory.resize(0, gpuSize);
+  }
+
+  void bindVertexArray() {
+    if (vao) {
+      vao->bind();
+      return;
     }
 
-    for (int j = 0; j < mesh->mNumFaces; ++j) {
-      aiFace face = mesh->mFaces[j];
-      for (int i = 0; i < face.mNumIndices; ++i) {
-        inds.push_back(face.mIndices[i]);
+    vao.reset(new cg::VertexArray());
+    vao->setAssetName(assetName);
+    vao->bind();
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, color));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, normal));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(cg::Vertex), (const void *) offsetof(cg::Vertex, uv));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  }
+
+  /// Keeps what the retention policy asks for of the uploaded data.
+  void retain(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices) {
+    switch (retention) {
+      case MeshRetention::Keep: {
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        break;
+      }
+      case MeshRetention::PositionsOnly: {
+        retainPositions(vertices);
+        this->indices = std::move(indices);
+        break;
+      }
+      case MeshRetention::DropAfterUpload: {
+        break;
       }
     }
+    trackRetained();
+  }
 
-    verts.shrink_to_fit();
-    inds.shrink_to_fit();
-    size_t indexCount = inds.size();
-
-    std::vector<unsigned int> remap(indexCount);
-    size_t vertexCount =
-        meshopt_generateVertexRemap(&remap[0], &inds[0], indexCount, &verts[0], verts.size(), sizeof(cg::Vertex));
-
-    std::vector<cg::Vertex> finalVertices(vertexCount);
-    std::vector<unsigned int> finalIndices(indexCount);
-
-    meshopt_remapIndexBuffer(&finalIndices[0], &inds[0], indexCount, &remap[0]);
-    meshopt_remapVertexBuffer(&finalVertices[0], &verts[0], vertexCount, sizeof(cg::Vertex), &remap[0]);
-
-    meshopt_VertexCacheStatistics
-        beforeVertexCache = meshopt_analyzeVertexCache(&finalIndices[00], indexCount, vertexCount, 32, 32, 32);
-    meshopt_OverdrawStatistics beforeOverdraw =
-        meshopt_analyzeOverdraw(&finalIndices[0], indexCount, &finalVertices[0].position.x, vertexCount,
-                                sizeof(cg::Vertex));
-    meshopt_VertexFetchStatistics beforeFetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
-                                                                           sizeof(cg::Vertex));
-
-    meshopt_optimizeVertexCache(&finalIndices[0], &finalIndices[0], indexCount, vertexCount);
-
-    meshopt_optimizeOverdraw(&finalIndices[0],
-                             &finalIndices[0],
-                             indexCount,
-                             &finalVertices[0].position.x,
-                             vertexCount,
-                             sizeof(cg::Vertex),
-                             1.05f);
-
-    meshopt_optimizeVertexFetch(&finalVertices[0], &finalIndices[0], indexCount, &finalVertices[0], vertexCount,
-                                sizeof(cg::Vertex));
-
-    meshopt_VertexCacheStatistics
-        afterVertexCache = meshopt_analyzeVertexCache(&finalIndices[00], indexCount, vertexCount, 32, 32, 32);
-    meshopt_OverdrawStatistics
-        afterOverdraw = meshopt_analyzeOverdraw(&finalIndices[0], indexCount, &finalVertices[0].position.x, vertexCount,
-                                                sizeof(cg::Vertex));
-    meshopt_VertexFetchStatistics afterFetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
-                                                                          sizeof(cg::Vertex));
-
-    return new Mesh(finalVertices, finalIndices);
+  void trackRetained() {
+    dataMemory.resize(vertices.capacity() * sizeof(cg::Vertex) + positions.capacity() * sizeof(glm::vec3)
+                          + indices.capacity() * sizeof(unsigned int), 0);
+  }
+
+  void retainPositions(Span<const cg::Vertex> vertices) {
+    positions.reserve(vertices.size());
+    for (const cg::Vertex &vertex : vertices) {
+      positions.push_back(vertex.position);
+    }
   }
 };
 
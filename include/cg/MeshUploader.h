@@ -0,0 +1,135 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_MESHUPLOADER_H_
+#define RENDOR_INCLUDE_CG_MESHUPLOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <glad/glad.h>
+
+#include "cg/MemoryTracker.h"
+#include "cg/Span.h"
+#include "cg/Vertex.h"
+
+namespace cg {
+
+class Mesh;
+enum class MeshRetention;
+
+struct MeshUploadSettings {
+  /// Bytes copied into the staging buffer per frame, bounds the time update() spends on uploads
+  size_t bytesPerFrame = 4 * 1024 * 1024;
+};
+
+struct MeshUploadStats {
+  /// Meshes with data left to copy
+  size_t pending = 0;
+  size_t pendingBytes = 0;
+
+  /// Meshes whose copies were issued, waiting for the GPU to complete them
+  size_t completing = 0;
+
+  /// Bytes copied during the last update()
+  size_t uploadedBytes = 0;
+
+  /// Meshes that became drawable during the last update()
+  uint32_t completed = 0;
+
+  /// update() calls that skipped copying because the GPU still read the staging region
+  uint64_t stalls = 0;
+};
+
+/// MeshUploader - Fills mesh buffers over several frames instead of in one glBufferData call.
+///
+/// The data is copied into a persistently mapped staging buffer that is split into a ring of regions, one per frame
+/// in flight, and from there into the mesh buffers with glCopyNamedBufferSubData, at most bytesPerFrame per frame.
+/// A region is only written again once the fence of the frame that last used it signalled. Meshes are drawable once
+/// the fence after their last copy signalled; until then Mesh::draw does nothing. If the staging buffer cannot be
+/// mapped, the data goes straight into the mesh buffers with glNamedBufferSubData instead, still bytesPerFrame at a
+/// time. Must be used on the thread that owns the OpenGL context.
+class MeshUploader {
+ private:
+  static const int kRegions = 3;
+
+  struct Upload {
+    Mesh *mesh;
+    std::vector<cg::Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    // Bytes of the vertices and indices copied so far
+    size_t vertexOffset = 0;
+    size_t indexOffset = 0;
+  };
+
+  struct Completion {
+    Mesh *mesh;
+    GLsync fence;
+  };
+
+  MeshUploadSettings settings;
+  MeshUploadStats stats;
+
+  unsigned int staging = 0;
+  uint8_t *mapped = nullptr;
+  size_t regionSize = 0;
+  TrackedMemory stagingMemory{MemoryCategory::Buffer, "Mesh staging"};
+  GLsync regionFences[kRegions] = {};
+  int region = 0;
+
+  std::deque<Upload> uploads;
+  std::vector<Completion> completions;
+
+ public:
+  explicit MeshUploader(const MeshUploadSettings &settings = MeshUploadSettings());
+
+  /// Deletes the staging buffer, meshes that are still uploading stay undrawable.
+  ~MeshUploader();
+
+  MeshUploader(const MeshUploader &otherCopy) = delete;
+  MeshUploader(const MeshUploader &&otherMove) = delete;
+
+  /// Creates a mesh with empty buffers and queues its data, the mesh is drawable once update() finished the copies.
+  /// The data is kept until then and afterwards retained as the retention policy asks.
+  Mesh *upload(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices,
+               MeshRetention retention);
+
+  /// Removes a mesh from the queue, the mesh stays undrawable. Called by the mesh's destructor.
+  void cancel(const Mesh *mesh);
+
+  /// Makes the meshes whose copies completed drawable and issues the copies of this frame. Call it once per frame.
+  void update();
+
+  const MeshUploadSettings &getSettings() const;
+  const MeshUploadStats &getStats() const;
+
+ private:
+  size_t copy(unsigned int buffer, const void *source, size_t sourceSize, size_t &sourceOffset, size_t &offset);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_MESHUPLOADER_H_
@@ -0,0 +1,193 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_PROFILER_H_
+#define RENDOR_INCLUDE_CG_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cg {
+
+/// ProfileEvent - A timed scope. Times are nanoseconds on the profiler's clock (see Profiler::Now), GPU times are
+/// translated onto the same clock.
+struct ProfileEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+  uint32_t depth;
+  uint32_t thread;
+};
+
+/// ProfileFrame - Every event recorded between two Profiler::beginFrame calls.
+struct ProfileFrame {
+  uint64_t index = 0;
+  uint64_t start = 0;
+  uint64_t end = 0;
+  std::vector<ProfileEvent> cpuEvents;
+  std::vector<ProfileEvent> gpuEvents;
+  bool gpuResolved = false;
+};
+
+/// Profiler - Hierarchical CPU/GPU frame profiler.
+///
+/// CPU scopes (CG_PROFILE_SCOPE) are recorded into a per-thread ring buffer that only its own thread writes and only
+/// the profiler reads, so recording never takes a lock. GPU scopes (CG_PROFILE_GPU_SCOPE) write GL_TIMESTAMP queries
+/// from a ring that is several frames deep; results are read back once the driver reports them available, so the
+/// profiler never stalls the pipeline. The frame boundary calls and GPU scopes must come from the thread that owns
+/// the OpenGL context. Application::run profiles its own frame phases.
+class Profiler {
+ public:
+  static const uint32_t kGpuThread = 0xFFFFFFFFu;
+
+ private:
+  struct ThreadBuffer;
+  struct GpuFrame;
+
+  std::atomic<bool> enabled;
+  bool paused = false;
+  int selectedFrame = 0;
+  std::string exportMessage;
+
+  std::mutex threadsMutex;
+  std::vector<ThreadBuffer *> threads;
+
+  // Ring of recorded frames, once it is full the oldest frame's buffers are reused for the next one
+  std::vector<ProfileFrame> frames;
+  size_t oldestFrame = 0;
+  size_t historySize = 300;
+  ProfileFrame current;
+  // Made by setHistorySize for the history to take while it grows, so recording a frame does not allocate
+  std::vector<ProfileFrame> spareFrames;
+  std::vector<float> frameTimes;
+  uint64_t frameCounter = 0;
+
+  std::vector<GpuFrame *> gpuFrames;
+  size_t gpuFrameIndex = 0;
+  GpuFrame *activeGpuFrame = nullptr;
+  int64_t gpuClockOffset = 0;
+  bool gpuInitialized = false;
+
+  Profiler();
+  ~Profiler();
+
+ public:
+  static Profiler &Get();
+
+  /// Gets the current time on the profiler's clock in nanoseconds.
+  static uint64_t Now();
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const;
+
+  /// Keeps the recorded history, but stops adding frames to it.
+  void setPaused(bool paused);
+  bool isPaused() const;
+
+  /// Sets how many frames are kept, 300 by default. The frames the history still grows by are made right away, with
+  /// room for the events of a usual frame.
+  void setHistorySize(size_t frames);
+
+  /// Waits for the GPU and resolves every pending GPU scope, e.g. before reading the results at exit.
+  void flush();
+
+  /// Names the calling thread in the profiler window and in exported traces.
+  void setThreadName(const std::string &name);
+
+  void beginFrame();
+  void endFrame();
+
+  /// Starts a CPU scope on the calling thread, prefer CG_PROFILE_SCOPE.
+  /// \return true if the scope is recorded and endCpuScope has to be called
+  bool beginCpuScope(const char *name);
+  void endCpuScope();
+
+  /// Starts a GPU scope, prefer CG_PROFILE_GPU_SCOPE.
+  /// \return true if the scope is recorded and endGpuScope has to be called
+  bool beginGpuScope(const char *name);
+  void endGpuScope();
+
+  /// Gets the number of recorded frames.
+  size_t getFrameCount() const;
+
+  /// Gets a recorded frame, 0 is the oldest.
+  const ProfileFrame &getFrame(size_t index) const;
+
+  /// Draws the profiler window with the frame time graph and a timeline of the selected frame.
+  void showWindow(bool *open = nullptr);
+
+  /// Writes the recorded frames in Chrome's trace event format (chrome://tracing, Perfetto, Speedscope).
+  /// \return true if the file was written
+  bool exportChromeTrace(const std::string &path);
+
+  /// Deletes the GPU query objects. Must be called while the OpenGL context is still current.
+  void releaseGpuResources();
+
+ private:
+  ThreadBuffer *getThreadBuffer();
+  void collectCpuEvents();
+  void resolveGpuFrames();
+  ProfileFrame *findFrame(uint64_t index);
+  std::string getThreadName(uint32_t thread);
+};
+
+/// ProfileScope - Records a CPU scope from construction to destruction.
+class ProfileScope {
+ private:
+  bool active;
+
+ public:
+  explicit ProfileScope(const char *name) : active(Profiler::Get().beginCpuScope(name)) {}
+  ~ProfileScope() {
+    if (active) Profiler::Get().endCpuScope();
+  }
+};
+
+/// GpuProfileScope - Records a GPU scope around the commands issued between construction and destruction.
+class GpuProfileScope {
+ private:
+  bool active;
+
+ public:
+  explicit GpuProfileScope(const char *name) : active(Profiler::Get().beginGpuScope(name)) {}
+  ~GpuProfileScope() {
+    if (active) Profiler::Get().endGpuScope();
+  }
+};
+
+}
+
+#define CG_PROFILE_CONCAT_INNER(a, b) a##b
+#define CG_PROFILE_CONCAT(a, b) CG_PROFILE_CONCAT_INNER(a, b)
+
+/// Profiles the enclosing scope on the CPU. The name must be a string with static storage duration.
+#define CG_PROFILE_SCOPE(name) cg::ProfileScope CG_PROFILE_CONCAT(cgProfileScope, __LINE__)(name)
+
+/// Profiles the GL commands issued in the enclosing scope. The name must be a string with static storage duration.
+#define CG_PROFILE_GPU_SCOPE(name) cg::GpuProfileScope CG_PROFILE_CONCAT(cgGpuProfileScope, __LINE__)(name)
+
+#endif //RENDOR_INCLUDE_CG_PROFILER_H_
@@ -0,0 +1,173 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_RESIDENCYMANAGER_H_
+#define RENDOR_INCLUDE_CG_RESIDENCYMANAGER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "cg/JobSystem.h"
+#include "cg/MemoryTracker.h"
+#include "cg/Mesh.h"
+#include "cg/Vertex.h"
+
+namespace cg {
+
+/// Loads the full data of a mesh again, e.g. by importing its file. Runs on a JobSystem worker.
+/// \return false if the data could not be loaded
+typedef std::function<bool(std::vector<cg::Vertex> &vertices, std::vector<unsigned int> &indices)> MeshLoader;
+
+struct ResidencySettings {
+  /// Video memory the vertex and index buffers of all meshes may occupy together
+  size_t budget = 512 * 1024 * 1024;
+
+  /// Share of the triangles the low detail version of an evicted mesh keeps
+  float lowDetailRatio = 0.02f;
+
+  /// Triangles the low detail version keeps at least
+  size_t lowDetailTriangles = 64;
+
+  /// Frames a mesh has to be out of view before it may be evicted
+  uint64_t evictionDelay = 2;
+
+  /// Meshes that are loaded again at the same time
+  size_t maxStreamIns = 4;
+};
+
+struct ResidencyStats {
+  size_t meshes = 0;
+
+  /// Meshes with only their low detail version on the GPU
+  size_t evicted = 0;
+
+  /// Evicted meshes that are being loaded again
+  size_t streaming = 0;
+
+  /// Video memory of the vertex and index buffers
+  size_t residentBytes = 0;
+
+  /// Meshes evicted and brought back during the last update()
+  uint32_t evictions = 0;
+  uint32_t streamIns = 0;
+};
+
+/// ResidencyManager - Keeps the geometry of registered meshes within a video memory budget.
+///
+/// When the budget is exceeded, the meshes that were out of view the longest are evicted: their buffers are replaced
+/// with a low detail version of a few dozen triangles, so they still draw something. Once an evicted mesh is marked
+/// visible again its full data is uploaded, straight from the retained data of meshes created with
+/// MeshRetention::Keep, otherwise after a MeshLoader brought it back on a worker. The low detail version of a mesh
+/// that drops its data is built from that data before it is dropped, so the loader never runs just for that. Meshes
+/// with neither retained data nor a loader are never evicted. Must be used on the thread that owns the OpenGL
+/// context.
+class ResidencyManager {
+ private:
+  struct Entry {
+    Mesh *mesh;
+    MeshLoader loader;
+
+    // The low detail job reads the mesh, the stream-in job only the loader and the entry
+    JobCounter lowDetailJob;
+    JobCounter streamInJob;
+
+    // Written by the low detail job until lowDetailReady is set
+    std::vector<cg::Vertex> lowVertices;
+    std::vector<unsigned int> lowIndices;
+    bool lowDetailStarted = false;
+    std::atomic<bool> lowDetailReady{false};
+    bool lowDetailTracked = false;
+
+    // Written by the stream-in job until loaded is set
+    std::vector<cg::Vertex> loadedVertices;
+    std::vector<unsigned int> loadedIndices;
+    bool loadFailed = false;
+    std::atomic<bool> loaded{false};
+    bool loading = false;
+
+    uint64_t lastVisibleFrame = 0;
+    TrackedMemory memory{MemoryCategory::MeshData, "Low detail meshes"};
+  };
+
+  ResidencySettings settings;
+  ResidencyStats stats;
+  std::vector<std::unique_ptr<Entry>> entries;
+  // Removed entries whose stream-in job is still running, freed by update() once it finished
+  std::vector<std::unique_ptr<Entry>> retired;
+  std::unordered_map<const Mesh *, size_t> lookup;
+  std::vector<Entry *> candidates;
+  uint64_t frame = 1;
+
+ public:
+  explicit ResidencyManager(const ResidencySettings &settings = ResidencySettings());
+
+  /// Waits for the jobs that are still running.
+  ~ResidencyManager();
+
+  ResidencyManager(const ResidencyManager &otherCopy) = delete;
+  ResidencyManager(const ResidencyManager &&otherMove) = delete;
+
+  /// Registers a mesh and builds its low detail version in the background from its retained data. A mesh that does
+  /// not retain its data gets no low detail version this way and is never evicted, use the other overload for it.
+  void add(Mesh *mesh, MeshLoader loader = MeshLoader());
+
+  /// Registers a mesh that does not retain its data, with a low detail version made by buildLowDetail from the data
+  /// it was created from. The loader only runs to bring the full mesh back after an eviction.
+  void add(Mesh *mesh, MeshLoader loader, std::vector<cg::Vertex> &&lowVertices,
+           std::vector<unsigned int> &&lowIndices);
+
+  /// Simplifies mesh data to the low detail version evicted meshes are replaced with. Leaves the output empty if the
+  /// mesh is already as small as a low detail version would be.
+  void buildLowDetail(Span<const cg::Vertex> vertices, Span<const unsigned int> indices,
+                      std::vector<cg::Vertex> &lowVertices, std::vector<unsigned int> &lowIndices) const;
+
+  /// Unregisters a mesh, has to be called before the mesh is deleted. Waits for its low detail version if that is still
+  /// being built from the mesh's data, a stream-in that is still loading finishes in the background and is dropped.
+  void remove(const Mesh *mesh);
+
+  /// Reports that a mesh is drawn this frame, call it for every drawn mesh before update().
+  void markVisible(const Mesh *mesh);
+
+  /// Uploads meshes that finished loading, starts loading evicted meshes that are visible again and evicts meshes
+  /// until the budget is met. Call it once per frame after the markVisible calls.
+  void update();
+
+  void setBudget(size_t bytes);
+  const ResidencySettings &getSettings() const;
+  const ResidencyStats &getStats() const;
+
+ private:
+  void startLowDetail(Entry &entry);
+  void startStreamIn(Entry &entry);
+  bool canEvict(const Entry &entry) const;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_RESIDENCYMANAGER_H_
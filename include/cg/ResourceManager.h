@@ -0,0 +1,298 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_RESOURCEMANAGER_H_
+#define RENDOR_INCLUDE_CG_RESOURCEMANAGER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cg/Mesh.h"
+#include "cg/ResidencyManager.h"
+#include "cg/common/Program.h"
+#include "cg/common/Shader.h"
+#include "cg/common/ShaderLibrary.h"
+
+namespace cg {
+
+/// ResourceHandle - Refers to a resource owned by the ResourceManager. The generation makes a handle to a released
+/// resource stale instead of letting it alias whatever reuses the slot, so looking it up yields nullptr.
+template<typename T>
+class ResourceHandle {
+ public:
+  static const uint32_t kNone = 0xFFFFFFFFu;
+
+  uint32_t index = kNone;
+  uint32_t generation = 0;
+
+  ResourceHandle() = default;
+  ResourceHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+
+  bool isValid() const {
+    return index != kNone;
+  }
+
+  bool operator==(const ResourceHandle &other) const {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator!=(const ResourceHandle &other) const {
+    return !(*this == other);
+  }
+};
+
+template<typename T>
+const uint32_t ResourceHandle<T>::kNone;
+
+typedef ResourceHandle<Mesh> MeshHandle;
+typedef ResourceHandle<Shader> ShaderHandle;
+typedef ResourceHandle<ShaderProgram> ProgramHandle;
+
+/// ResourcePool - Reference counted resources of one type, looked up by handle or by key.
+///
+/// The records of live resources are packed into parallel arrays (removal swaps the last record into the gap), so
+/// iterating them touches no holes. Handles go through a slot table that maps them to the packed position. The objects
+/// themselves stay on the heap, OpenGL wrappers cannot be moved.
+template<typename T>
+class ResourcePool {
+ private:
+  struct Slot {
+    uint32_t dense;
+    uint32_t generation;
+  };
+
+  std::vector<Slot> slots;
+  std::vector<uint32_t> freeSlots;
+
+  // Packed records, index i of every array belongs to the same resource
+  std::vector<std::unique_ptr<T>> resources;
+  std::vector<std::string> keys;
+  std::vector<uint32_t> referenceCounts;
+  std::vector<uint32_t> denseSlots;
+
+  std::unordered_map<std::string, uint32_t> byKey;
+
+ public:
+  /// Takes ownership of a resource with a reference count of 1.
+  /// \param key what the resource is found by, empty keys are never deduplicated
+  ResourceHandle<T> add(const std::string &key, std::unique_ptr<T> resource) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      slot = static_cast<uint32_t>(slots.size());
+      slots.push_back(Slot{0, 0});
+    }
+
+    slots[slot].dense = static_cast<uint32_t>(resources.size());
+    resources.push_back(std::move(resource));
+    keys.push_back(key);
+    referenceCounts.push_back(1);
+    denseSlots.push_back(slot);
+    if (!key.empty()) {
+      byKey[key] = slot;
+    }
+    return ResourceHandle<T>(slot, slots[slot].generation);
+  }
+
+  /// \return the handle of the resource with that key, invalid if there is none. Does not add a reference.
+  ResourceHandle<T> find(const std::string &key) const {
+    auto found = byKey.find(key);
+    if (found == byKey.end()) {
+      return ResourceHandle<T>();
+    }
+    return ResourceHandle<T>(found->second, slots[found->second].generation);
+  }
+
+  /// \return the resource, nullptr if the handle is invalid or stale
+  T *get(ResourceHandle<T> handle) const {
+    uint32_t dense = getDense(handle);
+    return dense == ResourceHandle<T>::kNone ? nullptr : resources[dense].get();
+  }
+
+  /// Adds a reference.
+  /// \return false if the handle is invalid or stale
+  bool acquire(ResourceHandle<T> handle) {
+    uint32_t dense = getDense(handle);
+    if (dense == ResourceHandle<T>::kNone) {
+      return false;
+    }
+    referenceCounts[dense]++;
+    return true;
+  }
+
+  /// Drops a reference.
+  /// \return the resource if that was the last reference, for the caller to destroy when it is safe
+  std::unique_ptr<T> release(ResourceHandle<T> handle) {
+    uint32_t dense = getDense(handle);
+    if (dense == ResourceHandle<T>::kNone || --referenceCounts[dense] > 0) {
+      return nullptr;
+    }
+
+    std::unique_ptr<T> resource = std::move(resources[dense]);
+    if (!keys[dense].empty()) {
+      byKey.erase(keys[dense]);
+    }
+
+    // Fill the gap with the last record, so the arrays stay packed
+    uint32_t last = static_cast<uint32_t>(resources.size() - 1);
+    if (dense != last) {
+      resources[dense] = std::move(resources[last]);
+      keys[dense] = std::move(keys[last]);
+      referenceCounts[dense] = referenceCounts[last];
+      denseSlots[dense] = denseSlots[last];
+      slots[denseSlots[dense]].dense = dense;
+    }
+    resources.pop_back();
+    keys.pop_back();
+    referenceCounts.pop_back();
+    denseSlots.pop_back();
+
+    slots[handle.index].generation++;
+    freeSlots.push_back(handle.index);
+    return resource;
+  }
+
+  uint32_t getReferenceCount(ResourceHandle<T> handle) const {
+    uint32_t dense = getDense(handle);
+    return dense == ResourceHandle<T>::kNone ? 0 : referenceCounts[dense];
+  }
+
+  /// Gets the number of live resources, the packed arrays below have this size.
+  size_t size() const {
+    return resources.size();
+  }
+
+  const std::vector<std::unique_ptr<T>> &getResources() const {
+    return resources;
+  }
+
+  const std::vector<std::string> &getKeys() const {
+    return keys;
+  }
+
+  const std::vector<uint32_t> &getReferenceCounts() const {
+    return referenceCounts;
+  }
+
+ private:
+  uint32_t getDense(ResourceHandle<T> handle) const {
+    if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation) {
+      return ResourceHandle<T>::kNone;
+    }
+    return slots[handle.index].dense;
+  }
+};
+
+/// ResourceManager - Owns meshes, shaders and programs and hands out handles to them.
+///
+/// Loading the same file with the same settings twice returns the resource that is already loaded and adds a
+/// reference, releasing the last reference schedules the resource for deletion. Deletion is deferred to collect(), so
+/// a resource released in the middle of a frame stays valid for the draws already recorded with it. Everything,
+/// including collect(), must be called from the thread that owns the OpenGL context.
+class ResourceManager {
+ private:
+  ResourcePool<Mesh> meshes;
+  ResourcePool<Shader> shaders;
+  ResourcePool<ShaderProgram> programs;
+
+  std::vector<std::unique_ptr<Mesh>> releasedMeshes;
+  std::vector<std::unique_ptr<Shader>> releasedShaders;
+  std::vector<std::unique_ptr<ShaderProgram>> releasedPrograms;
+
+  ResidencyManager *residency = nullptr;
+
+ public:
+  ResourceManager() = default;
+
+  /// Deletes every resource, whether or not it is still referenced.
+  ~ResourceManager();
+
+  ResourceManager(const ResourceManager &otherCopy) = delete;
+  ResourceManager(const ResourceManager &&otherMove) = delete;
+
+  /// Builds the key resources are deduplicated by: the canonical path, so different spellings of one file match,
+  /// plus everything that changes the loaded result.
+  static std::string MakeKey(const std::string &path, const std::string &settings);
+
+  /// Registers every mesh with the residency manager from now on, meshes loaded without their data are re-imported
+  /// from their file after an eviction. Set it before loading meshes, the manager has to outlive this one.
+  void setResidencyManager(ResidencyManager *residency);
+
+  /// Loads a mesh with Mesh::LoadMesh, or adds a reference to the one already loaded with the same settings.
+  /// \return invalid handle if the file could not be loaded
+  MeshHandle loadMesh(const std::string &path, unsigned int index = 0,
+                      MeshRetention retention = MeshRetention::Keep);
+
+  /// Takes ownership of a mesh created elsewhere, e.g. from an AsyncInfoImporter result.
+  /// \param key see MakeKey, an empty key is never deduplicated
+  MeshHandle addMesh(const std::string &key, Mesh *mesh);
+
+  /// \return the mesh loaded under the key, invalid if there is none. Does not add a reference.
+  MeshHandle findMesh(const std::string &key) const;
+
+  /// Loads and compiles a shader, or adds a reference to the one already loaded from that file.
+  /// \return invalid handle if the file could not be read or compiled
+  ShaderHandle loadShader(ShaderType type, const std::string &path);
+
+  /// Links a program from shader files, or adds a reference to the one already linked from the same files. The stage
+  /// shaders are shared with loadShader.
+  /// \return invalid handle if a stage or the link failed
+  ProgramHandle loadProgram(const std::vector<ShaderStageFile> &stages);
+
+  Mesh *get(MeshHandle handle) const;
+  Shader *get(ShaderHandle handle) const;
+  ShaderProgram *get(ProgramHandle handle) const;
+
+  void acquire(MeshHandle handle);
+  void acquire(ShaderHandle handle);
+  void acquire(ProgramHandle handle);
+
+  /// Drops a reference, the last one schedules the resource for deletion in collect(). The handle is stale afterwards.
+  void release(MeshHandle handle);
+  void release(ShaderHandle handle);
+  void release(ProgramHandle handle);
+
+  uint32_t getReferenceCount(MeshHandle handle) const;
+  uint32_t getReferenceCount(ShaderHandle handle) const;
+  uint32_t getReferenceCount(ProgramHandle handle) const;
+
+  const ResourcePool<Mesh> &getMeshes() const;
+  const ResourcePool<Shader> &getShaders() const;
+  const ResourcePool<ShaderProgram> &getPrograms() const;
+
+  /// Deletes the resources released since the last call. Call it once per frame at a point where nothing refers to
+  /// them anymore, e.g. before rendering starts.
+  /// \return the number of deleted resources
+  size_t collect();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_RESOURCEMANAGER_H_
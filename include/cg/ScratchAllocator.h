@@ -0,0 +1,169 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_SCRATCHALLOCATOR_H_
+#define RENDOR_INCLUDE_CG_SCRATCHALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace cg {
+
+/// ScratchAllocator - Bump allocator for short-lived memory of a single thread.
+///
+/// Memory is taken from blocks that are kept for the lifetime of the allocator, so after warming up allocating is a
+/// pointer increment. Nothing is freed individually, instead the allocator is rewound to an earlier marker, usually
+/// with a ScratchScope. Every thread has its own allocator (see Get), which makes it safe to use inside jobs.
+/// Oversized blocks, made for a single large allocation, are returned to the system when they are rewound past so
+/// that one large import does not stay resident.
+class ScratchAllocator {
+ public:
+  /// A position to rewind to.
+  struct Marker {
+    size_t block = 0;
+    size_t offset = 0;
+  };
+
+ private:
+  struct Block {
+    char *data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+  size_t blockSize;
+  size_t current = 0;
+  size_t offset = 0;
+
+ public:
+  /// \param blockSize size of a block, allocations that are larger get a block of their own
+  explicit ScratchAllocator(size_t blockSize = 256 * 1024);
+  ~ScratchAllocator();
+
+  ScratchAllocator(const ScratchAllocator &otherCopy) = delete;
+  ScratchAllocator(const ScratchAllocator &&otherMove) = delete;
+
+  /// Gets the allocator of the calling thread.
+  static ScratchAllocator &Get();
+
+  /// \param alignment must be a power of two
+  /// \return uninitialized memory that stays valid until the allocator is rewound past it
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template<typename T>
+  T *allocate(size_t count) {
+    return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  Marker getMarker() const;
+
+  /// Releases everything allocated after the marker was taken. Markers must be rewound in the reverse order they were
+  /// taken in.
+  void rewind(const Marker &marker);
+
+  /// Releases everything, the blocks are kept.
+  void reset();
+
+  /// Gets the number of bytes reserved in blocks.
+  size_t getCapacity() const;
+
+ private:
+  void releaseOversizedBlocks();
+};
+
+/// ScratchScope - Rewinds the allocator to where it was at construction when it goes out of scope.
+class ScratchScope {
+ private:
+  ScratchAllocator &allocator;
+  ScratchAllocator::Marker marker;
+
+ public:
+  explicit ScratchScope(ScratchAllocator &allocator = ScratchAllocator::Get())
+      : allocator(allocator), marker(allocator.getMarker()) {}
+  ~ScratchScope() {
+    allocator.rewind(marker);
+  }
+
+  ScratchScope(const ScratchScope &otherCopy) = delete;
+  ScratchScope(const ScratchScope &&otherMove) = delete;
+};
+
+/// ArenaAllocator - Standard library allocator that takes its memory from a ScratchAllocator.
+///
+/// Deallocating is a no-op, the memory comes back when the arena is rewound, so containers using it must not outlive
+/// the enclosing ScratchScope. Growing a vector leaves its old storage behind in the arena, reserve up front where
+/// the size is known.
+template<typename T>
+class ArenaAllocator {
+ private:
+  ScratchAllocator *arena;
+
+  template<typename U> friend class ArenaAllocator;
+
+ public:
+  using value_type = T;
+
+  template<typename U>
+  struct rebind {
+    using other = ArenaAllocator<U>;
+  };
+
+  /// Uses the calling thread's scratch allocator.
+  ArenaAllocator() : arena(&ScratchAllocator::Get()) {}
+  explicit ArenaAllocator(ScratchAllocator &arena) : arena(&arena) {}
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t count) {
+    T *memory = this->arena->template allocate<T>(count);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+  }
+
+  void deallocate(T *, size_t) {}
+
+  ScratchAllocator &getArena() const {
+    return *this->arena;
+  }
+
+  template<typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return this->arena == other.arena;
+  }
+
+  template<typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return this->arena != other.arena;
+  }
+};
+
+/// A vector whose storage lives in a ScratchAllocator.
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
+
+#endif //RENDOR_INCLUDE_CG_SCRATCHALLOCATOR_H_
@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_SPAN_H_
+#define RENDOR_INCLUDE_CG_SPAN_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace cg {
+
+/// Span - A non-owning view of contiguous elements, like C++20's std::span. Reading data through a span avoids
+/// copying it and does not tie the reader to how the owner stores it.
+template<typename T>
+class Span {
+ private:
+  T *pointer = nullptr;
+  size_t count = 0;
+
+ public:
+  Span() = default;
+  Span(T *data, size_t size) : pointer(data), count(size) {}
+
+  /// Views a vector, which must outlive the span and must not reallocate while it is in use.
+  template<typename U, typename Allocator,
+      typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+  Span(std::vector<U, Allocator> &vector) : pointer(vector.data()), count(vector.size()) {}
+
+  template<typename U, typename Allocator,
+      typename = typename std::enable_if<std::is_convertible<const U *, T *>::value>::type>
+  Span(const std::vector<U, Allocator> &vector) : pointer(vector.data()), count(vector.size()) {}
+
+  /// A span of mutable elements converts to one of const elements.
+  template<typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+  Span(const Span<U> &other) : pointer(other.data()), count(other.size()) {}
+
+  T *data() const { return pointer; }
+  size_t size() const { return count; }
+  size_t sizeBytes() const { return count * sizeof(T); }
+  bool empty() const { return count == 0; }
+
+  T &operator[](size_t index) const { return pointer[index]; }
+  T *begin() const { return pointer; }
+  T *end() const { return pointer + count; }
+
+  Span<T> subspan(size_t offset, size_t size) const { return Span<T>(pointer + offset, size); }
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_SPAN_H_
@@ -0,0 +1,213 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_TEXTURESTREAMER_H_
+#define RENDOR_INCLUDE_CG_TEXTURESTREAMER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "cg/Image.h"
+#include "cg/JobSystem.h"
+#include "cg/MemoryTracker.h"
+#include "cg/common/Texture.h"
+
+namespace cg {
+
+struct TextureStreamingSettings {
+  /// GPU memory all streamed textures may occupy together, fine levels are dropped to stay below it
+  size_t budget = 256 * 1024 * 1024;
+
+  /// Bytes copied into the staging buffer per frame, bounds the time update() spends on uploads
+  size_t uploadBytesPerFrame = 4 * 1024 * 1024;
+
+  /// Levels of this size and smaller stay resident while the texture is loaded
+  int minimumSize = 64;
+
+  /// A texture that was not used for this many frames is reduced to its minimum size
+  uint64_t unusedFrames = 120;
+
+  MipFilter filter = MipFilter::Kaiser;
+  GLenum internalFormat = GL_SRGB8_ALPHA8;
+};
+
+struct TextureStreamingStats {
+  size_t textures = 0;
+
+  /// Textures that are decoding or still have levels to upload
+  size_t streaming = 0;
+
+  /// GPU memory of the allocated textures
+  size_t residentBytes = 0;
+
+  /// Bytes uploaded during the last update()
+  size_t uploadedBytes = 0;
+};
+
+/// StreamedTexture - A texture loaded by the TextureStreamer. The Texture2D object stays the same for the lifetime of
+/// the StreamedTexture, even when the streamer reallocates its storage.
+class StreamedTexture {
+  friend class TextureStreamer;
+
+ private:
+  std::string path;
+
+  // Written by the decode job until decoded is set, only read by the owner thread afterwards
+  Image image;
+  bool failed = false;
+  std::atomic<bool> decoded;
+
+  std::unique_ptr<Texture2D> texture;
+  TrackedMemory memory{MemoryCategory::Texture};
+
+  // Levels are indices into the full mip chain of the image. The texture stores [storageLevel, levelCount), of which
+  // [residentLevel, levelCount) are uploaded; uploadRow rows of residentLevel - 1 are uploaded as well.
+  int levelCount = 0;
+  int tailLevel = 0;
+  int storageLevel = 0;
+  int residentLevel = 0;
+  int uploadRow = 0;
+  int wantedLevel = 0;
+
+  // Largest size on screen reported by markUsed during lastUsedFrame
+  float usedSize = 0.0f;
+  uint64_t lastUsedFrame = 0;
+  bool used = false;
+
+ public:
+  explicit StreamedTexture(const std::string &path) : path(path), decoded(false) {}
+
+  StreamedTexture(const StreamedTexture &otherCopy) = delete;
+  StreamedTexture(const StreamedTexture &&otherMove) = delete;
+
+  /// Gets the texture to sample.
+  /// \return nullptr until at least the 1x1 level was uploaded
+  Texture2D *getTexture() const;
+
+  const std::string &getPath() const;
+
+  /// \return true if the file could not be decoded, the texture never becomes available then
+  bool hasFailed() const;
+
+  /// \return true if every level the streamer wants resident is uploaded
+  bool isComplete() const;
+
+  /// Gets the finest level that can be sampled, 0 is the full size image.
+  int getResidentLevel() const;
+
+  /// Gets the number of levels of the full mip chain, 0 until the file is decoded.
+  int getLevelCount() const;
+};
+
+/// TextureStreamer - Loads textures in the background and streams their mip levels to the GPU within a memory budget.
+///
+/// Files are decoded and their mip chains generated by jobs on the JobSystem. update() then uploads the levels
+/// coarsest first through a ring of pixel buffer objects, a bounded amount per frame, so a texture becomes usable
+/// with its 1x1 level right away and sharpens over the next frames. The storage is immutable; when the levels a
+/// texture needs change the storage is reallocated and the resident levels are copied on the GPU. Textures only get
+/// their fine levels once markUsed reports them as large enough on screen, and when the budget is exceeded the least
+/// recently used textures lose their fine levels first. If a pixel buffer cannot be mapped, that frame's rows are
+/// uploaded straight from system memory instead. Everything except the decode jobs runs on the thread that owns the
+/// OpenGL context.
+class TextureStreamer {
+ private:
+  static const int kStagingBuffers = 3;
+
+  struct StagingBuffer {
+    unsigned int buffer = 0;
+    GLsync fence = nullptr;
+  };
+
+  /// Rows of a level copied into the staging buffer at an offset, or uploaded from the image if mapping failed.
+  struct Upload {
+    StreamedTexture *texture;
+    int level;
+    int row;
+    int rows;
+    size_t offset;
+    bool completesLevel;
+  };
+
+  TextureStreamingSettings settings;
+  TextureStreamingStats stats;
+
+  std::map<std::string, std::unique_ptr<StreamedTexture>> textures;
+  std::vector<std::unique_ptr<StreamedTexture>> unloaded;
+  JobCounter decodes;
+
+  StagingBuffer staging[kStagingBuffers];
+  size_t stagingSize = 0;
+  int stagingIndex = 0;
+  TrackedMemory stagingMemory{MemoryCategory::Buffer, "Texture staging"};
+  bool mapFailed = false;
+  uint64_t frame = 1;
+
+  // Reused every frame, so update() does not allocate
+  std::vector<StreamedTexture *> active;
+  std::vector<Upload> uploads;
+
+ public:
+  explicit TextureStreamer(const TextureStreamingSettings &settings = TextureStreamingSettings());
+
+  /// Waits for the decode jobs and deletes every texture, the OpenGL context has to be current.
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer &otherCopy) = delete;
+  TextureStreamer(const TextureStreamer &&otherMove) = delete;
+
+  /// Starts loading a texture, or returns the one already loaded from that file.
+  /// \return the texture, it stays valid until it is unloaded or the streamer is destroyed
+  StreamedTexture *load(const std::string &path);
+
+  /// Deletes a texture. The object may stay alive a little longer if it is still decoding, but must not be used.
+  void unload(StreamedTexture *texture);
+
+  /// Reports that a texture is drawn this frame, call it for every use before update().
+  /// \param screenSize how many pixels the texture covers across on screen, decides the finest level it needs
+  void markUsed(StreamedTexture *texture, float screenSize);
+
+  /// Applies the budget, reallocates textures whose levels changed and uploads the next chunk of levels. Call it
+  /// once per frame.
+  void update();
+
+  void setBudget(size_t bytes);
+  const TextureStreamingSettings &getSettings() const;
+  const TextureStreamingStats &getStats() const;
+
+ private:
+  void decode(StreamedTexture *texture);
+  void reallocate(StreamedTexture *texture, int storageLevel);
+  void upload();
+  size_t getStorageSize(const StreamedTexture *texture, int storageLevel) const;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_TEXTURESTREAMER_H_
@@ -0,0 +1,128 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_TRANSFORMHIERARCHY_H_
+#define RENDOR_INCLUDE_CG_TRANSFORMHIERARCHY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace cg {
+
+class JobSystem;
+
+/// TransformHierarchy - Local position/rotation/scale of many nodes with parent links, and their world matrices.
+///
+/// The local transforms are stored as separate arrays (structure of arrays) and setters only flag the node, nothing
+/// is computed until update(). update() walks the nodes level by level in depth order, so every parent is final
+/// before its children, and splits each level over the job system. A node is recomputed only if it or one of its
+/// ancestors changed since the last update, untouched subtrees keep their world matrices.
+///
+/// Not thread-safe: change nodes from one thread and do not change them during update().
+class TransformHierarchy {
+ public:
+  /// Parent of a root node
+  static const uint32_t kNone = 0xFFFFFFFFu;
+
+ private:
+  enum Flags : uint8_t {
+    LocalDirty = 1 << 0,
+    WorldChanged = 1 << 1
+  };
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<glm::vec3> scales;
+  std::vector<uint32_t> parents;
+  std::vector<uint8_t> flags;
+  std::vector<glm::mat4> worldMatrices;
+
+  /// Nodes sorted by depth, level d is order[levelOffsets[d]..levelOffsets[d + 1])
+  std::vector<uint32_t> order;
+  std::vector<size_t> levelOffsets;
+
+  bool structureChanged = false;
+  bool anyDirty = false;
+  size_t updatedCount = 0;
+
+ public:
+  TransformHierarchy() = default;
+
+  /// Reserves storage for a number of nodes.
+  void reserve(size_t count);
+
+  /// Adds a node with an identity transform.
+  /// \param parent an existing node or kNone for a root
+  /// \return the id of the node
+  uint32_t create(uint32_t parent = kNone);
+
+  /// Moves a node and its subtree under another parent, its local transform is kept.
+  /// \return false if the parent does not exist or lies inside the node's own subtree
+  bool setParent(uint32_t node, uint32_t parent);
+
+  void setPosition(uint32_t node, const glm::vec3 &position);
+  void setRotation(uint32_t node, const glm::quat &rotation);
+  void setScale(uint32_t node, const glm::vec3 &scale);
+  void setLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+
+  const glm::vec3 &getPosition(uint32_t node) const { return positions[node]; }
+  const glm::quat &getRotation(uint32_t node) const { return rotations[node]; }
+  const glm::vec3 &getScale(uint32_t node) const { return scales[node]; }
+  uint32_t getParent(uint32_t node) const { return parents[node]; }
+
+  /// Gets the world matrix as of the last update().
+  const glm::mat4 &getWorldMatrix(uint32_t node) const { return worldMatrices[node]; }
+
+  /// Gets all world matrices indexed by node id, e.g. to upload them at once.
+  const std::vector<glm::mat4> &getWorldMatrices() const { return worldMatrices; }
+
+  /// \return true if the world matrix of the node changed in the last update()
+  bool hasChanged(uint32_t node) const { return (flags[node] & WorldChanged) != 0; }
+
+  size_t size() const { return parents.size(); }
+
+  /// Gets the number of world matrices the last update() recomputed.
+  size_t getUpdatedCount() const { return updatedCount; }
+
+  /// Recomputes the world matrices of changed subtrees.
+  /// \param jobs the job system levels are split over, null to update on the calling thread
+  void update(JobSystem *jobs);
+
+  /// Composes a translation * rotation * scale matrix without the intermediate matrix products.
+  static glm::mat4 ComposeMatrix(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+
+ private:
+  void markDirty(uint32_t node);
+  void sortLevels();
+  /// \return the number of recomputed nodes
+  size_t updateRange(const uint32_t *nodes, size_t count);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_TRANSFORMHIERARCHY_H_
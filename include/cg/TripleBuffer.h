@@ -0,0 +1,85 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_TRIPLEBUFFER_H_
+#define RENDOR_INCLUDE_CG_TRIPLEBUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace cg {
+
+/// TripleBuffer - Hands snapshots from one producer thread to one consumer thread without locks or waiting.
+///
+/// The producer fills getWriteBuffer() and publishes it; the consumer calls acquire() and then reads
+/// getReadBuffer(), which stays untouched until its next acquire(). Neither side ever waits for the other, the
+/// consumer simply sees the latest published snapshot. Used to hand the simulation state (transforms, camera, draw
+/// lists) of a frame to the render thread, see FrameLoopSettings::threadedSimulation.
+template<typename T>
+class TripleBuffer {
+ private:
+  static const uint8_t kIndexMask = 0x3;
+  static const uint8_t kFresh = 0x4;
+
+  T buffers[3];
+  std::atomic<uint8_t> middle;
+  uint8_t back = 0;
+  uint8_t front = 2;
+
+ public:
+  TripleBuffer() : middle(1) {}
+
+  TripleBuffer(const TripleBuffer &otherCopy) = delete;
+  TripleBuffer(const TripleBuffer &&otherMove) = delete;
+
+  /// Gets the producer's buffer. It holds an older snapshot, not necessarily the last published one.
+  T &getWriteBuffer() {
+    return this->buffers[this->back];
+  }
+
+  /// Makes the write buffer the latest snapshot.
+  void publish() {
+    this->back = this->middle.exchange(static_cast<uint8_t>(this->back | kFresh), std::memory_order_acq_rel)
+        & kIndexMask;
+  }
+
+  /// Takes the latest snapshot if one was published since the last call.
+  /// \return true if the read buffer changed
+  bool acquire() {
+    if ((this->middle.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  /// Gets the consumer's buffer, a default constructed T until the first snapshot is acquired.
+  const T &getReadBuffer() const {
+    return this->buffers[this->front];
+  }
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_TRIPLEBUFFER_H_
@@ -0,0 +1,52 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_VERTEXWELDER_H_
+#define RENDOR_INCLUDE_CG_VERTEXWELDER_H_
+
+#include <cstddef>
+
+#include "cg/Vertex.h"
+
+namespace cg {
+
+/// Merges duplicate vertices in parallel on the JobSystem, a drop-in for meshopt_generateVertexRemap followed by
+/// meshopt_remapVertexBuffer.
+///
+/// Vertices are hashed into a concurrent open-addressing table; the slot of each distinct vertex ends up holding the
+/// copy that comes first in the index buffer, and the unique vertices are numbered in that order. With an epsilon of
+/// 0 vertices are compared bit for bit and the remap is identical to meshopt_generateVertexRemap's. With an epsilon
+/// every attribute is snapped to a grid of that spacing first, and vertices that land in the same cell for every
+/// attribute are merged; the unique vertex keeps the attributes of its first copy.
+/// \param remap receives the unique index of every vertex, ~0u for vertices no index refers to
+/// \param uniqueVertices receives the unique vertices, must have room for vertexCount; nullptr to only build the remap
+/// \param indices the index buffer, nullptr if the vertices are not indexed (indexCount is vertexCount then)
+/// \param epsilon the grid spacing attributes are compared at, 0 compares them exactly
+/// \return the number of unique vertices
+size_t WeldVertices(unsigned int *remap, cg::Vertex *uniqueVertices, const unsigned int *indices, size_t indexCount,
+                    const cg::Vertex *vertices, size_t vertexCount, float epsilon = 0.0f);
+
+}
+
+#endif //RENDOR_INCLUDE_CG_VERTEXWELDER_H_
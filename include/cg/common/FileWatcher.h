@@ -0,0 +1,82 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_FILEWATCHER_H_
+#define RENDOR_INCLUDE_CG_COMMON_FILEWATCHER_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cg {
+
+/// FileWatcher - Watches a set of files on a background thread and collects the ones that changed. On Linux this uses
+/// inotify on the parent directories (so editors that save by renaming are caught too), elsewhere the thread polls
+/// modification times. Changes are only collected; the owner decides when to act on them by calling pollChanges.
+class FileWatcher {
+ private:
+  std::thread thread;
+  std::atomic<bool> running;
+
+  std::mutex mutex;
+  std::set<std::string> watched;
+  std::set<std::string> changed;
+
+#ifdef __linux__
+  int inotifyHandle = -1;
+  int wakeHandles[2] = {-1, -1};
+  std::map<int, std::string> directories;
+  std::set<std::string> watchedDirectories;
+#else
+  std::map<std::string, long long> modificationTimes;
+#endif
+
+ public:
+  FileWatcher();
+  FileWatcher(const FileWatcher &otherCopy) = delete;
+  FileWatcher(const FileWatcher &&otherMove) = delete;
+  ~FileWatcher();
+
+  /// Starts watching a file. Watching the same file twice has no effect.
+  /// \param path path to the file, relative paths are resolved against the working directory
+  /// \return the canonical path that will be reported by pollChanges
+  std::string watch(const std::string &path);
+
+  /// Returns and clears the set of watched files that changed since the last call.
+  std::vector<std::string> pollChanges();
+
+  /// Resolves a path to the canonical form used by the watcher.
+  static std::string CanonicalPath(const std::string &path);
+
+ private:
+  void threadMain();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_FILEWATCHER_H_
@@ -0,0 +1,78 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_FRAMEBUFFER_H_
+#define RENDOR_INCLUDE_CG_COMMON_FRAMEBUFFER_H_
+
+#include <string>
+#include <vector>
+
+#include "cg/common/Handlable.h"
+#include "cg/common/Bindable.h"
+#include "cg/MemoryTracker.h"
+
+namespace cg {
+
+/// Framebuffer - Framebuffer object with an RGBA8 color and a depth/stencil renderbuffer.
+class Framebuffer : public Handlable<unsigned int>, public Bindable {
+ private:
+  unsigned int colorBuffer = 0;
+  unsigned int depthBuffer = 0;
+  int width = 0;
+  int height = 0;
+  TrackedMemory memory{MemoryCategory::Framebuffer, "Framebuffer"};
+
+ public:
+  Framebuffer(int width, int height);
+  ~Framebuffer();
+
+  Framebuffer(const Framebuffer &otherCopy) = delete;
+  Framebuffer(const Framebuffer &&otherMove) = delete;
+
+  /// Reallocates the attachments, the contents are undefined afterwards.
+  void resize(int width, int height);
+
+  bool isComplete();
+  int getWidth() const;
+  int getHeight() const;
+
+  /// Binds the framebuffer for drawing and reading and sets the viewport to cover it.
+  void bind() override;
+  void unbind() override;
+
+  /// Reads the color attachment, rows bottom to top as OpenGL stores them.
+  /// \param pixels receives width * height RGBA8 pixels
+  void readPixels(std::vector<unsigned char> &pixels);
+
+  /// Writes RGBA8 pixels as a binary PPM image, flipping the rows so the image is upright.
+  /// \return true if the file was written
+  static bool WritePPM(const std::string &path, int width, int height, const std::vector<unsigned char> &pixels);
+
+ private:
+  void allocate();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_FRAMEBUFFER_H_
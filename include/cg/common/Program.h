@@ -29,13 +29,32 @@
 #include <glm/glm.hpp>
 
 #include "cg/common/Shader.h"
+#include "cg/MemoryTracker.h"
 
 namespace cg {
 
+/// ShaderStageSource - GLSL source of a single program stage.
+struct ShaderStageSource {
+  ShaderType type;
+  std::string source;
+};
+
 class ShaderProgram {
 private:
   unsigned int programHandle;
   bool linked = false;
+  bool linkStarted = false;
+  mutable unsigned int stageBits = 0;
+
+  struct UniformLocation {
+    std::string name;
+    int location;
+  };
+  std::vector<UniformLocation> uniformLocations;
+
+  TrackedMemory memory{MemoryCategory::Program};
+
+  void trackBinarySize();
 
 public:
   ShaderProgram();
@@ -47,26 +66,86 @@ public:
   void detachShader(const Shader *shader) const;
   const bool linkProgram();
 
+  /// Starts linking without waiting for the result, see Shader::beginCompile. linkProgram() then only fetches the
+  /// result.
+  void beginLink();
+  const bool isLinked() const;
+
+  /// Hints the driver that the program binary will be retrieved after linking. Must be set before linkProgram.
+  void setBinaryRetrievable(bool retrievable);
+
+  /// Loads a previously retrieved program binary instead of linking attached shaders. Equivalent to 'glProgramBinary'.
+  /// \param stageBits the stages the binary contains, see getStageBits
+  /// \return true if the driver accepted the binary, false if it has to be rebuilt from source
+  const bool loadProgramBinary(unsigned int format, const void *binary, int length, unsigned int stageBits);
+
+  /// Retrieves the linked program binary. Equivalent to 'glGetProgramBinary'.
+  /// \param format receives the driver specific binary format
+  /// \return the binary, empty if the program is not linked or the driver does not expose a binary
+  std::vector<char> getProgramBinary(unsigned int &format) const;
+
+  /// Exchanges the OpenGL program objects of two programs. Used to replace a program in place after a reload, so
+  /// pointers handed out earlier stay valid.
+  void swap(ShaderProgram &other);
+
+  /// Sets the asset the program is accounted to in the MemoryTracker.
+  void setAssetName(const std::string &name);
+
+  /// Marks the program as separable, so it can be combined with other programs in a ProgramPipeline. Must be set
+  /// before linkProgram. Equivalent to glProgramParameteri(GL_PROGRAM_SEPARABLE).
+  void setSeparable(bool separable);
+  const bool isSeparable() const;
+
+  /// Gets the stages this program contains as a combination of GL_*_SHADER_BIT values, as used by ProgramPipeline.
+  const unsigned int getStageBits() const;
+
   void bindAttributeLocation(unsigned int attributeIndex, const std::string &name);
   void bindFragDataLocation(unsigned int colorNumber, const std::string &name);
 
+  /// Gets the location of a uniform, cached per program after the first lookup so setting uniforms every frame does
+  /// not query the driver or allocate. The cache is cleared whenever the program is (re)linked.
+  /// \return the location, -1 if the program has no active uniform of that name
+  int getUniformLocation(const char *name);
+
+  void setUniform1f(const char *name, float x);
+  void setUniform2f(const char *name, glm::vec2 vec2);
+  void setUniform3f(const char *name, glm::vec3 vec3);
+  void setUniform4f(const char *name, glm::vec4 vec4);
+
+  void setUniform1i(const char *name, int x);
+  void setUniform2i(const char *name, glm::ivec2 vec2);
+  void setUniform3i(const char *name, glm::ivec3 vec3);
+  void setUniform4i(const char *name, glm::ivec4 vec4);
+
+  void setUniform1u(const char *name, unsigned int x);
+  void setUniform2u(const char *name, glm::uvec2 vec2);
+  void setUniform3u(const char *name, glm::uvec3 vec3);
+  void setUniform4u(const char *name, glm::uvec4 vec4);
+
+  void setUniformMat2f(const char *name, glm::mat2 mat2);
+  void setUniformMat3f(const char *name, glm::mat3 mat3);
+  void setUniformMat4f(const char *name, glm::mat4 mat4);
+  void setUniformMat2x3f(const char *name, glm::mat2x3 mat2x3);
+  void setUniformMat3x2f(const char *name, glm::mat3x2 mat3x2);
+  void setUniformMat2x4f(const char *name, glm::mat2x4 mat2x4);
+  void setUniformMat4x2f(const char *name, glm::mat4x2 mat4x2);
+  void setUniformMat3x4f(const char *name, glm::mat3x4 mat3x4);
+  void setUniformMat4x3f(const char *name, glm::mat4x3 mat4x3);
+
+  /// Convenience overloads for names built at runtime, they forward name.c_str() to the overloads above.
   int getUniformLocation(const std::string &name);
-
   void setUniform1f(const std::string &name, float x);
   void setUniform2f(const std::string &name, glm::vec2 vec2);
   void setUniform3f(const std::string &name, glm::vec3 vec3);
   void setUniform4f(const std::string &name, glm::vec4 vec4);
-
   void setUniform1i(const std::string &name, int x);
   void setUniform2i(const std::string &name, glm::ivec2 vec2);
   void setUniform3i(const std::string &name, glm::ivec3 vec3);
   void setUniform4i(const std::string &name, glm::ivec4 vec4);
-
   void setUniform1u(const std::string &name, unsigned int x);
   void setUniform2u(const std::string &name, glm::uvec2 vec2);
   void setUniform3u(const std::string &name, glm::uvec3 vec3);
   void setUniform4u(const std::string &name, glm::uvec4 vec4);
-
   void setUniformMat2f(const std::string &name, glm::mat2 mat2);
   void setUniformMat3f(const std::string &name, glm::mat3 mat3);
   void setUniformMat4f(const std::string &name, glm::mat4 mat4);
@@ -78,6 +157,18 @@ public:
   void setUniformMat4x3f(const std::string &name, glm::mat4x3 mat4x3);
 
   const unsigned int getHandle() const;
+
+  /// Compiles every stage and links them into a new program. The intermediate shader objects are deleted again.
+  /// \param stages the GLSL source of every stage
+  /// \param retrievable whether the binary of the linked program will be retrieved (see setBinaryRetrievable)
+  /// \param separable whether the program is linked as a separable program (see setSeparable)
+  /// \return new linked ShaderProgram, or nullptr if compilation or linking failed
+  static ShaderProgram *FromSources(const std::vector<ShaderStageSource> &stages,
+                                    bool retrievable = false,
+                                    bool separable = false);
+
+  /// Gets the GL_*_SHADER_BIT value of a shader type.
+  static unsigned int StageBit(ShaderType type);
 };
 
 }
@@ -0,0 +1,95 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_PROGRAMCACHE_H_
+#define RENDOR_INCLUDE_CG_COMMON_PROGRAMCACHE_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "cg/common/Shader.h"
+#include "cg/common/Program.h"
+
+namespace cg {
+
+/// ProgramBinaryCache - Stores linked program binaries on disk so later runs can skip compiling and linking GLSL.
+/// Binaries are keyed by a hash of all stage sources, the permutation defines and the driver's vendor, renderer and
+/// version strings, so a driver update or a source change simply misses the cache and falls back to compilation.
+/// A current OpenGL context is required for every call, including the constructor. Programs may be created on the
+/// LoaderThread while the render thread uses the cache too.
+class ProgramBinaryCache {
+ private:
+  std::string directory;
+  std::string driverIdentity;
+  bool supported = false;
+
+  std::atomic<unsigned int> hits{0};
+  std::atomic<unsigned int> misses{0};
+
+ public:
+  explicit ProgramBinaryCache(const std::string &directory);
+  ProgramBinaryCache(const ProgramBinaryCache &otherCopy) = delete;
+  ProgramBinaryCache(const ProgramBinaryCache &&otherMove) = delete;
+
+  /// Checks if the driver exposes at least one program binary format.
+  /// \return true if binaries can be stored and loaded, false if every program is built from source
+  bool isSupported() const;
+
+  /// Computes the cache key for a set of stages.
+  /// \param stages the final GLSL source of every stage
+  /// \param defines the permutation defines the sources were built with
+  /// \param separable whether the program is linked as a separable program
+  /// \return hexadecimal key that identifies the program on this driver
+  std::string computeKey(const std::vector<ShaderStageSource> &stages,
+                         const std::string &defines,
+                         bool separable = false) const;
+
+  /// Loads a cached binary into a program.
+  /// \return true if the program is linked from the cache, false on a miss or if the driver rejected the binary
+  bool loadProgram(ShaderProgram *program, const std::string &key);
+
+  /// Stores the binary of a linked program. The program should be linked with setBinaryRetrievable(true).
+  /// \return true if the binary was written to disk
+  bool storeProgram(const ShaderProgram *program, const std::string &key) const;
+
+  /// Creates a linked program from the cache, or compiles and links the stages and stores the result on a miss.
+  /// \param stages the final GLSL source of every stage
+  /// \param defines the permutation defines the sources were built with
+  /// \param separable whether the program is linked as a separable program, see ShaderProgram::setSeparable
+  /// \return new linked ShaderProgram, or nullptr if compilation or linking failed
+  ShaderProgram *createProgram(const std::vector<ShaderStageSource> &stages,
+                               const std::string &defines = "",
+                               bool separable = false);
+
+  unsigned int getHits() const { return hits; }
+  unsigned int getMisses() const { return misses; }
+
+ private:
+  std::string getCachePath(const std::string &key) const;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_PROGRAMCACHE_H_
@@ -0,0 +1,76 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_PROGRAMPIPELINE_H_
+#define RENDOR_INCLUDE_CG_COMMON_PROGRAMPIPELINE_H_
+
+#include <iostream>
+
+#include "cg/common/Handlable.h"
+#include "cg/common/Bindable.h"
+#include "cg/common/Program.h"
+
+namespace cg {
+
+/// ProgramPipeline - Combines separable programs (see ShaderProgram::setSeparable) into a complete pipeline at bind
+/// time, so a vertex stage can be linked once and paired with any number of fragment stages without relinking.
+/// Uniforms are set on the individual programs with the regular ShaderProgram setters. Stages whose program was
+/// relinked in place (ShaderProgram::swap, e.g. by a ShaderLibrary hot reload) are re-attached when the pipeline is
+/// bound.
+class ProgramPipeline : public Handlable<unsigned int>, public Bindable {
+ private:
+  ShaderProgram *stagePrograms[6] = {};
+
+  // The program handles the stages were attached with, a program that was swapped by a reload is re-attached on bind
+  unsigned int stageHandles[6] = {};
+
+ public:
+  ProgramPipeline();
+  ProgramPipeline(const ProgramPipeline &otherCopy) = delete;
+  ProgramPipeline(const ProgramPipeline &&otherMove) = delete;
+  ~ProgramPipeline();
+
+  /// Uses the given stages of a separable program. Equivalent to 'glUseProgramStages'.
+  /// \param program separable program, or nullptr to clear the stages
+  /// \param stageBits combination of GL_*_SHADER_BIT values
+  void useProgramStages(ShaderProgram *program, unsigned int stageBits);
+
+  /// Uses every stage a separable program contains, see ShaderProgram::getStageBits.
+  void useProgram(ShaderProgram *program);
+
+  /// Gets the program currently used for a stage.
+  /// \return the program, or nullptr if the stage is empty
+  ShaderProgram *getStageProgram(ShaderType type) const;
+
+  /// Validates the pipeline against the current state and prints the log on failure.
+  /// \return true if the pipeline can be used for drawing
+  bool validate();
+
+  void bind() override;
+  void unbind() override;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_PROGRAMPIPELINE_H_
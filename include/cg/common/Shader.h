@@ -45,6 +45,7 @@ private:
   ShaderType shaderType;
   unsigned int shaderHandle = 0;
   bool compiled = false;
+  bool compileStarted = false;
 
   std::string shaderSource;
 
@@ -54,14 +55,19 @@ public:
   Shader(const Shader &&otherMove) = delete;
   ~Shader();
 
-  /// Sets the shader source code. Equivalent to 'glShaderSource'.
+  /// Sets the shader source code. Equivalent to 'glShaderSource', but also keeps a copy of the source so it can be
+  /// hashed (e.g. by the program binary cache) without reading it back from the driver.
   /// \param shaderSource GLSL source string
-  void setShaderSource(const std::string &shaderSource) const;
+  void setShaderSource(const std::string &shaderSource);
 
   /// Compiles the shader. Equivalent to 'glCompileShader', but includes error checking.
   /// \return true if compiled successfully, false if not
   bool compileShader();
 
+  /// Starts compiling the shader without waiting for the result, so drivers that compile in the background (see
+  /// GL_ARB_parallel_shader_compile) can work on several shaders at once. compileShader() then only fetches the result.
+  void beginCompile();
+
   /// Gets the shader type. The returned value can be casted to a GLenum to retrieve OpenGL's type.
   /// This is equivalent to glGetShaderiv(GL_SHADER_TYPE), but returns a ShaderType stored in this class instead.
   /// \return type of the shader
@@ -71,6 +77,10 @@ public:
   /// \return string containing the shader's source code
   const std::string getShaderSource() const;
 
+  /// Gets the source code that was last passed to setShaderSource.
+  /// \return reference to the locally stored source code
+  const std::string &getLocalShaderSource() const;
+
   /// Gets the shader source length. Equivalent to glGetShaderiv(GL_SHADER_SOURCE_LENGTH).
   /// \return length of the shader's source code
   const int getShaderSourceLength() const;
@@ -94,6 +104,12 @@ public:
   /// \return new Shader instance that can be compiled. Note that this instance doesn't need a 'setShaderSource'
   /// operation
   static Shader *LoadFromSourceFile(const ShaderType &type1, const std::string &path);
+
+  /// Reads a GLSL file into a string with a single read, without going through a stringstream.
+  /// \param path the file path to the GLSL file
+  /// \param source string that receives the file contents
+  /// \return true if the file was read, false if it could not be opened
+  static bool ReadSourceFile(const std::string &path, std::string &source);
 };
 
 }
@@ -0,0 +1,139 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_SHADERLIBRARY_H_
+#define RENDOR_INCLUDE_CG_COMMON_SHADERLIBRARY_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cg/common/FileWatcher.h"
+#include "cg/common/Program.h"
+#include "cg/common/ProgramCache.h"
+#include "cg/common/ShaderPreprocessor.h"
+
+namespace cg {
+
+class LoaderThread;
+
+/// ShaderStageFile - GLSL file of a single program stage.
+struct ShaderStageFile {
+  ShaderType type;
+  std::string path;
+};
+
+/// ShaderLibrary - Owns named shader programs and hot-reloads them when one of the files they depend on changes.
+/// Files are watched on a background thread, but programs are only rebuilt in update(), which should be called once
+/// per frame on the thread that owns the OpenGL context. Only programs that depend on a changed file are rebuilt, and
+/// a program that fails to compile keeps its previous, working version. Sources go through the library's preprocessor,
+/// so included files are dependencies too. With a running LoaderThread the programs update() rebuilds are compiled and
+/// linked there, and swapped in once the loader published them, so editing a shader does not stall a frame.
+class ShaderLibrary {
+ public:
+  struct ReloadReport {
+    std::string name;
+    double milliseconds;
+    bool success;
+  };
+
+ private:
+  struct Entry {
+    std::vector<ShaderStageFile> stages;
+    std::vector<std::string> defines;
+    std::set<std::string> dependencies;
+    std::unique_ptr<ShaderProgram> program;
+    // Incremented by every build, a build on the loader thread is dropped if a later one started meanwhile
+    unsigned int generation = 0;
+  };
+
+  std::map<std::string, Entry> programs;
+  std::map<std::string, std::set<std::string>> dependents;
+  std::vector<ReloadReport> lastReloads;
+  // Rebuilds the loader thread published since the last update(), which reports them
+  std::vector<ReloadReport> publishedReloads;
+
+  FileWatcher watcher;
+  ShaderPreprocessor preprocessor;
+  ProgramBinaryCache *cache;
+  LoaderThread *loader;
+
+  // Cleared by the destructor, so builds the loader publishes later do not touch a deleted library
+  std::shared_ptr<bool> alive;
+
+ public:
+  /// \param cache optional binary cache used when (re)building programs, not owned by the library
+  /// \param loader optional loader thread update() rebuilds programs on, not owned by the library
+  explicit ShaderLibrary(ProgramBinaryCache *cache = nullptr, LoaderThread *loader = nullptr);
+  ~ShaderLibrary();
+  ShaderLibrary(const ShaderLibrary &otherCopy) = delete;
+  ShaderLibrary(const ShaderLibrary &&otherMove) = delete;
+
+  /// Loads a program and starts watching the files it depends on. Loading a name twice replaces the stages.
+  /// \param defines defines injected into every stage, see ShaderPreprocessor
+  /// \return the program, which stays valid (and is updated in place) across reloads, or nullptr if the first build
+  /// failed
+  ShaderProgram *load(const std::string &name,
+                      const std::vector<ShaderStageFile> &stages,
+                      const std::vector<std::string> &defines = std::vector<std::string>());
+
+  /// Gets a previously loaded program.
+  /// \return the program, or nullptr if no program with that name was loaded successfully
+  ShaderProgram *get(const std::string &name);
+
+  /// Rebuilds a program from its files, regardless of whether they changed.
+  /// \return true if the program was rebuilt and swapped in
+  bool reload(const std::string &name);
+
+  /// Rebuilds the programs affected by file changes since the last call. Call this at a frame boundary.
+  /// \return the number of programs that were rebuilt and swapped in, on the loader thread those it published since
+  /// the last call
+  size_t update();
+
+  /// Gets the reports of the reloads done by the last update() or reload() call. A rebuild on the loader thread is
+  /// reported by the first update() after it was swapped in, with the time until then.
+  const std::vector<ReloadReport> &getLastReloads() const;
+
+  /// Gets the preprocessor used for every program, e.g. to add include directories.
+  ShaderPreprocessor &getPreprocessor();
+
+ private:
+  /// \param async build on the loader thread if one is running
+  /// \return true if the program was rebuilt, or started building on the loader thread
+  bool build(const std::string &name, Entry &entry, bool async);
+
+  /// Swaps a built program in and reports the reload.
+  /// \param program nullptr if the build failed
+  /// \param reports where the report goes, lastReloads or publishedReloads
+  bool finish(const std::string &name, Entry &entry, std::unique_ptr<ShaderProgram> program,
+              std::chrono::steady_clock::time_point start, std::vector<ReloadReport> &reports);
+  void track(const std::string &name, Entry &entry, const std::set<std::string> &dependencies);
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_SHADERLIBRARY_H_
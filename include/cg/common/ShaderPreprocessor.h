@@ -0,0 +1,90 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_SHADERPREPROCESSOR_H_
+#define RENDOR_INCLUDE_CG_COMMON_SHADERPREPROCESSOR_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace cg {
+
+/// PreprocessedShader - Output of the shader preprocessor.
+struct PreprocessedShader {
+  /// Final GLSL source, ready for Shader::setShaderSource
+  std::string source;
+
+  /// Every file that went into the source. The index of a file is the source string number used in the '#line'
+  /// directives, so compiler errors of the form '1(23)' refer to line 23 of files[1].
+  std::vector<std::string> files;
+};
+
+/// ShaderPreprocessor - Resolves '#include "file"' directives and injects '#define's after the '#version' line.
+/// Included files are looked up relative to the including file first and then in the include directories.
+/// '#pragma once' is honoured and recursive includes are reported as errors. Everything else is left to the driver's
+/// preprocessor.
+class ShaderPreprocessor {
+ private:
+  std::vector<std::string> includeDirectories;
+
+ public:
+  ShaderPreprocessor() = default;
+
+  void addIncludeDirectory(const std::string &directory);
+
+  /// Preprocesses a GLSL file.
+  /// \param path the file path to the GLSL file
+  /// \param defines defines to inject, either "NAME", "NAME VALUE" or "NAME=VALUE"
+  /// \param result receives the final source and the list of files it was built from
+  /// \return true on success, false if a file could not be read or an include could not be resolved
+  bool process(const std::string &path, const std::vector<std::string> &defines, PreprocessedShader &result) const;
+
+  /// Preprocesses GLSL source that is already in memory.
+  /// \param source GLSL source string
+  /// \param path path used to resolve relative includes and reported as files[0]
+  bool processSource(const std::string &source,
+                     const std::string &path,
+                     const std::vector<std::string> &defines,
+                     PreprocessedShader &result) const;
+
+  /// Builds the '#define' block for a set of defines, one directive per line.
+  static std::string BuildDefineBlock(const std::vector<std::string> &defines);
+
+ private:
+  bool expand(const std::string &source,
+              const std::string &path,
+              size_t fileIndex,
+              const std::string &defineBlock,
+              bool &definesInjected,
+              PreprocessedShader &result,
+              std::set<std::string> &onceFiles,
+              std::vector<std::string> &includeStack) const;
+
+  bool resolve(const std::string &name, const std::string &includer, std::string &resolved) const;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_SHADERPREPROCESSOR_H_
@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_SHADERVARIANTCACHE_H_
+#define RENDOR_INCLUDE_CG_COMMON_SHADERVARIANTCACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cg/common/Program.h"
+#include "cg/common/ProgramCache.h"
+#include "cg/common/ShaderLibrary.h"
+#include "cg/common/ShaderPreprocessor.h"
+
+namespace cg {
+
+/// ShaderVariantCache - Builds specialized variants of a program from a set of feature toggles. Bit i of a permutation
+/// mask enables features[i], which is injected as a '#define', so every variant is compiled without dead branches.
+/// Variants are compiled lazily on first use by get(), or up front by prewarm(). Both must be called on the thread
+/// that owns the OpenGL context.
+class ShaderVariantCache {
+ private:
+  std::vector<ShaderStageFile> stages;
+  std::vector<std::string> features;
+  const ShaderPreprocessor &preprocessor;
+  ProgramBinaryCache *cache;
+  bool separable;
+
+  std::unordered_map<uint64_t, std::unique_ptr<ShaderProgram>> variants;
+  std::set<std::string> dependencies;
+
+ public:
+  /// \param stages the GLSL files of every stage, shared by all variants
+  /// \param features the define of every permutation bit, at most 64
+  /// \param preprocessor resolves includes, must outlive the cache
+  /// \param cache optional binary cache, not owned by the variant cache
+  /// \param separable link variants as separable programs, e.g. to combine single-stage variants in a ProgramPipeline
+  ShaderVariantCache(const std::vector<ShaderStageFile> &stages,
+                     const std::vector<std::string> &features,
+                     const ShaderPreprocessor &preprocessor,
+                     ProgramBinaryCache *cache = nullptr,
+                     bool separable = false);
+  ShaderVariantCache(const ShaderVariantCache &otherCopy) = delete;
+  ShaderVariantCache(const ShaderVariantCache &&otherMove) = delete;
+
+  /// Gets a variant, compiling it if this is the first time it is requested.
+  /// \param mask permutation bitmask, bit i enables features[i]
+  /// \return the variant, or nullptr if it failed to build (failures are cached too)
+  ShaderProgram *get(uint64_t mask);
+
+  /// Builds a set of variants at once. Sources are preprocessed on worker threads and all compiles and links are
+  /// issued before any result is queried, so drivers with parallel shader compilation build them concurrently.
+  void prewarm(const std::vector<uint64_t> &masks);
+
+  /// Checks if a variant was already built.
+  bool contains(uint64_t mask) const;
+
+  /// Drops every variant, e.g. after one of the source files changed.
+  void clear();
+
+  size_t size() const;
+
+  /// Gets the defines of a permutation.
+  std::vector<std::string> getDefines(uint64_t mask) const;
+
+  /// Gets every file the built variants were preprocessed from, including resolved includes.
+  const std::set<std::string> &getDependencies() const;
+
+ private:
+  bool preprocess(uint64_t mask, std::vector<ShaderStageSource> &sources, std::vector<std::string> &files) const;
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_SHADERVARIANTCACHE_H_
@@ -0,0 +1,98 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDOR_INCLUDE_CG_COMMON_TEXTURE_H_
+#define RENDOR_INCLUDE_CG_COMMON_TEXTURE_H_
+
+#include <cstddef>
+#include <string>
+#include <glad/glad.h>
+
+#include "cg/common/Handlable.h"
+#include "cg/common/Bindable.h"
+#include "cg/MemoryTracker.h"
+
+namespace cg {
+
+/// Texture2D - 2D texture with immutable storage (glTexStorage2D), the size and number of levels are fixed when it is
+/// created. Changing them means creating a new texture and swapping it in, see swap.
+class Texture2D : public Handlable<unsigned int>, public Bindable {
+ private:
+  int width;
+  int height;
+  int levels;
+  GLenum internalFormat;
+  unsigned int unit = 0;
+  TrackedMemory memory{MemoryCategory::Texture};
+
+ public:
+  /// Allocates every level, their contents are undefined until uploaded.
+  /// \param levels number of levels, see GetLevelCount for a full mip chain
+  Texture2D(int width, int height, int levels, GLenum internalFormat = GL_SRGB8_ALPHA8);
+  ~Texture2D();
+
+  Texture2D(const Texture2D &otherCopy) = delete;
+  Texture2D(const Texture2D &&otherMove) = delete;
+
+  /// Uploads RGBA8 pixels into a region of a level. With a buffer bound to GL_PIXEL_UNPACK_BUFFER, pixels is an
+  /// offset into that buffer and the upload does not wait for the copy.
+  void upload(int level, int x, int y, int width, int height, const void *pixels);
+
+  /// Restricts sampling to the levels [base, max], e.g. to the levels that were uploaded so far.
+  void setLevelRange(int base, int max);
+
+  void setFilter(GLenum minFilter, GLenum magFilter);
+  void setWrap(GLenum wrap);
+
+  /// Sets the texture unit bind() binds the texture to, 0 by default.
+  void setUnit(unsigned int unit);
+
+  void bind() override;
+  void unbind() override;
+
+  int getWidth() const;
+  int getHeight() const;
+  int getLevelCount() const;
+  GLenum getInternalFormat() const;
+
+  /// Exchanges the textures of two objects, so a reallocated texture can replace this one while every pointer to this
+  /// object stays valid.
+  void swap(Texture2D &other);
+
+  /// Sets the asset the texture is accounted to in the MemoryTracker.
+  void setAssetName(const std::string &name);
+
+  /// Gets the number of levels of a full mip chain down to 1x1.
+  static int GetLevelCount(int width, int height);
+
+  /// Gets the bytes all levels of a texture occupy.
+  static size_t GetStorageSize(int width, int height, int levels, GLenum internalFormat);
+
+ private:
+  void trackStorageSize();
+};
+
+}
+
+#endif //RENDOR_INCLUDE_CG_COMMON_TEXTURE_H_
@@ -27,11 +27,15 @@
 
 #include "cg/common/Handlable.h"
 #include "cg/common/Bindable.h"
+#include "cg/MemoryTracker.h"
 #include <glad/glad.h>
 
 namespace cg {
 
 class VertexArray : public Handlable<unsigned int>, public Bindable {
+ private:
+  TrackedMemory memory{MemoryCategory::VertexArray};
+
  public:
   VertexArray() {
     glGenVertexArrays(1, &this->handle);
@@ -51,6 +55,11 @@ class VertexArray : public Handlable<unsigned int>, public Bindable {
   void unbind() override {
     glBindVertexArray(0);
   }
+
+  /// Sets the asset the vertex array is accounted to in the MemoryTracker.
+  void setAssetName(const std::string &name) {
+    memory.rename(name);
+  }
 };
 
 }
@@ -22,12 +22,50 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
 #include "cg/Application.h"
+#include "cg/HeapStatistics.h"
+#include "cg/Profiler.h"
 
 namespace cg {
 
-Application::Application(int glMajor, int glMinor, const std::string &title, int width, int height)
-    : title(title), width(width), height(height) {
+Application::Application(int glMajor, int glMinor, const std::string &title, int width, int height,
+                         const HeadlessSettings &headless)
+    : title(title), width(width), height(height), headlessSettings(headless) {
+  if (this->headlessSettings.enabled) {
+    if (!this->headlessContext.create(glMajor, glMinor)) {
+      fprintf(stderr, "Error: could not create a headless OpenGL %d.%d context\n", glMajor, glMinor);
+      this->stopRequested = true;
+      return;
+    }
+
+    if (!this->loader.start(glMajor, glMinor, this->headlessContext)) {
+      fprintf(stderr, "Error: could not create the loader context, loading on the main thread instead\n");
+    }
+
+    this->framebuffer = new Framebuffer(this->width, this->height);
+    this->framebuffer->bind();
+    if (!this->headlessSettings.dumpDirectory.empty()) {
+#ifdef _WIN32
+      _mkdir(this->headlessSettings.dumpDirectory.c_str());
+#else
+      mkdir(this->headlessSettings.dumpDirectory.c_str(), 0755);
+#endif
+    }
+    return;
+  }
+
   glfwInit();
   glfwWindowHint(GLFW_VERSION_MAJOR, glMajor);
   glfwWindowHint(GLFW_VERSION_MINOR, glMinor);
@@ -38,52 +76,239 @@ Application::Application(int glMajor, int glMinor, const std::string &title, int
   glfwSetFramebufferSizeCallback(this->handle, OnViewportResizeCallback);
   glfwSetKeyCallback(this->handle, OnKeyInputCallback);
   glfwSetCursorPosCallback(this->handle, OnMouseMoveCallback);
+  glfwSetMouseButtonCallback(this->handle, OnMouseButtonCallback);
+  glfwSetScrollCallback(this->handle, OnScrollCallback);
 
   glfwMakeContextCurrent(this->handle);
   gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
-  glfwSwapInterval(1);
+  applyPresentMode();
+
+  if (!this->loader.start(this->handle)) {
+    fprintf(stderr, "Error: could not create the loader context, loading on the main thread instead\n");
+  }
 }
 
 Application::~Application() {
+  if (this->headlessSettings.enabled) {
+    if (this->headlessContext.isCreated()) {
+      this->loader.stop();
+      for (GLsync fence : this->frameFences) {
+        glDeleteSync(fence);
+      }
+      Profiler::Get().releaseGpuResources();
+      delete this->framebuffer;
+    }
+    this->headlessContext.destroy();
+    return;
+  }
+
+  this->loader.stop();
+  Profiler::Get().releaseGpuResources();
   glfwDestroyWindow(this->handle);
 }
 
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+/// The simulation steps of one frame, referenced by the update task so it fits std::function's inline storage.
+struct UpdatePlan {
+  int updates = 0;
+  float step = 0.0f;
+  double milliseconds = 0.0;
+};
+
+}
+
 void Application::run() {
+
+  Profiler &profiler = Profiler::Get();
+  profiler.setThreadName("Main");
+
+  if (this->stopRequested) {
+    return;
+  }
   this->onInit();
 
-  double time = glfwGetTime();
-  double deltaTime;
-  while (!glfwWindowShouldClose(this->handle)) {
+  bool headless = isHeadless();
+  Clock::time_point previous = Clock::now();
+  double accumulator = 0.0;
+  float previousAlpha = 1.0f;
+  std::unique_ptr<FrameWorker> simulation;
+  this->framePacer.reset();
+  while (!shouldClose(this->frameTimings.frame)) {
+    uint64_t allocationsStart = HeapStatistics::GetAllocationCount();
+    profiler.beginFrame();
+    FrameTimings timings;
+    timings.frame = this->frameTimings.frame + 1;
+
+    Clock::time_point frameStart = Clock::now();
 
-    double currentTime = glfwGetTime();
-    deltaTime = currentTime - time;
-    this->onUpdate(deltaTime);
-    time = currentTime;
+    // Sample input as late as possible, right before it is consumed by the update
+    if (!headless) {
+      CG_PROFILE_SCOPE("PollEvents");
+      glfwPollEvents();
+    }
+    bool captured = ImGui::IsAnyWindowFocused();
+    this->input.sample(captured, captured);
+    this->onFrame(this->input);
+
+    // Clamp the delta so a breakpoint or a long load does not produce a huge simulation step
+    double deltaTime = std::min(std::chrono::duration<double>(frameStart - previous).count(), 0.25);
+    previous = frameStart;
 
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
-    this->onGui();
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // Decide the simulation steps up front, so they can run here or on the simulation thread
+    float step = static_cast<float>(deltaTime);
+    if (this->frameLoopSettings.fixedTimestep && this->frameLoopSettings.fixedDelta > 0.0) {
+      double fixedDelta = this->frameLoopSettings.fixedDelta;
+      accumulator += deltaTime;
+      while (accumulator >= fixedDelta && timings.updates < this->frameLoopSettings.maxUpdatesPerFrame) {
+        accumulator -= fixedDelta;
+        timings.updates++;
+      }
+
+      // Could not keep up, drop the backlog instead of carrying it into the next frame
+      if (accumulator >= fixedDelta) {
+        accumulator = std::fmod(accumulator, fixedDelta);
+      }
+      step = static_cast<float>(fixedDelta);
+      timings.alpha = static_cast<float>(accumulator / fixedDelta);
+    } else {
+      timings.updates = 1;
+      timings.alpha = 1.0f;
+    }
+
+    UpdatePlan plan;
+    plan.updates = timings.updates;
+    plan.step = step;
+    std::function<void()> update = [this, &plan]() {
+      CG_PROFILE_SCOPE("Update");
+      Clock::time_point start = Clock::now();
+      for (int i = 0; i < plan.updates; i++) {
+        this->onUpdate(plan.step);
+      }
+      plan.milliseconds = Milliseconds(start, Clock::now());
+    };
+
+    // The render of this frame shows the state the previous update published, so it uses that update's alpha
+    bool threaded = this->frameLoopSettings.threadedSimulation;
+    float renderAlpha = timings.alpha;
+    if (threaded) {
+      if (!simulation) {
+        simulation.reset(new FrameWorker("Simulation"));
+      }
+      simulation->kick(update);
+      renderAlpha = previousAlpha;
+    } else {
+      update();
+    }
+    previousAlpha = timings.alpha;
+    Clock::time_point updateEnd = Clock::now();
+
+    if (headless) {
+      // The application may have bound other framebuffers last frame
+      this->framebuffer->bind();
+    }
+
+    {
+      CG_PROFILE_SCOPE("Render");
+      CG_PROFILE_GPU_SCOPE("Render");
+      this->loader.update();
+      this->onRender(renderAlpha);
+    }
+    if (threaded) {
+      CG_PROFILE_SCOPE("Wait for Simulation");
+      simulation->wait();
+    }
+    Clock::time_point renderEnd = Clock::now();
 
-    ImGuiIO &io = ImGui::GetIO();
-    if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
     {
-      GLFWwindow* backup_current_context = glfwGetCurrentContext();
-      ImGui::UpdatePlatformWindows();
-      ImGui::RenderPlatformWindowsDefault();
-      glfwMakeContextCurrent(backup_current_context);
+      CG_PROFILE_SCOPE("GUI");
+      CG_PROFILE_GPU_SCOPE("GUI");
+      ImGui_ImplOpenGL3_NewFrame();
+      if (headless) {
+        ImGuiIO &io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(static_cast<float>(this->width), static_cast<float>(this->height));
+        io.DeltaTime = std::max(static_cast<float>(deltaTime), 1e-6f);
+      } else {
+        ImGui_ImplGlfw_NewFrame();
+      }
+      ImGui::NewFrame();
+      {
+        CG_PROFILE_SCOPE("onGui");
+        this->onGui();
+      }
+      {
+        CG_PROFILE_SCOPE("ImGui::Render");
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      }
+
+      ImGuiIO &io = ImGui::GetIO();
+      if (!headless && (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable))
+      {
+        CG_PROFILE_SCOPE("Platform Windows");
+        GLFWwindow* backup_current_context = glfwGetCurrentContext();
+        ImGui::UpdatePlatformWindows();
+        ImGui::RenderPlatformWindowsDefault();
+        glfwMakeContextCurrent(backup_current_context);
+      }
+    }
+    Clock::time_point guiEnd = Clock::now();
+
+    if (headless) {
+      CG_PROFILE_SCOPE("Dump");
+      dumpFrame(timings.frame);
+      throttleFrames();
+    } else {
+      CG_PROFILE_SCOPE("SwapBuffers");
+      glfwSwapBuffers(this->handle);
+    }
+    Clock::time_point swapEnd = Clock::now();
+
+    if (this->frameLoopSettings.presentMode == PresentMode::Limited) {
+      CG_PROFILE_SCOPE("Wait");
+      this->framePacer.wait();
     }
+    Clock::time_point waitEnd = Clock::now();
 
-    glfwSwapBuffers(this->handle);
-    glfwPollEvents();
+    this->frameArena.reset();
+
+    timings.update = threaded ? plan.milliseconds : Milliseconds(frameStart, updateEnd);
+    timings.render = Milliseconds(updateEnd, renderEnd);
+    timings.gui = Milliseconds(renderEnd, guiEnd);
+    timings.swap = Milliseconds(guiEnd, swapEnd);
+    timings.wait = Milliseconds(swapEnd, waitEnd);
+    timings.total = Milliseconds(frameStart, Clock::now());
+    this->frameTimings = timings;
+    profiler.endFrame();
+
+    // Counted last, so the profiler's own bookkeeping belongs to the frame as well
+    this->frameTimings.allocations = HeapStatistics::GetAllocationCount() - allocationsStart;
   }
 }
 
+void Application::requestStop() {
+  this->stopRequested = true;
+}
+
+bool Application::isHeadless() {
+  return this->headlessSettings.enabled;
+}
+
+Framebuffer *Application::getFramebuffer() {
+  return this->framebuffer;
+}
+
 void Application::setTitle(const std::string &title) {
   this->title = title;
-  glfwSetWindowTitle(this->handle, this->title.c_str());
+  if (this->handle != nullptr) {
+    glfwSetWindowTitle(this->handle, this->title.c_str());
+  }
 }
 
 const std::string &Application::getTitle() {
@@ -93,11 +318,18 @@ const std::string &Application::getTitle() {
 void Application::setSize(int width, int height) {
   this->width = width;
   this->height = height;
-  glfwSetWindowSize(this->handle, this->width, this->height);
+  if (this->framebuffer != nullptr) {
+    this->framebuffer->resize(this->width, this->height);
+    this->onViewportResize(this->width, this->height);
+  } else if (this->handle != nullptr) {
+    glfwSetWindowSize(this->handle, this->width, this->height);
+  }
 }
 
 void Application::setAspectRatio(int nomer, int denom) {
-  glfwSetWindowAspectRatio(this->handle, nomer, denom);
+  if (this->handle != nullptr) {
+    glfwSetWindowAspectRatio(this->handle, nomer, denom);
+  }
 }
 
 int Application::getWidth() {
@@ -108,4 +340,90 @@ int Application::getHeight() {
   return this->height;
 }
 
-}
\ No newline at end of file
+void Application::setFrameLoopSettings(const FrameLoopSettings &settings) {
+  this->frameLoopSettings = settings;
+  this->framePacer.setTargetFrameRate(settings.targetFrameRate);
+  this->framePacer.reset();
+  applyPresentMode();
+}
+
+const FrameLoopSettings &Application::getFrameLoopSettings() {
+  return this->frameLoopSettings;
+}
+
+const FrameTimings &Application::getFrameTimings() {
+  return this->frameTimings;
+}
+
+const Input &Application::getInput() {
+  return this->input;
+}
+
+ScratchAllocator &Application::getFrameArena() {
+  return this->frameArena;
+}
+
+LoaderThread &Application::getLoader() {
+  return this->loader;
+}
+
+void Application::applyPresentMode() {
+  // Nothing is presented headless, run() only paces frames in PresentMode::Limited
+  if (this->handle == nullptr) {
+    return;
+  }
+
+  switch (this->frameLoopSettings.presentMode) {
+    case PresentMode::VSync:glfwSwapInterval(1);
+      break;
+    case PresentMode::AdaptiveVSync:
+      if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        glfwSwapInterval(-1);
+      } else {
+        glfwSwapInterval(1);
+      }
+      break;
+    case PresentMode::Uncapped:
+    case PresentMode::Limited:glfwSwapInterval(0);
+      break;
+  }
+}
+
+bool Application::shouldClose(uint64_t frame) {
+  if (this->stopRequested) {
+    return true;
+  }
+
+  if (isHeadless()) {
+    return this->headlessSettings.maxFrames > 0 && frame >= this->headlessSettings.maxFrames;
+  }
+  return glfwWindowShouldClose(this->handle);
+}
+
+void Application::dumpFrame(uint64_t frame) {
+  const HeadlessSettings &settings = this->headlessSettings;
+  if (settings.dumpDirectory.empty() || settings.dumpInterval == 0 || frame % settings.dumpInterval != 0) {
+    return;
+  }
+
+  std::vector<unsigned char> pixels;
+  this->framebuffer->readPixels(pixels);
+
+  char name[32];
+  snprintf(name, sizeof(name), "/frame_%06llu.ppm", static_cast<unsigned long long>(frame));
+  Framebuffer::WritePPM(settings.dumpDirectory + name, this->framebuffer->getWidth(),
+                        this->framebuffer->getHeight(), pixels);
+}
+
+void Application::throttleFrames() {
+  this->frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  while (this->frameFences.size() > std::max<size_t>(this->headlessSettings.maxFramesInFlight, 1)) {
+    GLsync fence = this->frameFences.front();
+    this->frameFences.erase(this->frameFences.begin());
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+  }
+}
+
+}
@@ -0,0 +1,307 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "cg/Camera.h"
+
+namespace cg {
+
+Frustum Frustum::FromMatrix(const glm::mat4 &matrix, ClipDepth depth) {
+  // Gribb and Hartmann: every plane is a sum or difference of the rows of the matrix
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+  }
+
+  glm::vec4 planes[6];
+  planes[Left] = rows[3] + rows[0];
+  planes[Right] = rows[3] - rows[0];
+  planes[Bottom] = rows[3] + rows[1];
+  planes[Top] = rows[3] - rows[1];
+  if (depth == ClipDepth::ReversedZeroToOne) {
+    planes[Near] = rows[3] - rows[2];
+    planes[Far] = rows[2];
+  } else {
+    planes[Near] = rows[3] + rows[2];
+    planes[Far] = rows[3] - rows[2];
+  }
+
+  Frustum frustum;
+  for (int i = 0; i < 6; i++) {
+    float length = glm::length(glm::vec3(planes[i]));
+
+    // The far plane of an infinite projection degenerates to a constant
+    if (length < 1e-6f) {
+      continue;
+    }
+    frustum.planes[frustum.planeCount++] = planes[i] / length;
+  }
+  return frustum;
+}
+
+bool Frustum::containsPoint(const glm::vec3 &point) const {
+  for (int i = 0; i < this->planeCount; i++) {
+    if (glm::dot(glm::vec3(this->planes[i]), point) + this->planes[i].w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const {
+  for (int i = 0; i < this->planeCount; i++) {
+    if (glm::dot(glm::vec3(this->planes[i]), center) + this->planes[i].w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersectsBox(const glm::vec3 &min, const glm::vec3 &max) const {
+  for (int i = 0; i < this->planeCount; i++) {
+    // Test the corner furthest along the plane normal, if that one is outside the whole box is
+    const glm::vec4 &plane = this->planes[i];
+    glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y,
+                     plane.z >= 0.0f ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Camera::Camera() : position(0.0f), rotation(1.0f, 0.0f, 0.0f, 0.0f) {}
+
+Camera Camera::Perspective(float fov, float aspect, float nearPlane, float farPlane) {
+  Camera camera;
+  camera.projectionType = ProjectionType::Perspective;
+  camera.fov = fov;
+  camera.aspect = aspect;
+  camera.nearPlane = nearPlane;
+  camera.farPlane = farPlane;
+  return camera;
+}
+
+Camera Camera::InfinitePerspective(float fov, float aspect, float nearPlane) {
+  Camera camera;
+  camera.projectionType = ProjectionType::InfinitePerspective;
+  camera.fov = fov;
+  camera.aspect = aspect;
+  camera.nearPlane = nearPlane;
+  return camera;
+}
+
+Camera Camera::Orthographic(float height, float aspect, float nearPlane, float farPlane) {
+  Camera camera;
+  camera.projectionType = ProjectionType::Orthographic;
+  camera.height = height;
+  camera.aspect = aspect;
+  camera.nearPlane = nearPlane;
+  camera.farPlane = farPlane;
+  return camera;
+}
+
+void Camera::setPosition(const glm::vec3 &position) {
+  if (position != this->position) {
+    this->position = position;
+    invalidate(ViewStale);
+  }
+}
+
+void Camera::setRotation(const glm::quat &rotation) {
+  if (rotation != this->rotation) {
+    this->rotation = rotation;
+    invalidate(ViewStale);
+  }
+}
+
+void Camera::lookAt(const glm::vec3 &target, const glm::vec3 &up) {
+  if (target == this->position) {
+    return;
+  }
+
+  // The rotation of a camera is the inverse of the rotation part of its view matrix
+  glm::mat4 view = glm::lookAt(this->position, target, up);
+  setRotation(glm::normalize(glm::conjugate(glm::quat_cast(glm::mat3(view)))));
+}
+
+void Camera::moveLocal(const glm::vec3 &offset) {
+  setPosition(this->position + getRight() * offset.x + getUp() * offset.y + getForward() * offset.z);
+}
+
+void Camera::setProjectionType(ProjectionType type) {
+  if (type != this->projectionType) {
+    this->projectionType = type;
+    invalidate(ProjectionStale);
+  }
+}
+
+void Camera::setFov(float degrees) {
+  if (degrees != this->fov) {
+    this->fov = degrees;
+    invalidate(ProjectionStale);
+  }
+}
+
+void Camera::setAspectRatio(float aspect) {
+  if (aspect != this->aspect) {
+    this->aspect = aspect;
+    invalidate(ProjectionStale);
+  }
+}
+
+void Camera::setAspectRatio(float width, float height) {
+  if (height > 0.0f) {
+    setAspectRatio(width / height);
+  }
+}
+
+void Camera::setNearPlane(float nearPlane) {
+  if (nearPlane != this->nearPlane) {
+    this->nearPlane = nearPlane;
+    invalidate(ProjectionStale);
+  }
+}
+
+void Camera::setFarPlane(float farPlane) {
+  if (farPlane != this->farPlane) {
+    this->farPlane = farPlane;
+    invalidate(ProjectionStale);
+  }
+}
+
+void Camera::setOrthographicHeight(float height) {
+  if (height != this->height) {
+    this->height = height;
+    invalidate(ProjectionStale);
+  }
+}
+
+glm::vec3 Camera::getForward() const {
+  return this->rotation * glm::vec3(0.0f, 0.0f, -1.0f);
+}
+
+glm::vec3 Camera::getRight() const {
+  return this->rotation * glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+glm::vec3 Camera::getUp() const {
+  return this->rotation * glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+ClipDepth Camera::getClipDepth() const {
+  return this->projectionType == ProjectionType::InfinitePerspective ? ClipDepth::ReversedZeroToOne
+                                                                     : ClipDepth::NegativeOneToOne;
+}
+
+const glm::mat4 &Camera::getViewMatrix() const {
+  if (this->stale & ViewStale) {
+    // A camera transform is rigid, so both directions follow from the rotation without a general inverse
+    glm::mat4 rotationMatrix = glm::mat4_cast(this->rotation);
+    this->inverseView = glm::translate(glm::mat4(1.0f), this->position) * rotationMatrix;
+    this->view = glm::transpose(rotationMatrix) * glm::translate(glm::mat4(1.0f), -this->position);
+    this->stale &= ~ViewStale;
+  }
+  return this->view;
+}
+
+const glm::mat4 &Camera::getInverseViewMatrix() const {
+  getViewMatrix();
+  return this->inverseView;
+}
+
+const glm::mat4 &Camera::getProjectionMatrix() const {
+  if (this->stale & ProjectionStale) {
+    switch (this->projectionType) {
+      case ProjectionType::Perspective: {
+        this->projection = glm::perspective(glm::radians(this->fov), this->aspect, this->nearPlane, this->farPlane);
+        break;
+      }
+      case ProjectionType::InfinitePerspective: {
+        // Depth is near / -z: 1 at the near plane, approaching 0 at infinity, where floats are most precise
+        float focal = 1.0f / std::tan(glm::radians(this->fov) * 0.5f);
+        this->projection = glm::mat4(0.0f);
+        this->projection[0][0] = focal / this->aspect;
+        this->projection[1][1] = focal;
+        this->projection[2][3] = -1.0f;
+        this->projection[3][2] = this->nearPlane;
+        break;
+      }
+      case ProjectionType::Orthographic: {
+        float halfHeight = this->height * 0.5f;
+        float halfWidth = halfHeight * this->aspect;
+        this->projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, this->nearPlane,
+                                      this->farPlane);
+        break;
+      }
+    }
+    this->stale &= ~ProjectionStale;
+  }
+  return this->projection;
+}
+
+const glm::mat4 &Camera::getInverseProjectionMatrix() const {
+  if (this->stale & InverseProjectionStale) {
+    this->inverseProjection = glm::inverse(getProjectionMatrix());
+    this->stale &= ~InverseProjectionStale;
+  }
+  return this->inverseProjection;
+}
+
+const glm::mat4 &Camera::getViewProjectionMatrix() const {
+  if (this->stale & ViewProjectionStale) {
+    this->viewProjection = getProjectionMatrix() * getViewMatrix();
+    this->stale &= ~ViewProjectionStale;
+  }
+  return this->viewProjection;
+}
+
+const glm::mat4 &Camera::getInverseViewProjectionMatrix() const {
+  if (this->stale & InverseViewProjectionStale) {
+    this->inverseViewProjection = getInverseViewMatrix() * getInverseProjectionMatrix();
+    this->stale &= ~InverseViewProjectionStale;
+  }
+  return this->inverseViewProjection;
+}
+
+const Frustum &Camera::getFrustum() const {
+  if (this->stale & FrustumStale) {
+    this->frustum = Frustum::FromMatrix(getViewProjectionMatrix(), getClipDepth());
+    this->stale &= ~FrustumStale;
+  }
+  return this->frustum;
+}
+
+void Camera::invalidate(unsigned int flags) {
+  // Everything combining view and projection depends on both
+  this->stale |= flags | ViewProjectionStale | InverseViewProjectionStale | FrustumStale;
+  if (flags & ProjectionStale) {
+    this->stale |= InverseProjectionStale;
+  }
+}
+
+}
@@ -0,0 +1,128 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <thread>
+
+#include "cg/FrameLoop.h"
+#include "cg/Profiler.h"
+
+namespace cg {
+
+FramePacer::FramePacer(double framesPerSecond) {
+  setTargetFrameRate(framesPerSecond);
+  reset();
+}
+
+void FramePacer::setTargetFrameRate(double framesPerSecond) {
+  double seconds = framesPerSecond > 0.0 ? 1.0 / framesPerSecond : 0.0;
+  this->period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+double FramePacer::wait() {
+  Clock::time_point start = Clock::now();
+  this->deadline += this->period;
+
+  // Far behind schedule (e.g. after loading), start over instead of racing to catch up
+  if (start > this->deadline + this->period) {
+    this->deadline = start;
+    return 0.0;
+  }
+
+  while (true) {
+    double remaining = std::chrono::duration<double>(this->deadline - Clock::now()).count();
+    if (remaining <= this->sleepEstimate) {
+      break;
+    }
+
+    Clock::time_point before = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double observed = std::chrono::duration<double>(Clock::now() - before).count();
+
+    // Welford's online variance, the estimate is one standard deviation above the mean
+    this->sleepCount++;
+    double delta = observed - this->sleepMean;
+    this->sleepMean += delta / this->sleepCount;
+    this->sleepM2 += delta * (observed - this->sleepMean);
+    this->sleepEstimate = this->sleepMean + std::sqrt(this->sleepM2 / (this->sleepCount - 1));
+  }
+
+  while (Clock::now() < this->deadline) {
+    std::this_thread::yield();
+  }
+
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void FramePacer::reset() {
+  this->deadline = Clock::now();
+}
+
+FrameWorker::FrameWorker(const std::string &name) {
+  this->thread = std::thread(&FrameWorker::work, this, name);
+}
+
+FrameWorker::~FrameWorker() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->quit = true;
+  }
+  this->condition.notify_all();
+  this->thread.join();
+}
+
+void FrameWorker::kick(const std::function<void()> &task) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->task = task;
+    this->pending = true;
+  }
+  this->condition.notify_all();
+}
+
+void FrameWorker::wait() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->condition.wait(lock, [this]() { return !this->pending; });
+}
+
+void FrameWorker::work(const std::string &name) {
+  Profiler::Get().setThreadName(name);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->condition.wait(lock, [this]() { return this->pending || this->quit; });
+    if (this->quit) {
+      return;
+    }
+
+    lock.unlock();
+    this->task();
+    lock.lock();
+
+    this->pending = false;
+    this->condition.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef RENDOR_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "cg/HeadlessContext.h"
+
+namespace cg {
+
+HeadlessContext::~HeadlessContext() {
+  destroy();
+}
+
+#ifdef RENDOR_HEADLESS_EGL
+
+static EGLDisplay OpenDisplay() {
+  // Prefer the surfaceless platform, it needs neither a display server nor a render node
+  const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (extensions != nullptr && strstr(extensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr) {
+      EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+        return display;
+      }
+    }
+  }
+
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+    return display;
+  }
+  return EGL_NO_DISPLAY;
+}
+
+bool HeadlessContext::create(int glMajor, int glMinor, const HeadlessContext *share) {
+  destroy();
+
+  // Shared contexts have to live on the same display, it is terminated by the context that opened it
+  EGLDisplay display = share != nullptr ? share->display : OpenDisplay();
+  if (display == EGL_NO_DISPLAY) {
+    fprintf(stderr, "Error: could not initialize an EGL display\n");
+    return false;
+  }
+  this->display = display;
+  this->ownsDisplay = share == nullptr;
+
+  const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+  bool surfaceless = extensions != nullptr && strstr(extensions, "EGL_KHR_surfaceless_context") != nullptr;
+
+  const EGLint configAttributes[] = {
+      EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8,
+      EGL_NONE
+  };
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+    fprintf(stderr, "Error: no EGL config supports desktop OpenGL\n");
+    destroy();
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    fprintf(stderr, "Error: EGL does not support desktop OpenGL\n");
+    destroy();
+    return false;
+  }
+
+  const EGLint contextAttributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, glMajor,
+      EGL_CONTEXT_MINOR_VERSION, glMinor,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE
+  };
+  this->context =
+      eglCreateContext(display, config, share != nullptr ? share->context : EGL_NO_CONTEXT, contextAttributes);
+  if (this->context == EGL_NO_CONTEXT) {
+    fprintf(stderr, "Error: could not create an OpenGL %d.%d core context (EGL error 0x%x)\n", glMajor, glMinor,
+            eglGetError());
+    this->context = nullptr;
+    destroy();
+    return false;
+  }
+
+  if (!surfaceless) {
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    this->surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (this->surface == EGL_NO_SURFACE) {
+      fprintf(stderr, "Error: could not create an EGL pbuffer surface\n");
+      this->surface = nullptr;
+      destroy();
+      return false;
+    }
+  }
+
+  makeCurrent();
+  if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+    fprintf(stderr, "Error: could not load the OpenGL functions\n");
+    destroy();
+    return false;
+  }
+  return true;
+}
+
+void HeadlessContext::makeCurrent() {
+  if (this->window != nullptr) {
+    glfwMakeContextCurrent(this->window);
+  } else if (this->context != nullptr) {
+    EGLSurface surface = this->surface != nullptr ? this->surface : EGL_NO_SURFACE;
+    eglMakeCurrent(this->display, surface, surface, this->context);
+  }
+}
+
+void HeadlessContext::release() {
+  if (this->window != nullptr) {
+    if (glfwGetCurrentContext() == this->window) {
+      glfwMakeContextCurrent(nullptr);
+    }
+  } else if (this->context != nullptr && eglGetCurrentContext() == this->context) {
+    eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+}
+
+void HeadlessContext::destroy() {
+  if (this->window != nullptr) {
+    glfwDestroyWindow(this->window);
+    this->window = nullptr;
+  }
+  if (this->display != nullptr) {
+    release();
+    if (this->surface != nullptr) {
+      eglDestroySurface(this->display, this->surface);
+    }
+    if (this->context != nullptr) {
+      eglDestroyContext(this->display, this->context);
+    }
+    if (this->ownsDisplay) {
+      eglTerminate(this->display);
+    }
+  }
+  this->display = nullptr;
+  this->context = nullptr;
+  this->surface = nullptr;
+  this->ownsDisplay = true;
+}
+
+bool HeadlessContext::isCreated() const {
+  return this->context != nullptr || this->window != nullptr;
+}
+
+#else
+
+bool HeadlessContext::create(int glMajor, int glMinor, const HeadlessContext *share) {
+  destroy();
+
+  if (!glfwInit()) {
+    fprintf(stderr, "Error: could not initialize GLFW\n");
+    return false;
+  }
+
+  glfwDefaultWindowHints();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glMajor);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glMinor);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  this->window = glfwCreateWindow(1, 1, "", nullptr, share != nullptr ? share->window : nullptr);
+  glfwDefaultWindowHints();
+  if (this->window == nullptr) {
+    fprintf(stderr, "Error: could not create a hidden window for the headless context\n");
+    return false;
+  }
+
+  makeCurrent();
+  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+    fprintf(stderr, "Error: could not load the OpenGL functions\n");
+    destroy();
+    return false;
+  }
+  return true;
+}
+
+void HeadlessContext::makeCurrent() {
+  if (this->window != nullptr) {
+    glfwMakeContextCurrent(this->window);
+  }
+}
+
+void HeadlessContext::release() {
+  if (this->window != nullptr && glfwGetCurrentContext() == this->window) {
+    glfwMakeContextCurrent(nullptr);
+  }
+}
+
+void HeadlessContext::destroy() {
+  if (this->window != nullptr) {
+    glfwDestroyWindow(this->window);
+  }
+  this->window = nullptr;
+}
+
+bool HeadlessContext::isCreated() const {
+  return this->window != nullptr;
+}
+
+#endif
+
+bool HeadlessContext::createShared(GLFWwindow *share) {
+  destroy();
+
+  // Contexts only share objects if they are compatible, so ask for exactly what the window got
+  glfwDefaultWindowHints();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glfwGetWindowAttrib(share, GLFW_CONTEXT_VERSION_MAJOR));
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glfwGetWindowAttrib(share, GLFW_CONTEXT_VERSION_MINOR));
+  glfwWindowHint(GLFW_OPENGL_PROFILE, glfwGetWindowAttrib(share, GLFW_OPENGL_PROFILE));
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  this->window = glfwCreateWindow(1, 1, "", nullptr, share);
+  glfwDefaultWindowHints();
+  if (this->window == nullptr) {
+    fprintf(stderr, "Error: could not create a context shared with the window\n");
+    return false;
+  }
+
+  makeCurrent();
+  return true;
+}
+
+GLFWwindow *HeadlessContext::getWindow() {
+  return this->window;
+}
+
+}
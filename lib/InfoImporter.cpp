@@ -22,76 +22,283 @@
  * SOFTWARE.
  */
 
+#include <chrono>
+#include <fstream>
+
 #include "cg/InfoImporter.h"
+#include "cg/VertexWelder.h"
 
 namespace cg {
 
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t Now() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+/// Share of the import time each stage usually takes, Idle to Simplifying
+const float kStageWeights[] = {0.0f, 0.6f, 0.05f, 0.1f, 0.2f, 0.05f};
+
+}
+
+const char *GetImportStageName(ImportStage stage) {
+  switch (stage) {
+    case ImportStage::Idle:return "Idle";
+    case ImportStage::Reading:return "Reading";
+    case ImportStage::Converting:return "Converting";
+    case ImportStage::Welding:return "Welding";
+    case ImportStage::Optimizing:return "Optimizing";
+    case ImportStage::Simplifying:return "Simplifying";
+    case ImportStage::Done:return "Done";
+    case ImportStage::Failed:return "Failed";
+    case ImportStage::Cancelled:return "Cancelled";
+  }
+  return "Unknown";
+}
+
+ImportStage ImportStatus::GetStage() const {
+  return static_cast<ImportStage>(stage_.load(std::memory_order_acquire));
+}
+
+float ImportStatus::GetStageProgress() const {
+  return stage_progress_.load(std::memory_order_relaxed);
+}
+
+float ImportStatus::GetProgress() const {
+  ImportStage stage = GetStage();
+  if (stage == ImportStage::Done) {
+    return 1.0f;
+  }
+  if (stage == ImportStage::Idle || stage == ImportStage::Failed || stage == ImportStage::Cancelled) {
+    return 0.0f;
+  }
+
+  int current = static_cast<int>(stage);
+  float progress = 0.0f;
+  for (int i = 0; i < current; ++i) {
+    progress += kStageWeights[i];
+  }
+  return progress + kStageWeights[current] * GetStageProgress();
+}
+
+uint64_t ImportStatus::GetBytesProcessed() const {
+  return bytes_processed_.load(std::memory_order_relaxed);
+}
+
+uint64_t ImportStatus::GetBytesTotal() const {
+  return bytes_total_.load(std::memory_order_relaxed);
+}
+
+double ImportStatus::GetElapsedSeconds() const {
+  uint64_t start = start_time_.load(std::memory_order_relaxed);
+  if (start == 0) {
+    return 0.0;
+  }
+  uint64_t end = end_time_.load(std::memory_order_relaxed);
+  return static_cast<double>((end != 0 ? end : Now()) - start) / 1e9;
+}
+
+double ImportStatus::GetEtaSeconds() const {
+  float progress = GetProgress();
+  if (!IsRunning() || progress < 0.01f) {
+    return -1.0;
+  }
+  return GetElapsedSeconds() * (1.0 - progress) / progress;
+}
+
+bool ImportStatus::IsRunning() const {
+  ImportStage stage = GetStage();
+  return stage != ImportStage::Idle && stage != ImportStage::Done && stage != ImportStage::Failed
+      && stage != ImportStage::Cancelled;
+}
+
+void ImportStatus::RequestCancel() {
+  cancel_requested_.store(true, std::memory_order_relaxed);
+}
+
+bool ImportStatus::IsCancelRequested() const {
+  return cancel_requested_.load(std::memory_order_relaxed);
+}
+
+void ImportStatus::Begin() {
+  cancel_requested_.store(false, std::memory_order_relaxed);
+  end_time_.store(0, std::memory_order_relaxed);
+  start_time_.store(Now(), std::memory_order_relaxed);
+}
+
+void ImportStatus::SetStage(ImportStage stage, uint64_t bytes_total) {
+  stage_progress_.store(0.0f, std::memory_order_relaxed);
+  bytes_processed_.store(0, std::memory_order_relaxed);
+  bytes_total_.store(bytes_total, std::memory_order_relaxed);
+  if (stage == ImportStage::Done || stage == ImportStage::Failed || stage == ImportStage::Cancelled) {
+    end_time_.store(Now(), std::memory_order_relaxed);
+  }
+  stage_.store(static_cast<int>(stage), std::memory_order_release);
+}
+
+void ImportStatus::SetStageProgress(float progress) {
+  stage_progress_.store(progress, std::memory_order_relaxed);
+  bytes_processed_.store(static_cast<uint64_t>(progress * GetBytesTotal()), std::memory_order_relaxed);
+}
+
+AsyncInfoImporter::~AsyncInfoImporter() {
+  // Earlier imports were cancelled when the latest one started, the jobs still touch this until they are done
+  status_->RequestCancel();
+  JobSystem::Get().wait(job_);
+}
+
 void AsyncInfoImporter::LoadAsync(const std::string &file) {
-  this->future_ = std::async(std::launch::async, &AsyncInfoImporter::ImportMeshInfo, this, file, 0);
+  // Only the latest import counts: a running one is cancelled but not waited for, it drops its result once it sees
+  // that a newer import started, and the result of a previous one is replaced
+  status_->RequestCancel();
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(result_mutex_);
+    generation = ++generation_;
+    ready_ = false;
+  }
+
+  std::shared_ptr<ImportStatus> status = std::make_shared<ImportStatus>();
+  status->Begin();
+  status->SetStage(ImportStage::Reading);
+  status_ = status;
+  JobSystem::Get().run([this, file, status, generation]() {
+    MeshInfo info;
+    OptimizationStats stats;
+    if (!ImportMeshInfo(*status, file, 0, info, stats)) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(result_mutex_);
+      if (generation != generation_) {
+        // Finished before it noticed the cancellation, the data is freed with info
+        status->SetStage(ImportStage::Cancelled);
+        return;
+      }
+      result_ = std::move(info);
+      stats_ = stats;
+      ready_ = true;
+    }
+    status->SetStage(ImportStage::Done);
+  }, &job_);
 }
 
-cg::MeshInfo AsyncInfoImporter::ImportMeshInfo(AsyncInfoImporter *i, const std::string &file, unsigned int index) {
-  i->ready_ = false;
-  i->progress = 0.0f;
-  std::cout << "Importing...\n";
+void AsyncInfoImporter::Cancel() {
+  status_->RequestCancel();
+}
+
+bool AsyncInfoImporter::ImportOptimized(ImportStatus &status, const std::string &file, unsigned int index,
+                                        unsigned int flags, std::vector<cg::Vertex> &vertices,
+                                        std::vector<unsigned int> &indices, OptimizationStats *stats) {
+  // Checked between the stages, the buffers of the stages done so far are freed on the way out
+  auto cancelled = [&status]() {
+    if (!status.IsCancelRequested()) {
+      return false;
+    }
+    status.SetStage(ImportStage::Cancelled);
+    return true;
+  };
+
+  std::ifstream stream(file, std::ios::binary | std::ios::ate);
+  status.SetStage(ImportStage::Reading, stream ? static_cast<uint64_t>(stream.tellg()) : 0);
+  stream.close();
+
+  Handler handler(&status);
   Assimp::Importer importer;
-  Handler *handler = new Handler(i);
-  importer.SetProgressHandler(handler);
+  importer.SetProgressHandler(&handler);
 
-  const aiScene *scene = importer.ReadFile(file, aiProcess_Triangulate | aiProcess_OptimizeGraph | aiProcess_OptimizeMeshes | aiProcess_FindInvalidData | aiProcess_PreTransformVertices
-       | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType
-  );
+  const aiScene *scene = importer.ReadFile(file, flags);
+  // The importer would delete the handler when it is destroyed, take it back as it is only used while reading
+  importer.SetProgressHandler(nullptr);
 
+  // Assimp does not abort every step when asked to, check again once it returned
+  if (cancelled()) {
+    return false;
+  }
   if (!scene) {
     std::cerr << "Import error: " << importer.GetErrorString() << "\n";
-  } else {
-    std::cout << "Import finished!\n";
+    status.SetStage(ImportStage::Failed);
+    return false;
+  }
+  if (index >= scene->mNumMeshes) {
+    std::cerr << "Import error: " << file << " has no mesh " << index << "\n";
+    status.SetStage(ImportStage::Failed);
+    return false;
   }
 
   aiMesh *mesh = scene->mMeshes[index];
-  std::vector<cg::Vertex> verts;
-  std::vector<unsigned int> inds;
-  for (int i = 0; i < mesh->mNumVertices; ++i) {
-    cg::Vertex vertex;
-    vertex.position.x = mesh->mVertices[i].x;
-    vertex.position.y = mesh->mVertices[i].y;
-    vertex.position.z = mesh->mVertices[i].z;
-    vertex.normal.x = mesh->mNormals[i].x;
-    vertex.normal.y = mesh->mNormals[i].y;
-    vertex.normal.z = mesh->mNormals[i].z;
-    verts.push_back(vertex);
-  }
+  status.SetStage(ImportStage::Converting,
+                  mesh->mNumVertices * sizeof(cg::Vertex) + mesh->mNumFaces * 3 * sizeof(unsigned int));
+  std::vector<cg::Vertex> finalVertices;
+  std::vector<unsigned int> finalIndices;
+  size_t vertexCount;
+  size_t indexCount;
+  {
+    // The unwelded data and the remap live in the job's scratch arena. The scope ends, and rewinds the arena, as soon
+    // as the welded buffers exist, so they are gone before the optimization allocates
+    ScratchScope scratch;
+    ArenaVector<cg::Vertex> verts;
+    ArenaVector<unsigned int> inds;
+    ConvertMesh(mesh, verts, inds);
 
-  for (int j = 0; j < mesh->mNumFaces; ++j) {
-    aiFace face = mesh->mFaces[j];
-    for (int i = 0; i < face.mNumIndices; ++i) {
-      inds.push_back(face.mIndices[i]);
-    }
-  }
+    // Everything needed was copied out, do not hold the scene through the optimization
+    importer.FreeScene();
 
-  verts.shrink_to_fit();
-  inds.shrink_to_fit();
-  size_t indexCount = inds.size();
+    indexCount = inds.size();
+    if (indexCount == 0) {
+      std::cerr << "Import error: " << file << " has no triangles\n";
+      status.SetStage(ImportStage::Failed);
+      return false;
+    }
+    if (cancelled()) {
+      return false;
+    }
 
-  std::vector<unsigned int> remap(indexCount);
-  size_t vertexCount =
-      meshopt_generateVertexRemap(&remap[0], &inds[0], indexCount, &verts[0], verts.size(), sizeof(cg::Vertex));
+    status.SetStage(ImportStage::Welding, verts.size() * sizeof(cg::Vertex) + indexCount * sizeof(unsigned int));
+    ArenaVector<unsigned int> remap(verts.size());
+    finalVertices.resize(verts.size());
+    vertexCount = WeldVertices(&remap[0], &finalVertices[0], &inds[0], indexCount, &verts[0], verts.size());
+    status.SetStageProgress(0.5f);
 
-  std::vector<cg::Vertex> finalVertices(vertexCount);
-  std::vector<unsigned int> finalIndices(indexCount);
+    finalIndices.resize(indexCount);
+    meshopt_remapIndexBuffer(&finalIndices[0], &inds[0], indexCount, &remap[0]);
+  }
 
-  meshopt_remapIndexBuffer(&finalIndices[0], &inds[0], indexCount, &remap[0]);
-  meshopt_remapVertexBuffer(&finalVertices[0], &verts[0], vertexCount, sizeof(cg::Vertex), &remap[0]);
+  // Only trimmed once the unwelded data is gone, so the copy shrink_to_fit makes does not add to the peak
+  finalVertices.resize(vertexCount);
+  finalVertices.shrink_to_fit();
+  if (cancelled()) {
+    return false;
+  }
 
-  meshopt_VertexCacheStatistics
-      beforeVertexCache = meshopt_analyzeVertexCache(&finalIndices[00], indexCount, vertexCount, 32, 32, 32);
-  meshopt_OverdrawStatistics beforeOverdraw =
-      meshopt_analyzeOverdraw(&finalIndices[0], indexCount, &finalVertices[0].position.x, vertexCount,
-                              sizeof(cg::Vertex));
-  meshopt_VertexFetchStatistics beforeFetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
-                                                                         sizeof(cg::Vertex));
+  status.SetStage(ImportStage::Optimizing, vertexCount * sizeof(cg::Vertex) + indexCount * sizeof(unsigned int));
+  if (stats) {
+    meshopt_VertexCacheStatistics vertexCache = meshopt_analyzeVertexCache(&finalIndices[0], indexCount, vertexCount,
+                                                                           32, 32, 32);
+    meshopt_OverdrawStatistics overdraw = meshopt_analyzeOverdraw(&finalIndices[0], indexCount,
+                                                                  &finalVertices[0].position.x, vertexCount,
+                                                                  sizeof(cg::Vertex));
+    meshopt_VertexFetchStatistics fetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
+                                                                     sizeof(cg::Vertex));
+    stats->acmr_before = vertexCache.acmr;
+    stats->atvr_before = vertexCache.atvr;
+    stats->overdraw_before = overdraw.overdraw;
+    stats->overfetch_before = fetch.overfetch;
+    stats->indices_before = static_cast<unsigned int>(indexCount);
+  }
+  status.SetStageProgress(0.1f);
+  if (cancelled()) {
+    return false;
+  }
 
   meshopt_optimizeVertexCache(&finalIndices[0], &finalIndices[0], indexCount, vertexCount);
+  status.SetStageProgress(0.4f);
+  if (cancelled()) {
+    return false;
+  }
 
   meshopt_optimizeOverdraw(&finalIndices[0],
                            &finalIndices[0],
@@ -100,56 +307,129 @@ cg::MeshInfo AsyncInfoImporter::ImportMeshInfo(AsyncInfoImporter *i, const std::
                            vertexCount,
                            sizeof(cg::Vertex),
                            1.05f);
+  status.SetStageProgress(0.7f);
+  if (cancelled()) {
+    return false;
+  }
 
   meshopt_optimizeVertexFetch(&finalVertices[0], &finalIndices[0], indexCount, &finalVertices[0], vertexCount,
                               sizeof(cg::Vertex));
 
-  meshopt_VertexCacheStatistics
-      afterVertexCache = meshopt_analyzeVertexCache(&finalIndices[0], indexCount, vertexCount, 32, 32, 32);
-  meshopt_OverdrawStatistics
-      afterOverdraw = meshopt_analyzeOverdraw(&finalIndices[0], indexCount, &finalVertices[0].position.x, vertexCount,
-                                              sizeof(cg::Vertex));
-  meshopt_VertexFetchStatistics afterFetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
-                                                                        sizeof(cg::Vertex));
+  if (stats) {
+    meshopt_VertexCacheStatistics vertexCache = meshopt_analyzeVertexCache(&finalIndices[0], indexCount, vertexCount,
+                                                                           32, 32, 32);
+    meshopt_OverdrawStatistics overdraw = meshopt_analyzeOverdraw(&finalIndices[0], indexCount,
+                                                                  &finalVertices[0].position.x, vertexCount,
+                                                                  sizeof(cg::Vertex));
+    meshopt_VertexFetchStatistics fetch = meshopt_analyzeVertexFetch(&finalIndices[0], indexCount, vertexCount,
+                                                                     sizeof(cg::Vertex));
+    stats->acmr_after = vertexCache.acmr;
+    stats->atvr_after = vertexCache.atvr;
+    stats->overdraw_after = overdraw.overdraw;
+    stats->overfetch_after = fetch.overfetch;
+    stats->indices_after = static_cast<unsigned int>(indexCount);
+  }
+  if (cancelled()) {
+    return false;
+  }
+
+  vertices = std::move(finalVertices);
+  indices = std::move(finalIndices);
+  return true;
+}
+
+bool AsyncInfoImporter::ImportMeshInfo(ImportStatus &status, const std::string &file, unsigned int index,
+                                       MeshInfo &info, OptimizationStats &stats) {
+  std::cout << "Importing...\n";
+  std::vector<cg::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  if (!ImportOptimized(status, file, index, GetImportFlags(), vertices, indices, &stats)) {
+    return false;
+  }
+  std::cout << "Import finished!\n";
 
+  size_t indexCount = indices.size();
+  status.SetStage(ImportStage::Simplifying, vertices.size() * sizeof(cg::Vertex) + indexCount * sizeof(unsigned int));
   std::vector<unsigned int> simplified(indexCount);
-  simplified.resize(meshopt_simplify(&simplified[0], &finalIndices[0], indexCount, &finalVertices[0].position.x, vertexCount, sizeof(cg::Vertex), indexCount - indexCount / 3, 0.25f));
-
-  float acmr_before = beforeVertexCache.acmr;
-  float acmr_after = afterVertexCache.acmr;
-  float atvr_before = beforeVertexCache.atvr;
-  float atvr_after = afterVertexCache.atvr;
-  float overdraw_before = beforeOverdraw.overdraw;
-  float overdraw_after = afterOverdraw.overdraw;
-  float overfetch_before = beforeFetch.overfetch;
-  float overfetch_after = afterFetch.overfetch;
-  unsigned int indices_after = simplified.size();
-
-  OptimizationStats s =
-      {acmr_before, acmr_after, atvr_before, atvr_after, overdraw_before, overdraw_after, overfetch_before,
-       overfetch_after, indexCount, indices_after};
-  i->stats_ = s;
-
-  i->ready_ = true;
-  importer.SetProgressHandler(nullptr);
-  delete handler;
+  simplified.resize(meshopt_simplify(&simplified[0], &indices[0], indexCount, &vertices[0].position.x, vertices.size(),
+                                     sizeof(cg::Vertex), indexCount - indexCount / 3, 0.25f));
+  std::vector<unsigned int>().swap(indices);
+  if (status.IsCancelRequested()) {
+    status.SetStage(ImportStage::Cancelled);
+    return false;
+  }
+  stats.indices_after = static_cast<unsigned int>(simplified.size());
 
-  MeshInfo info(finalVertices, simplified);
-  return info;
+  info = MeshInfo(std::move(vertices), std::move(simplified));
+  info.SetAssetName(file);
+  return true;
+}
+
+unsigned int AsyncInfoImporter::GetImportFlags() {
+  return aiProcess_Triangulate | aiProcess_OptimizeGraph | aiProcess_OptimizeMeshes | aiProcess_FindInvalidData
+      | aiProcess_PreTransformVertices | aiProcess_GenSmoothNormals | aiProcess_SortByPType;
+}
+
+template<typename VertexVector, typename IndexVector>
+void AsyncInfoImporter::ConvertMesh(const aiMesh *mesh, VertexVector &vertices, IndexVector &indices) {
+  vertices.clear();
+  indices.clear();
+  vertices.reserve(mesh->mNumVertices);
+  indices.reserve(mesh->mNumFaces * 3);
+
+  for (int i = 0; i < mesh->mNumVertices; ++i) {
+    cg::Vertex vertex = {};
+    vertex.position.x = mesh->mVertices[i].x;
+    vertex.position.y = mesh->mVertices[i].y;
+    vertex.position.z = mesh->mVertices[i].z;
+    vertex.normal.x = mesh->mNormals[i].x;
+    vertex.normal.y = mesh->mNormals[i].y;
+    vertex.normal.z = mesh->mNormals[i].z;
+    vertex.uv = mesh->HasTextureCoords(0) ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y)
+                                          : glm::vec2(0.0f);
+    vertices.push_back(vertex);
+  }
+
+  for (int j = 0; j < mesh->mNumFaces; ++j) {
+    const aiFace &face = mesh->mFaces[j];
+    for (int i = 0; i < face.mNumIndices; ++i) {
+      indices.push_back(face.mIndices[i]);
+    }
+  }
 }
 
+template void AsyncInfoImporter::ConvertMesh(const aiMesh *mesh, std::vector<cg::Vertex> &vertices,
+                                             std::vector<unsigned int> &indices);
+template void AsyncInfoImporter::ConvertMesh(const aiMesh *mesh, ArenaVector<cg::Vertex> &vertices,
+                                             ArenaVector<unsigned int> &indices);
+
 bool AsyncInfoImporter::IsReady() {
   return ready_;
 }
 
 cg::MeshInfo AsyncInfoImporter::Get() {
-  MeshInfo i = future_.get();
-  ready_ = false;
-  return i;
+  JobSystem::Get().wait(job_);
+  MeshInfo info;
+  TryGet(info);
+  return info;
+}
+
+bool AsyncInfoImporter::TryGet(cg::MeshInfo &info) {
+  if (!ready_.exchange(false)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(result_mutex_);
+  info = std::move(result_);
+  return true;
+}
+
+OptimizationStats AsyncInfoImporter::GetOptimizationStats() {
+  std::lock_guard<std::mutex> lock(result_mutex_);
+  return stats_;
 }
 
 bool AsyncInfoImporter::IsBusy() {
-  return !ready_;
+  return status_->IsRunning();
 }
 
 }
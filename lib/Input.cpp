@@ -0,0 +1,125 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+
+#include "cg/Input.h"
+
+namespace cg {
+
+void Input::recordKey(int key, int action) {
+  RecordButton(this->pendingKeys, kKeyCount, key, action);
+}
+
+void Input::recordMouseButton(int button, int action) {
+  RecordButton(this->pendingButtons, kMouseButtonCount, button, action);
+}
+
+void Input::recordCursor(double x, double y) {
+  this->pendingCursor = glm::dvec2(x, y);
+  this->cursorKnown = true;
+}
+
+void Input::recordScroll(double x, double y) {
+  this->pendingScroll += glm::dvec2(x, y);
+}
+
+void Input::sample(bool keyboardCaptured, bool mouseCaptured) {
+  if (keyboardCaptured) {
+    memset(this->keys, 0, sizeof(this->keys));
+  } else {
+    memcpy(this->keys, this->pendingKeys, sizeof(this->keys));
+  }
+  for (uint8_t &key : this->pendingKeys) {
+    key &= Down;
+  }
+
+  if (mouseCaptured) {
+    memset(this->buttons, 0, sizeof(this->buttons));
+  } else {
+    memcpy(this->buttons, this->pendingButtons, sizeof(this->buttons));
+  }
+  for (uint8_t &button : this->pendingButtons) {
+    button &= Down;
+  }
+
+  // The first known position only establishes where the cursor is, it must not produce a jump
+  glm::dvec2 previous = this->sampledCursor ? this->cursor : this->pendingCursor;
+  this->cursor = this->pendingCursor;
+  this->sampledCursor = this->cursorKnown;
+  this->cursorDelta = mouseCaptured ? glm::dvec2(0.0) : this->cursor - previous;
+  this->scroll = mouseCaptured ? glm::dvec2(0.0) : this->pendingScroll;
+  this->pendingScroll = glm::dvec2(0.0);
+}
+
+bool Input::isKeyDown(int key) const {
+  return key >= 0 && key < kKeyCount && (this->keys[key] & Down) != 0;
+}
+
+bool Input::wasKeyPressed(int key) const {
+  return key >= 0 && key < kKeyCount && (this->keys[key] & Pressed) != 0;
+}
+
+bool Input::wasKeyReleased(int key) const {
+  return key >= 0 && key < kKeyCount && (this->keys[key] & Released) != 0;
+}
+
+bool Input::isMouseButtonDown(int button) const {
+  return button >= 0 && button < kMouseButtonCount && (this->buttons[button] & Down) != 0;
+}
+
+bool Input::wasMouseButtonPressed(int button) const {
+  return button >= 0 && button < kMouseButtonCount && (this->buttons[button] & Pressed) != 0;
+}
+
+bool Input::wasMouseButtonReleased(int button) const {
+  return button >= 0 && button < kMouseButtonCount && (this->buttons[button] & Released) != 0;
+}
+
+glm::vec2 Input::getMousePosition() const {
+  return glm::vec2(this->cursor);
+}
+
+glm::vec2 Input::getMouseDelta() const {
+  return glm::vec2(this->cursorDelta);
+}
+
+glm::vec2 Input::getScrollDelta() const {
+  return glm::vec2(this->scroll);
+}
+
+void Input::RecordButton(uint8_t *states, int count, int index, int action) {
+  if (index < 0 || index >= count) {
+    return;
+  }
+
+  // Repeats change nothing, the level is already down
+  if (action == GLFW_PRESS) {
+    states[index] |= Down | Pressed;
+  } else if (action == GLFW_RELEASE) {
+    states[index] = static_cast<uint8_t>((states[index] & ~Down) | Released);
+  }
+}
+
+}
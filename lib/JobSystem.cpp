@@ -0,0 +1,424 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include "cg/JobSystem.h"
+#include "cg/Profiler.h"
+
+namespace cg {
+
+/// Chase-Lev work-stealing deque of fixed capacity. Only the owner calls push and pop, any thread may steal.
+class JobSystem::Deque {
+ private:
+  static const int64_t kCapacity = 4096;
+
+  std::atomic<int64_t> top;
+  char padding[64];
+  std::atomic<int64_t> bottom;
+  std::atomic<Job *> jobs[kCapacity];
+
+ public:
+  Deque() : top(0), bottom(0) {
+    for (std::atomic<Job *> &job : jobs) {
+      job.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /// \return false if the deque is full
+  bool push(Job *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= kCapacity) {
+      return false;
+    }
+
+    jobs[b & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+  }
+
+  Job *pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    Job *job = jobs[b & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last job, race the thieves for it
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  Job *steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+
+    Job *job = jobs[t & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return job;
+  }
+};
+
+const int64_t JobSystem::Deque::kCapacity;
+const size_t Job::kInlineSize;
+
+/// Ring of jobs owned by one thread. Only the owner takes jobs, any thread may give one back by clearing busy. Jobs
+/// usually finish in about the order they were started, so the next job in the ring is almost always free.
+class JobSystem::Pool {
+ private:
+  static const size_t kCapacity = 1024;
+
+  Job jobs[kCapacity];
+  size_t next = 0;
+
+ public:
+  Pool() {
+    for (Job &job : jobs) {
+      job.pooled = true;
+    }
+  }
+
+  /// \return nullptr if the next job is still in use
+  Job *take() {
+    Job &job = jobs[next];
+    if (job.busy.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+
+    job.busy.store(true, std::memory_order_relaxed);
+    next = (next + 1) % kCapacity;
+    return &job;
+  }
+};
+
+const size_t JobSystem::Pool::kCapacity;
+
+namespace {
+
+/// The job system and deque the calling thread owns, if any
+struct ThreadSlot {
+  const JobSystem *system = nullptr;
+  int index = -1;
+};
+
+thread_local ThreadSlot threadSlot;
+
+/// Cheap per-thread random numbers to pick a victim to steal from
+uint32_t NextRandom() {
+  static thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()))
+      | 1u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+}
+
+JobSystem::JobSystem(unsigned int workers) : queued(0), sleeping(0), quit(false) {
+  // Workers record into the profiler, so it has to outlive them
+  Profiler::Get();
+
+  for (unsigned int i = 0; i <= workers; i++) {
+    this->deques.push_back(new Deque());
+    this->pools.push_back(new Pool());
+  }
+
+  threadSlot.system = this;
+  threadSlot.index = 0;
+
+  for (unsigned int i = 1; i <= workers; i++) {
+    this->workers.emplace_back(&JobSystem::work, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(this->sleepMutex);
+    this->quit.store(true);
+  }
+  this->wake.notify_all();
+  for (std::thread &worker : this->workers) {
+    worker.join();
+  }
+
+  // Whatever did not run by now never will
+  Job *job;
+  while ((job = pop())) {
+    job->destroy(job->storage);
+    release(job);
+  }
+  for (Deque *deque : this->deques) {
+    delete deque;
+  }
+  for (Pool *pool : this->pools) {
+    delete pool;
+  }
+
+  if (threadSlot.system == this) {
+    threadSlot = ThreadSlot();
+  }
+}
+
+JobSystem &JobSystem::Get() {
+  static JobSystem system(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  return system;
+}
+
+unsigned int JobSystem::getThreadCount() const {
+  return static_cast<unsigned int>(this->workers.size() + 1);
+}
+
+Job *JobSystem::allocate(JobCounter *counter) {
+  if (counter) {
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  int index = getThreadIndex();
+  Job *job = index >= 0 ? this->pools[index]->take() : nullptr;
+  return job ? job : new Job();
+}
+
+void JobSystem::release(Job *job) {
+  if (job->pooled) {
+    job->busy.store(false, std::memory_order_release);
+  } else {
+    delete job;
+  }
+}
+
+void JobSystem::pushAfter(JobCounter &dependency, Job *job) {
+  {
+    // finish() drains the continuations under the same lock, so a job is either queued here or started right away
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (!dependency.isDone()) {
+      dependency.continuations.push_back(job);
+      return;
+    }
+  }
+  push(job);
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  // A worker helps, the jobs it waits for may be queued behind it and every worker could end up waiting. Any other
+  // thread, the render thread above all, must not pick up an unrelated job such as a texture decode or an import, it
+  // only runs the counter's own jobs that are still in its deque
+  int index = getThreadIndex();
+  bool help = index > 0 || this->workers.empty();
+  int idle = 0;
+  while (!counter.isDone()) {
+    if (help ? runPending() : runOwn(index, counter)) {
+      idle = 0;
+      continue;
+    }
+
+    // Jobs that are about to finish are worth a short spin
+    if (++idle < 64) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(counter.mutex);
+    counter.waiters++;
+    if (help) {
+      // Look for new jobs to help with every now and then
+      counter.done.wait_for(lock, std::chrono::milliseconds(1), [&counter]() { return counter.isDone(); });
+    } else {
+      counter.done.wait(lock, [&counter]() { return counter.isDone(); });
+    }
+    counter.waiters--;
+  }
+}
+
+bool JobSystem::runPending() {
+  Job *job = pop();
+  if (!job) {
+    return false;
+  }
+
+  execute(job);
+  return true;
+}
+
+bool JobSystem::runOwn(int index, JobCounter &counter) {
+  if (index < 0) {
+    return false;
+  }
+
+  // The newest job is the one pushed last, put it back if it belongs to someone else
+  Deque *deque = this->deques[index];
+  Job *job = deque->pop();
+  if (!job) {
+    return false;
+  }
+  if (job->counter != &counter) {
+    deque->push(job);
+    return false;
+  }
+
+  this->queued.fetch_sub(1, std::memory_order_relaxed);
+  execute(job);
+  return true;
+}
+
+void JobSystem::push(Job *job) {
+  int index = getThreadIndex();
+  if (index < 0 || !this->deques[index]->push(job)) {
+    std::lock_guard<std::mutex> lock(this->sharedMutex);
+    if (this->sharedCount == this->shared.size()) {
+      // Grow the ring, unrolling it so the oldest job comes first again
+      std::vector<Job *> grown(std::max<size_t>(this->shared.size() * 2, 64));
+      for (size_t i = 0; i < this->sharedCount; i++) {
+        grown[i] = this->shared[(this->sharedHead + i) % this->shared.size()];
+      }
+      this->shared.swap(grown);
+      this->sharedHead = 0;
+    }
+    this->shared[(this->sharedHead + this->sharedCount) % this->shared.size()] = job;
+    this->sharedCount++;
+  }
+
+  this->queued.fetch_add(1, std::memory_order_seq_cst);
+  if (this->sleeping.load(std::memory_order_seq_cst) > 0) {
+    // Taking the lock makes sure a worker that is about to sleep either sees the job or gets the notification
+    std::lock_guard<std::mutex> lock(this->sleepMutex);
+    this->wake.notify_one();
+  }
+}
+
+Job *JobSystem::pop() {
+  Job *job = nullptr;
+  int index = getThreadIndex();
+  if (index >= 0) {
+    job = this->deques[index]->pop();
+  }
+
+  if (!job) {
+    std::lock_guard<std::mutex> lock(this->sharedMutex);
+    if (this->sharedCount > 0) {
+      job = this->shared[this->sharedHead];
+      this->sharedHead = (this->sharedHead + 1) % this->shared.size();
+      this->sharedCount--;
+    }
+  }
+
+  if (!job) {
+    size_t count = this->deques.size();
+    size_t start = NextRandom() % count;
+    for (size_t i = 0; i < count && !job; i++) {
+      size_t victim = (start + i) % count;
+      if (static_cast<int>(victim) != index) {
+        job = this->deques[victim]->steal();
+      }
+    }
+  }
+
+  if (job) {
+    this->queued.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+void JobSystem::execute(Job *job) {
+  job->invoke(job->storage);
+  job->destroy(job->storage);
+  JobCounter *counter = job->counter;
+  release(job);
+  finish(counter);
+}
+
+void JobSystem::finish(JobCounter *counter) {
+  if (!counter) {
+    return;
+  }
+
+  // Decrement under the lock, so the counter cannot be destroyed (see ~JobCounter) while this still touches it
+  std::vector<Job *> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->mutex);
+    if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      continuations.swap(counter->continuations);
+      if (counter->waiters > 0) {
+        counter->done.notify_all();
+      }
+    }
+  }
+  for (Job *job : continuations) {
+    push(job);
+  }
+}
+
+int JobSystem::getThreadIndex() const {
+  return threadSlot.system == this ? threadSlot.index : -1;
+}
+
+void JobSystem::work(unsigned int index) {
+  threadSlot.system = this;
+  threadSlot.index = static_cast<int>(index);
+  Profiler::Get().setThreadName("Worker " + std::to_string(index));
+
+  int idle = 0;
+  while (!this->quit.load(std::memory_order_relaxed)) {
+    if (runPending()) {
+      idle = 0;
+      continue;
+    }
+
+    // Spin a little before going to sleep, new jobs usually follow shortly during a frame
+    if (++idle < 256) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(this->sleepMutex);
+    this->sleeping.fetch_add(1, std::memory_order_seq_cst);
+    this->wake.wait(lock, [this]() {
+      return this->queued.load(std::memory_order_seq_cst) > 0 || this->quit.load();
+    });
+    this->sleeping.fetch_sub(1, std::memory_order_seq_cst);
+    idle = 0;
+  }
+}
+
+}
@@ -0,0 +1,244 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "cg/LoaderThread.h"
+#include "cg/Mesh.h"
+#include "cg/Profiler.h"
+#include "cg/common/ProgramCache.h"
+
+namespace cg {
+
+LoaderThread::~LoaderThread() {
+  stop();
+}
+
+bool LoaderThread::start(GLFWwindow *share) {
+  stop();
+  bool created = this->context.createShared(share);
+  glfwMakeContextCurrent(share);
+  if (!created) {
+    return false;
+  }
+
+  this->stopping = false;
+  this->running = true;
+  this->thread = std::thread(&LoaderThread::loop, this);
+  return true;
+}
+
+bool LoaderThread::start(int glMajor, int glMinor, HeadlessContext &share) {
+  stop();
+  bool created = this->context.create(glMajor, glMinor, &share);
+  share.makeCurrent();
+  if (!created) {
+    return false;
+  }
+
+  this->stopping = false;
+  this->running = true;
+  this->thread = std::thread(&LoaderThread::loop, this);
+  return true;
+}
+
+void LoaderThread::stop() {
+  if (this->running) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+    }
+    this->wake.notify_one();
+    this->thread.join();
+    this->running = false;
+  }
+
+  this->tasks.clear();
+  for (Completion &completion : this->finished) {
+    this->completions.push_back(std::move(completion));
+  }
+  this->finished.clear();
+  for (Completion &completion : this->completions) {
+    glDeleteSync(completion.fence);
+  }
+  this->completions.clear();
+  this->pending = 0;
+
+  // Work that never published leaves its meshes undrawable
+  for (const std::shared_ptr<MeshLoad> &load : this->meshLoads) {
+    if (load->mesh) {
+      load->mesh->loader = nullptr;
+    }
+    glDeleteBuffers(1, &load->vertexBuffer);
+    glDeleteBuffers(1, &load->indexBuffer);
+  }
+  this->meshLoads.clear();
+  this->context.destroy();
+}
+
+bool LoaderThread::isRunning() const {
+  return this->running;
+}
+
+void LoaderThread::run(std::function<void()> work, std::function<void()> publish) {
+  if (!this->running) {
+    work();
+    if (publish) {
+      publish();
+    }
+    return;
+  }
+
+  this->pending++;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tasks.push_back({std::move(work), std::move(publish)});
+  }
+  this->wake.notify_one();
+}
+
+Mesh *LoaderThread::uploadMesh(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices,
+                               MeshRetention retention) {
+  Mesh *mesh = new Mesh(vertices.size(), indices.size(), retention);
+  mesh->loader = this;
+
+  std::shared_ptr<MeshLoad> load = std::make_shared<MeshLoad>();
+  load->mesh = mesh;
+  load->vertices = std::move(vertices);
+  load->indices = std::move(indices);
+  this->meshLoads.push_back(load);
+
+  run([load]() {
+    Mesh::CreateBuffers(load->vertices.size() * sizeof(cg::Vertex), load->vertices.data(),
+                        load->indices.size() * sizeof(unsigned int), load->indices.data(), load->vertexBuffer,
+                        load->indexBuffer);
+  }, [this, load]() {
+    publishMesh(load);
+  });
+  return mesh;
+}
+
+void LoaderThread::loadProgram(const std::vector<ShaderStageSource> &stages,
+                               std::function<void(std::unique_ptr<ShaderProgram>)> done,
+                               ProgramBinaryCache *cache,
+                               const std::string &defines) {
+  // Shared, so the program is deleted with the publish function if it never runs
+  std::shared_ptr<std::unique_ptr<ShaderProgram>> program = std::make_shared<std::unique_ptr<ShaderProgram>>();
+  run([stages, program, cache, defines]() {
+    program->reset(cache ? cache->createProgram(stages, defines) : ShaderProgram::FromSources(stages));
+  }, [program, done]() {
+    done(std::move(*program));
+  });
+}
+
+void LoaderThread::cancel(const Mesh *mesh) {
+  for (const std::shared_ptr<MeshLoad> &load : this->meshLoads) {
+    if (load->mesh == mesh) {
+      load->mesh = nullptr;
+    }
+  }
+}
+
+void LoaderThread::update() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (Completion &completion : this->finished) {
+      this->completions.push_back(std::move(completion));
+    }
+    this->finished.clear();
+  }
+
+  // The loader thread's commands complete in order, so do its fences
+  while (!this->completions.empty()) {
+    Completion &completion = this->completions.front();
+    if (glClientWaitSync(completion.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+    glDeleteSync(completion.fence);
+    std::function<void()> publish = std::move(completion.publish);
+    this->completions.pop_front();
+    this->pending--;
+    if (publish) {
+      publish();
+    }
+  }
+}
+
+size_t LoaderThread::getPendingCount() const {
+  return this->pending;
+}
+
+void LoaderThread::loop() {
+  this->context.makeCurrent();
+  Profiler::Get().setThreadName("Loader");
+
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->wake.wait(lock, [this]() {
+        return this->stopping || !this->tasks.empty();
+      });
+      if (this->stopping) {
+        break;
+      }
+      task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+
+    {
+      CG_PROFILE_SCOPE("Load");
+      task.work();
+    }
+
+    // Flushed, or the render thread could wait for a fence that was never submitted
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->finished.push_back({fence, std::move(task.publish)});
+  }
+
+  this->context.release();
+}
+
+void LoaderThread::publishMesh(const std::shared_ptr<MeshLoad> &load) {
+  this->meshLoads.erase(std::find(this->meshLoads.begin(), this->meshLoads.end(), load));
+
+  Mesh *mesh = load->mesh;
+  if (!mesh) {
+    glDeleteBuffers(1, &load->vertexBuffer);
+    glDeleteBuffers(1, &load->indexBuffer);
+    return;
+  }
+
+  mesh->loader = nullptr;
+  mesh->setBuffers(load->vertexBuffer, load->indexBuffer, load->indices.size(),
+                   load->vertices.size() * sizeof(cg::Vertex) + load->indices.size() * sizeof(unsigned int));
+  mesh->retain(std::move(load->vertices), std::move(load->indices));
+  mesh->drawable = true;
+}
+
+}
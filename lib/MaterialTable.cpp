@@ -0,0 +1,264 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "cg/MaterialTable.h"
+
+namespace cg {
+
+namespace {
+
+const uint32_t kHasBaseColorTexture = 1u;
+
+/// Frames a replaced bindless view is kept for, so draws that are still in flight can finish with it
+const uint64_t kRetireFrames = 3;
+
+}
+
+const unsigned int MaterialTable::kBinding;
+const unsigned int MaterialTable::kTextureSlots;
+const uint32_t MaterialTable::kNoTexture;
+
+static_assert(sizeof(glm::vec3) == 12, "GpuMaterial expects a tightly packed glm::vec3");
+
+MaterialTable::MaterialTable() : bindless(GLAD_GL_ARB_bindless_texture != 0) {
+  static_assert(sizeof(GpuMaterial) == 64, "GpuMaterial has to match the std430 layout of the shader struct");
+  glCreateBuffers(1, &this->buffer);
+  this->capacity = 16 * sizeof(GpuMaterial);
+  glNamedBufferData(this->buffer, this->capacity, nullptr, GL_DYNAMIC_DRAW);
+  this->memory.resize(0, this->capacity);
+}
+
+MaterialTable::~MaterialTable() {
+  for (const TextureBinding &binding : this->textures) {
+    if (binding.view) {
+      glMakeTextureHandleNonResidentARB(binding.handle);
+      glDeleteTextures(1, &binding.view);
+    }
+  }
+  for (const RetiredView &view : this->retired) {
+    glMakeTextureHandleNonResidentARB(view.handle);
+    glDeleteTextures(1, &view.view);
+  }
+  glDeleteBuffers(1, &this->buffer);
+}
+
+uint32_t MaterialTable::add(const Material &material) {
+  this->materials.push_back(material);
+  findTexture(material.baseColorTexture);
+  this->dirty = true;
+  return static_cast<uint32_t>(this->materials.size() - 1);
+}
+
+void MaterialTable::set(uint32_t index, const Material &material) {
+  if (index >= this->materials.size()) {
+    fprintf(stderr, "Error: material %u does not exist\n", index);
+    return;
+  }
+
+  this->materials[index] = material;
+  findTexture(material.baseColorTexture);
+  this->dirty = true;
+}
+
+const Material &MaterialTable::get(uint32_t index) const {
+  return this->materials[index];
+}
+
+size_t MaterialTable::size() const {
+  return this->materials.size();
+}
+
+bool MaterialTable::isBindless() const {
+  return this->bindless;
+}
+
+std::string MaterialTable::getGlslDeclarations() const {
+  std::string source;
+  if (this->bindless) {
+    source += "#extension GL_ARB_bindless_texture : require\n";
+  }
+
+  source += "struct Material {\n"
+            "  vec4 baseColor;\n"
+            "  vec3 emissive;\n"
+            "  float metallic;\n"
+            "  float roughness;\n"
+            "  uint flags;\n"
+            "  uint baseColorSlot;\n"
+            "  uint padding;\n"
+            "  uvec2 baseColorHandle;\n"
+            "  uvec2 padding2;\n"
+            "};\n"
+            "layout(std430, binding = " + std::to_string(kBinding) + ") readonly buffer Materials {\n"
+            "  Material materials[];\n"
+            "};\n"
+            "uniform uint E_MATERIAL;\n";
+
+  if (this->bindless) {
+    source += "vec4 SampleBaseColor(Material material, vec2 uv) {\n"
+              "  if ((material.flags & 1u) == 0u) return vec4(1.0);\n"
+              "  return texture(sampler2D(material.baseColorHandle), uv);\n"
+              "}\n";
+  } else {
+    source += "layout(binding = 0) uniform sampler2D materialTextures[" + std::to_string(kTextureSlots) + "];\n"
+              "vec4 SampleBaseColor(Material material, vec2 uv) {\n"
+              "  if ((material.flags & 1u) == 0u) return vec4(1.0);\n"
+              "  return texture(materialTextures[material.baseColorSlot], uv);\n"
+              "}\n";
+  }
+  return source;
+}
+
+void MaterialTable::update() {
+  this->frame++;
+  for (TextureBinding &binding : this->textures) {
+    refreshTexture(binding);
+  }
+
+  auto expired = std::partition(this->retired.begin(), this->retired.end(), [this](const RetiredView &view) {
+    return this->frame - view.frame < kRetireFrames;
+  });
+  for (auto it = expired; it != this->retired.end(); ++it) {
+    glMakeTextureHandleNonResidentARB(it->handle);
+    glDeleteTextures(1, &it->view);
+  }
+  this->retired.erase(expired, this->retired.end());
+
+  if (!this->bindless) {
+    this->slotNames.resize(this->textures.size());
+    for (size_t i = 0; i < this->textures.size(); ++i) {
+      this->slotNames[i] = this->textures[i].name;
+    }
+  }
+
+  if (this->dirty) {
+    upload();
+  }
+}
+
+void MaterialTable::bind() {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBinding, this->buffer);
+  if (!this->bindless && !this->slotNames.empty()) {
+    glBindTextures(0, static_cast<GLsizei>(this->slotNames.size()), this->slotNames.data());
+  }
+}
+
+uint32_t MaterialTable::findTexture(StreamedTexture *texture) {
+  if (!texture) {
+    return kNoTexture;
+  }
+
+  for (size_t i = 0; i < this->textures.size(); ++i) {
+    if (this->textures[i].texture == texture) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+
+  if (!this->bindless && this->textures.size() >= kTextureSlots) {
+    fprintf(stderr, "Error: more than %u textures in a material table without bindless textures, '%s' is not used\n",
+            kTextureSlots, texture->getPath().c_str());
+    return kNoTexture;
+  }
+
+  this->textures.push_back({texture, 0, -1, 0, 0});
+  refreshTexture(this->textures.back());
+  return static_cast<uint32_t>(this->textures.size() - 1);
+}
+
+void MaterialTable::refreshTexture(TextureBinding &binding) {
+  Texture2D *texture = binding.texture->getTexture();
+  unsigned int name = texture ? texture->getHandle() : 0;
+  int residentLevel = binding.texture->getResidentLevel();
+  if (name == binding.name && residentLevel == binding.residentLevel) {
+    return;
+  }
+
+  binding.name = name;
+  binding.residentLevel = residentLevel;
+  this->dirty = true;
+  if (!this->bindless) {
+    return;
+  }
+
+  if (binding.view) {
+    this->retired.push_back({binding.view, binding.handle, this->frame});
+    binding.view = 0;
+    binding.handle = 0;
+  }
+  if (!texture) {
+    return;
+  }
+
+  // A handle freezes the state of its texture, so it is taken from a view of the resident levels instead, which
+  // leaves the streamer free to change the levels of the texture itself
+  int base = texture->getLevelCount() - (binding.texture->getLevelCount() - residentLevel);
+  glGenTextures(1, &binding.view);
+  glTextureView(binding.view, GL_TEXTURE_2D, name, texture->getInternalFormat(), base, texture->getLevelCount() - base,
+                0, 1);
+  glTextureParameteri(binding.view, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTextureParameteri(binding.view, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  binding.handle = glGetTextureHandleARB(binding.view);
+  glMakeTextureHandleResidentARB(binding.handle);
+}
+
+void MaterialTable::upload() {
+  this->records.resize(this->materials.size());
+  for (size_t i = 0; i < this->materials.size(); ++i) {
+    const Material &material = this->materials[i];
+    GpuMaterial &record = this->records[i];
+    record.baseColor = material.baseColor;
+    record.emissive = material.emissive;
+    record.metallic = material.metallic;
+    record.roughness = material.roughness;
+    record.flags = 0;
+    record.baseColorSlot = kNoTexture;
+    record.padding = 0;
+    record.baseColorHandle = 0;
+    record.padding2 = 0;
+
+    // A texture without resident levels is left out until it has some
+    uint32_t slot = findTexture(material.baseColorTexture);
+    if (slot != kNoTexture && this->textures[slot].name != 0) {
+      record.flags |= kHasBaseColorTexture;
+      record.baseColorSlot = slot;
+      record.baseColorHandle = this->textures[slot].handle;
+    }
+  }
+
+  size_t bytes = this->records.size() * sizeof(GpuMaterial);
+  if (bytes > this->capacity) {
+    this->capacity = std::max(bytes, this->capacity * 2);
+    glNamedBufferData(this->buffer, this->capacity, nullptr, GL_DYNAMIC_DRAW);
+    this->memory.resize(0, this->capacity);
+  }
+  if (bytes > 0) {
+    glNamedBufferSubData(this->buffer, 0, bytes, this->records.data());
+  }
+  this->dirty = false;
+}
+
+}
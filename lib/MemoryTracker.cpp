@@ -0,0 +1,357 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <imgui.h>
+
+#include "cg/MemoryTracker.h"
+
+namespace cg {
+
+namespace {
+
+/// Formats a byte count with a binary unit, e.g. "12.50 MB".
+const char *FormatBytes(size_t bytes, char *buffer, size_t size) {
+  static const char *kUnits[] = {"B", "KB", "MB", "GB", "TB"};
+  double value = static_cast<double>(bytes);
+  int unit = 0;
+  while (value >= 1024.0 && unit < 4) {
+    value /= 1024.0;
+    unit++;
+  }
+  snprintf(buffer, size, unit == 0 ? "%.0f %s" : "%.2f %s", value, kUnits[unit]);
+  return buffer;
+}
+
+void ShowBudget(const char *label, size_t used, size_t budget) {
+  char usedText[32];
+  char budgetText[32];
+  char overlay[80];
+  FormatBytes(used, usedText, sizeof(usedText));
+  if (budget == 0) {
+    ImGui::Text("%s: %s", label, usedText);
+    return;
+  }
+
+  snprintf(overlay, sizeof(overlay), "%s / %s", usedText, FormatBytes(budget, budgetText, sizeof(budgetText)));
+  ImGui::ProgressBar(std::min(static_cast<float>(used) / static_cast<float>(budget), 1.0f), ImVec2(-1.0f, 0.0f),
+                     overlay);
+  ImGui::SameLine();
+  ImGui::Text("%s%s", label, used > budget ? " (over budget)" : "");
+}
+
+}
+
+const uint32_t MemoryTracker::kInvalid;
+
+const char *GetMemoryCategoryName(MemoryCategory category) {
+  switch (category) {
+    case MemoryCategory::MeshData:return "Mesh Data";
+    case MemoryCategory::Buffer:return "Buffers";
+    case MemoryCategory::VertexArray:return "Vertex Arrays";
+    case MemoryCategory::Program:return "Programs";
+    case MemoryCategory::Texture:return "Textures";
+    case MemoryCategory::Framebuffer:return "Framebuffers";
+    case MemoryCategory::Other:return "Other";
+  }
+  return "Unknown";
+}
+
+MemoryTracker &MemoryTracker::Get() {
+  // Never destroyed, resources with static storage duration may unregister after every other static is gone
+  static MemoryTracker *tracker = new MemoryTracker();
+  return *tracker;
+}
+
+uint32_t MemoryTracker::add(MemoryCategory category, const std::string &asset, size_t cpuBytes, size_t gpuBytes) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  uint32_t id;
+  if (!this->freeRecords.empty()) {
+    id = this->freeRecords.back();
+    this->freeRecords.pop_back();
+  } else {
+    id = static_cast<uint32_t>(this->records.size());
+    this->records.emplace_back();
+  }
+
+  Record &record = this->records[id];
+  record.category = category;
+  record.asset = asset;
+  record.cpuBytes = cpuBytes;
+  record.gpuBytes = gpuBytes;
+  record.live = true;
+  account(category, static_cast<int64_t>(cpuBytes), static_cast<int64_t>(gpuBytes), 1);
+  return id;
+}
+
+void MemoryTracker::resize(uint32_t id, size_t cpuBytes, size_t gpuBytes) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (id >= this->records.size() || !this->records[id].live) {
+    return;
+  }
+
+  Record &record = this->records[id];
+  account(record.category, static_cast<int64_t>(cpuBytes) - static_cast<int64_t>(record.cpuBytes),
+          static_cast<int64_t>(gpuBytes) - static_cast<int64_t>(record.gpuBytes), 0);
+  record.cpuBytes = cpuBytes;
+  record.gpuBytes = gpuBytes;
+}
+
+void MemoryTracker::rename(uint32_t id, const std::string &asset) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (id < this->records.size() && this->records[id].live) {
+    this->records[id].asset = asset;
+  }
+}
+
+void MemoryTracker::remove(uint32_t id) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (id >= this->records.size() || !this->records[id].live) {
+    return;
+  }
+
+  Record &record = this->records[id];
+  account(record.category, -static_cast<int64_t>(record.cpuBytes), -static_cast<int64_t>(record.gpuBytes), -1);
+  record.live = false;
+  record.asset.clear();
+  this->freeRecords.push_back(id);
+}
+
+MemoryUsage MemoryTracker::getTotal() const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->total;
+}
+
+MemoryUsage MemoryTracker::getTotal(MemoryCategory category) const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->totals[static_cast<size_t>(category)];
+}
+
+MemoryUsage MemoryTracker::getHighWater() const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->totalHighWater;
+}
+
+MemoryUsage MemoryTracker::getHighWater(MemoryCategory category) const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->highWater[static_cast<size_t>(category)];
+}
+
+void MemoryTracker::resetHighWater() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (size_t i = 0; i < kMemoryCategoryCount; i++) {
+    this->highWater[i] = this->totals[i];
+  }
+  this->totalHighWater = this->total;
+}
+
+std::vector<AssetMemory> MemoryTracker::getAssets() const {
+  std::vector<AssetMemory> assets;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const Record &record : this->records) {
+      if (!record.live) {
+        continue;
+      }
+
+      auto asset = std::find_if(assets.begin(), assets.end(), [&record](const AssetMemory &existing) {
+        return existing.name == record.asset;
+      });
+      if (asset == assets.end()) {
+        assets.emplace_back();
+        asset = assets.end() - 1;
+        asset->name = record.asset;
+      }
+
+      MemoryUsage &usage = asset->categories[static_cast<size_t>(record.category)];
+      usage.cpuBytes += record.cpuBytes;
+      usage.gpuBytes += record.gpuBytes;
+      usage.resources++;
+      asset->total.cpuBytes += record.cpuBytes;
+      asset->total.gpuBytes += record.gpuBytes;
+      asset->total.resources++;
+    }
+  }
+
+  std::sort(assets.begin(), assets.end(), [](const AssetMemory &a, const AssetMemory &b) {
+    return a.total.cpuBytes + a.total.gpuBytes > b.total.cpuBytes + b.total.gpuBytes;
+  });
+  return assets;
+}
+
+void MemoryTracker::setBudget(size_t cpuBytes, size_t gpuBytes) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->cpuBudget = cpuBytes;
+  this->gpuBudget = gpuBytes;
+}
+
+bool MemoryTracker::isOverBudget() const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return (this->cpuBudget > 0 && this->total.cpuBytes > this->cpuBudget)
+      || (this->gpuBudget > 0 && this->total.gpuBytes > this->gpuBudget);
+}
+
+void MemoryTracker::showWindow(bool *open) {
+  if (!ImGui::Begin("Memory", open)) {
+    ImGui::End();
+    return;
+  }
+
+  MemoryUsage totals[kMemoryCategoryCount];
+  MemoryUsage peaks[kMemoryCategoryCount];
+  MemoryUsage total;
+  MemoryUsage peak;
+  size_t cpuBudget;
+  size_t gpuBudget;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::copy(this->totals, this->totals + kMemoryCategoryCount, totals);
+    std::copy(this->highWater, this->highWater + kMemoryCategoryCount, peaks);
+    total = this->total;
+    peak = this->totalHighWater;
+    cpuBudget = this->cpuBudget;
+    gpuBudget = this->gpuBudget;
+  }
+
+  char cpu[32];
+  char gpu[32];
+  char cpuPeak[32];
+  char gpuPeak[32];
+  ShowBudget("CPU", total.cpuBytes, cpuBudget);
+  ShowBudget("GPU", total.gpuBytes, gpuBudget);
+  ImGui::Text("Peak: %s CPU, %s GPU", FormatBytes(peak.cpuBytes, cpuPeak, sizeof(cpuPeak)),
+              FormatBytes(peak.gpuBytes, gpuPeak, sizeof(gpuPeak)));
+  ImGui::SameLine();
+  if (ImGui::Button("Reset Peak")) {
+    resetHighWater();
+  }
+
+  if (ImGui::CollapsingHeader("Categories", ImGuiTreeNodeFlags_DefaultOpen)) {
+    ImGui::Columns(5, "categories");
+    ImGui::Text("Category");
+    ImGui::NextColumn();
+    ImGui::Text("Count");
+    ImGui::NextColumn();
+    ImGui::Text("CPU");
+    ImGui::NextColumn();
+    ImGui::Text("GPU");
+    ImGui::NextColumn();
+    ImGui::Text("Peak CPU / GPU");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (size_t i = 0; i < kMemoryCategoryCount; i++) {
+      ImGui::Text("%s", GetMemoryCategoryName(static_cast<MemoryCategory>(i)));
+      ImGui::NextColumn();
+      ImGui::Text("%zu", totals[i].resources);
+      ImGui::NextColumn();
+      ImGui::Text("%s", FormatBytes(totals[i].cpuBytes, cpu, sizeof(cpu)));
+      ImGui::NextColumn();
+      ImGui::Text("%s", FormatBytes(totals[i].gpuBytes, gpu, sizeof(gpu)));
+      ImGui::NextColumn();
+      ImGui::Text("%s / %s", FormatBytes(peaks[i].cpuBytes, cpuPeak, sizeof(cpuPeak)),
+                  FormatBytes(peaks[i].gpuBytes, gpuPeak, sizeof(gpuPeak)));
+      ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+  }
+
+  if (ImGui::CollapsingHeader("Assets", ImGuiTreeNodeFlags_DefaultOpen)) {
+    for (const AssetMemory &asset : getAssets()) {
+      char label[300];
+      snprintf(label, sizeof(label), "%s: %s CPU, %s GPU###%s", asset.name.empty() ? "(unnamed)" : asset.name.c_str(),
+               FormatBytes(asset.total.cpuBytes, cpu, sizeof(cpu)), FormatBytes(asset.total.gpuBytes, gpu, sizeof(gpu)),
+               asset.name.c_str());
+      if (!ImGui::TreeNode(label)) {
+        continue;
+      }
+
+      for (size_t i = 0; i < kMemoryCategoryCount; i++) {
+        const MemoryUsage &usage = asset.categories[i];
+        if (usage.resources == 0) {
+          continue;
+        }
+        ImGui::Text("%s (%zu): %s CPU, %s GPU", GetMemoryCategoryName(static_cast<MemoryCategory>(i)),
+                    usage.resources, FormatBytes(usage.cpuBytes, cpu, sizeof(cpu)),
+                    FormatBytes(usage.gpuBytes, gpu, sizeof(gpu)));
+      }
+      ImGui::TreePop();
+    }
+  }
+
+  ImGui::End();
+}
+
+void MemoryTracker::account(MemoryCategory category, int64_t cpuBytes, int64_t gpuBytes, int64_t resources) {
+  auto apply = [cpuBytes, gpuBytes, resources](MemoryUsage &usage, MemoryUsage &peak) {
+    usage.cpuBytes = static_cast<size_t>(static_cast<int64_t>(usage.cpuBytes) + cpuBytes);
+    usage.gpuBytes = static_cast<size_t>(static_cast<int64_t>(usage.gpuBytes) + gpuBytes);
+    usage.resources = static_cast<size_t>(static_cast<int64_t>(usage.resources) + resources);
+    peak.cpuBytes = std::max(peak.cpuBytes, usage.cpuBytes);
+    peak.gpuBytes = std::max(peak.gpuBytes, usage.gpuBytes);
+    peak.resources = std::max(peak.resources, usage.resources);
+  };
+
+  size_t index = static_cast<size_t>(category);
+  apply(this->totals[index], this->highWater[index]);
+  apply(this->total, this->totalHighWater);
+}
+
+TrackedMemory::TrackedMemory(MemoryCategory category, const std::string &asset, size_t cpuBytes, size_t gpuBytes)
+    : id(MemoryTracker::Get().add(category, asset, cpuBytes, gpuBytes)) {}
+
+TrackedMemory::~TrackedMemory() {
+  if (this->id != MemoryTracker::kInvalid) {
+    MemoryTracker::Get().remove(this->id);
+  }
+}
+
+TrackedMemory::TrackedMemory(TrackedMemory &&otherMove) noexcept : id(otherMove.id) {
+  otherMove.id = MemoryTracker::kInvalid;
+}
+
+TrackedMemory &TrackedMemory::operator=(TrackedMemory &&otherMove) noexcept {
+  if (this != &otherMove) {
+    if (this->id != MemoryTracker::kInvalid) {
+      MemoryTracker::Get().remove(this->id);
+    }
+    this->id = otherMove.id;
+    otherMove.id = MemoryTracker::kInvalid;
+  }
+  return *this;
+}
+
+void TrackedMemory::resize(size_t cpuBytes, size_t gpuBytes) {
+  if (this->id != MemoryTracker::kInvalid) {
+    MemoryTracker::Get().resize(this->id, cpuBytes, gpuBytes);
+  }
+}
+
+void TrackedMemory::rename(const std::string &asset) {
+  if (this->id != MemoryTracker::kInvalid) {
+    MemoryTracker::Get().rename(this->id, asset);
+  }
+}
+
+}
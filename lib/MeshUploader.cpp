@@ -0,0 +1,207 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "cg/Mesh.h"
+#include "cg/MeshUploader.h"
+
+namespace cg {
+
+const int MeshUploader::kRegions;
+
+MeshUploader::MeshUploader(const MeshUploadSettings &settings) : settings(settings) {
+  // Copies are issued per region, keep them aligned to the largest element
+  this->regionSize = std::max<size_t>(settings.bytesPerFrame / 16 * 16, 16);
+
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glCreateBuffers(1, &this->staging);
+  glNamedBufferStorage(this->staging, this->regionSize * kRegions, nullptr, flags);
+  this->mapped = static_cast<uint8_t *>(glMapNamedBufferRange(this->staging, 0, this->regionSize * kRegions, flags));
+  if (!this->mapped) {
+    fprintf(stderr, "Error: could not map the mesh staging buffer, uploading with glNamedBufferSubData instead\n");
+    glDeleteBuffers(1, &this->staging);
+    this->staging = 0;
+    return;
+  }
+  this->stagingMemory.resize(0, this->regionSize * kRegions);
+}
+
+MeshUploader::~MeshUploader() {
+  for (Upload &upload : this->uploads) {
+    upload.mesh->uploader = nullptr;
+  }
+  for (Completion &completion : this->completions) {
+    completion.mesh->uploader = nullptr;
+    glDeleteSync(completion.fence);
+  }
+  for (GLsync fence : this->regionFences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  if (this->mapped) {
+    glUnmapNamedBuffer(this->staging);
+  }
+  glDeleteBuffers(1, &this->staging);
+}
+
+Mesh *MeshUploader::upload(std::vector<cg::Vertex> &&vertices, std::vector<unsigned int> &&indices,
+                           MeshRetention retention) {
+  Mesh *mesh = new Mesh(vertices.size(), indices.size(), retention);
+  mesh->allocate(vertices.size() * sizeof(cg::Vertex), nullptr, indices.size(), nullptr);
+  mesh->uploader = this;
+
+  this->uploads.emplace_back();
+  Upload &upload = this->uploads.back();
+  upload.mesh = mesh;
+  upload.vertices = std::move(vertices);
+  upload.indices = std::move(indices);
+  return mesh;
+}
+
+void MeshUploader::cancel(const Mesh *mesh) {
+  auto upload = std::find_if(this->uploads.begin(), this->uploads.end(), [mesh](const Upload &upload) {
+    return upload.mesh == mesh;
+  });
+  if (upload != this->uploads.end()) {
+    this->uploads.erase(upload);
+  }
+
+  auto completion = std::find_if(this->completions.begin(), this->completions.end(),
+                                 [mesh](const Completion &completion) {
+                                   return completion.mesh == mesh;
+                                 });
+  if (completion != this->completions.end()) {
+    glDeleteSync(completion->fence);
+    this->completions.erase(completion);
+  }
+}
+
+void MeshUploader::update() {
+  this->stats.uploadedBytes = 0;
+  this->stats.completed = 0;
+
+  for (size_t i = 0; i < this->completions.size();) {
+    Completion &completion = this->completions[i];
+    if (glClientWaitSync(completion.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      ++i;
+      continue;
+    }
+    glDeleteSync(completion.fence);
+    completion.mesh->uploader = nullptr;
+    completion.mesh->drawable = true;
+    this->stats.completed++;
+    completion = this->completions.back();
+    this->completions.pop_back();
+  }
+
+  if (!this->uploads.empty()) {
+    GLsync &fence = this->regionFences[this->region];
+    bool available = true;
+    if (fence) {
+      // The GPU still reads from this region, rather skip a frame of uploads than wait for it
+      if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        available = false;
+        this->stats.stalls++;
+      } else {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+
+    if (available) {
+      size_t offset = this->region * this->regionSize;
+      size_t end = offset + this->regionSize;
+      while (!this->uploads.empty() && offset < end) {
+        Upload &upload = this->uploads.front();
+        size_t vertexBytes = upload.vertices.size() * sizeof(cg::Vertex);
+        size_t indexBytes = upload.indices.size() * sizeof(unsigned int);
+        this->stats.uploadedBytes +=
+            copy(upload.mesh->vertexBuffer, upload.vertices.data(), vertexBytes, upload.vertexOffset, offset);
+        if (upload.vertexOffset == vertexBytes) {
+          this->stats.uploadedBytes +=
+              copy(upload.mesh->indexBuffer, upload.indices.data(), indexBytes, upload.indexOffset, offset);
+        }
+        if (upload.indexOffset < indexBytes) {
+          break;
+        }
+
+        // Everything is in the staging buffer, the data can go to the mesh already
+        Mesh *mesh = upload.mesh;
+        mesh->retain(std::move(upload.vertices), std::move(upload.indices));
+        this->uploads.pop_front();
+        this->completions.push_back({mesh, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+      }
+
+      // Without the staging buffer nothing reads from the region afterwards
+      if (this->mapped) {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      }
+      this->region = (this->region + 1) % kRegions;
+    }
+  }
+
+  this->stats.pending = this->uploads.size();
+  this->stats.pendingBytes = 0;
+  for (const Upload &upload : this->uploads) {
+    this->stats.pendingBytes += upload.vertices.size() * sizeof(cg::Vertex) - upload.vertexOffset
+        + upload.indices.size() * sizeof(unsigned int) - upload.indexOffset;
+  }
+  this->stats.completing = this->completions.size();
+}
+
+const MeshUploadSettings &MeshUploader::getSettings() const {
+  return this->settings;
+}
+
+const MeshUploadStats &MeshUploader::getStats() const {
+  return this->stats;
+}
+
+size_t MeshUploader::copy(unsigned int buffer, const void *source, size_t sourceSize, size_t &sourceOffset,
+                          size_t &offset) {
+  size_t end = (this->region + 1) * this->regionSize;
+  size_t size = std::min(sourceSize - sourceOffset, end - offset);
+  if (size == 0) {
+    return 0;
+  }
+
+  const uint8_t *data = static_cast<const uint8_t *>(source) + sourceOffset;
+  if (this->mapped) {
+    std::memcpy(this->mapped + offset, data, size);
+    glCopyNamedBufferSubData(this->staging, buffer, offset, sourceOffset, size);
+  } else {
+    glNamedBufferSubData(buffer, sourceOffset, size, data);
+  }
+  sourceOffset += size;
+
+  // The next copy starts aligned, vertices and indices are multiples of 4 bytes
+  offset = std::min((offset + size + 15) / 16 * 16, end);
+  return size;
+}
+
+}
@@ -0,0 +1,605 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <imgui.h>
+
+#include "cg/Profiler.h"
+
+namespace cg {
+
+const uint32_t Profiler::kGpuThread;
+
+/// Single producer ring buffer of finished scopes. Only the owning thread writes events and advances head, only the
+/// profiler (at the frame boundary) reads them and advances tail.
+struct Profiler::ThreadBuffer {
+  static const size_t kCapacity = 16384;
+  static const uint32_t kMaxDepth = 64;
+
+  ProfileEvent events[kCapacity];
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+
+  // Open scopes, only touched by the owning thread
+  uint64_t starts[kMaxDepth];
+  const char *names[kMaxDepth];
+  uint32_t depth = 0;
+
+  uint32_t index = 0;
+  std::string name;
+  std::atomic<uint64_t> dropped{0};
+};
+
+/// Timestamp queries issued during one frame, reused once all results were read back.
+struct Profiler::GpuFrame {
+  static const size_t kMaxQueries = 256;
+
+  struct Scope {
+    const char *name;
+    uint32_t depth;
+    size_t beginQuery;
+    size_t endQuery;
+  };
+
+  unsigned int queries[kMaxQueries];
+  size_t used = 0;
+  std::vector<Scope> scopes;
+  std::vector<size_t> open;
+  uint64_t frameIndex = 0;
+  bool pending = false;
+};
+
+// Frames a GPU result may lag behind before its ring slot is needed again
+static const size_t kGpuFrameLatency = 5;
+
+/// Events a spare history frame has room for, frames with more grow their buffers
+static const size_t kReservedCpuEvents = 32;
+static const size_t kReservedGpuEvents = 16;
+
+Profiler::Profiler() : enabled(true) {}
+
+Profiler::~Profiler() {
+  std::lock_guard<std::mutex> lock(this->threadsMutex);
+  for (ThreadBuffer *buffer : this->threads) {
+    delete buffer;
+  }
+  for (GpuFrame *frame : this->gpuFrames) {
+    delete frame;
+  }
+}
+
+Profiler &Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+uint64_t Profiler::Now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::setEnabled(bool enabled) {
+  this->enabled.store(enabled);
+}
+
+bool Profiler::isEnabled() const {
+  return this->enabled.load();
+}
+
+void Profiler::setPaused(bool paused) {
+  this->paused = paused;
+}
+
+bool Profiler::isPaused() const {
+  return this->paused;
+}
+
+void Profiler::setHistorySize(size_t frames) {
+  // Unroll the ring, keeping the newest frames that still fit
+  size_t count = std::min(this->frames.size(), frames);
+  std::vector<ProfileFrame> kept;
+  kept.reserve(frames);
+  for (size_t i = this->frames.size() - count; i < this->frames.size(); i++) {
+    kept.push_back(std::move(this->frames[(this->oldestFrame + i) % this->frames.size()]));
+  }
+  this->frames.swap(kept);
+  this->oldestFrame = 0;
+  this->historySize = frames;
+
+  this->spareFrames.resize(frames - count);
+  for (ProfileFrame &frame : this->spareFrames) {
+    frame.cpuEvents.reserve(kReservedCpuEvents);
+    frame.gpuEvents.reserve(kReservedGpuEvents);
+  }
+}
+
+void Profiler::flush() {
+  if (!this->gpuInitialized) {
+    return;
+  }
+
+  glFinish();
+  resolveGpuFrames();
+}
+
+void Profiler::setThreadName(const std::string &name) {
+  ThreadBuffer *buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock(this->threadsMutex);
+  buffer->name = name;
+}
+
+void Profiler::beginFrame() {
+  if (!this->gpuInitialized) {
+    this->gpuInitialized = true;
+    for (size_t i = 0; i < kGpuFrameLatency; i++) {
+      GpuFrame *frame = new GpuFrame();
+      glGenQueries(GpuFrame::kMaxQueries, frame->queries);
+      this->gpuFrames.push_back(frame);
+    }
+
+    // Map the GPU clock onto ours once, both are monotonic nanosecond clocks
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    this->gpuClockOffset = static_cast<int64_t>(Now()) - static_cast<int64_t>(gpuTime);
+  }
+
+  resolveGpuFrames();
+
+  // Keeps the capacity of the event buffers, which were recycled from the oldest frame once the history is full
+  this->current.cpuEvents.clear();
+  this->current.gpuEvents.clear();
+  this->current.gpuResolved = false;
+  this->current.end = 0;
+  this->current.index = ++this->frameCounter;
+  this->current.start = Now();
+
+  // Skip GPU scopes for this frame rather than waiting for results that are not back yet
+  GpuFrame *frame = this->gpuFrames[this->gpuFrameIndex % this->gpuFrames.size()];
+  if (frame->pending || !isEnabled()) {
+    this->activeGpuFrame = nullptr;
+  } else {
+    frame->used = 0;
+    frame->scopes.clear();
+    frame->open.clear();
+    frame->frameIndex = this->current.index;
+    this->activeGpuFrame = frame;
+  }
+}
+
+void Profiler::endFrame() {
+  this->current.end = Now();
+  collectCpuEvents();
+
+  // Frames without GPU scopes have nothing to wait for
+  this->current.gpuResolved = true;
+  if (this->activeGpuFrame != nullptr) {
+    // Close scopes left open so their queries can still be resolved
+    while (!this->activeGpuFrame->open.empty()) {
+      endGpuScope();
+    }
+    this->activeGpuFrame->pending = this->activeGpuFrame->used > 0;
+    this->current.gpuResolved = !this->activeGpuFrame->pending;
+    this->activeGpuFrame = nullptr;
+    this->gpuFrameIndex++;
+  }
+
+  if (!this->paused && this->historySize > 0) {
+    if (this->frames.size() < this->historySize) {
+      this->frames.push_back(std::move(this->current));
+      if (this->spareFrames.empty()) {
+        this->current = ProfileFrame();
+      } else {
+        this->current = std::move(this->spareFrames.back());
+        this->spareFrames.pop_back();
+      }
+    } else {
+      std::swap(this->frames[this->oldestFrame], this->current);
+      this->oldestFrame = (this->oldestFrame + 1) % this->frames.size();
+    }
+  }
+}
+
+bool Profiler::beginCpuScope(const char *name) {
+  if (!isEnabled()) {
+    return false;
+  }
+
+  ThreadBuffer *buffer = getThreadBuffer();
+  if (buffer->depth < ThreadBuffer::kMaxDepth) {
+    buffer->names[buffer->depth] = name;
+    buffer->starts[buffer->depth] = Now();
+  }
+  buffer->depth++;
+  return true;
+}
+
+void Profiler::endCpuScope() {
+  ThreadBuffer *buffer = getThreadBuffer();
+  if (buffer->depth == 0) {
+    return;
+  }
+
+  buffer->depth--;
+  if (buffer->depth >= ThreadBuffer::kMaxDepth) {
+    return;
+  }
+
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+  if (head - tail >= ThreadBuffer::kCapacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ProfileEvent &event = buffer->events[head % ThreadBuffer::kCapacity];
+  event.name = buffer->names[buffer->depth];
+  event.start = buffer->starts[buffer->depth];
+  event.end = Now();
+  event.depth = buffer->depth;
+  event.thread = buffer->index;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::beginGpuScope(const char *name) {
+  GpuFrame *frame = this->activeGpuFrame;
+  if (frame == nullptr || !isEnabled()) {
+    return false;
+  }
+
+  // Keep room for the end queries of every open scope
+  if (frame->used + 2 * (frame->open.size() + 1) > GpuFrame::kMaxQueries) {
+    return false;
+  }
+
+  GpuFrame::Scope scope;
+  scope.name = name;
+  scope.depth = static_cast<uint32_t>(frame->open.size());
+  scope.beginQuery = frame->used;
+  scope.endQuery = frame->used;
+  glQueryCounter(frame->queries[frame->used++], GL_TIMESTAMP);
+
+  frame->open.push_back(frame->scopes.size());
+  frame->scopes.push_back(scope);
+  return true;
+}
+
+void Profiler::endGpuScope() {
+  GpuFrame *frame = this->activeGpuFrame;
+  if (frame == nullptr || frame->open.empty()) {
+    return;
+  }
+
+  GpuFrame::Scope &scope = frame->scopes[frame->open.back()];
+  frame->open.pop_back();
+  scope.endQuery = frame->used;
+  glQueryCounter(frame->queries[frame->used++], GL_TIMESTAMP);
+}
+
+size_t Profiler::getFrameCount() const {
+  return this->frames.size();
+}
+
+const ProfileFrame &Profiler::getFrame(size_t index) const {
+  return this->frames[(this->oldestFrame + index) % this->frames.size()];
+}
+
+void Profiler::releaseGpuResources() {
+  for (GpuFrame *frame : this->gpuFrames) {
+    glDeleteQueries(GpuFrame::kMaxQueries, frame->queries);
+    delete frame;
+  }
+  this->gpuFrames.clear();
+  this->activeGpuFrame = nullptr;
+  this->gpuInitialized = false;
+}
+
+Profiler::ThreadBuffer *Profiler::getThreadBuffer() {
+  static thread_local ThreadBuffer *localBuffer = nullptr;
+  if (localBuffer == nullptr) {
+    ThreadBuffer *buffer = new ThreadBuffer();
+    std::lock_guard<std::mutex> lock(this->threadsMutex);
+    buffer->index = static_cast<uint32_t>(this->threads.size());
+    buffer->name = "Thread " + std::to_string(buffer->index);
+    this->threads.push_back(buffer);
+    localBuffer = buffer;
+  }
+  return localBuffer;
+}
+
+void Profiler::collectCpuEvents() {
+  std::lock_guard<std::mutex> lock(this->threadsMutex);
+  for (ThreadBuffer *buffer : this->threads) {
+    uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; i++) {
+      this->current.cpuEvents.push_back(buffer->events[i % ThreadBuffer::kCapacity]);
+    }
+    buffer->tail.store(head, std::memory_order_release);
+  }
+}
+
+void Profiler::resolveGpuFrames() {
+  for (GpuFrame *frame : this->gpuFrames) {
+    if (!frame->pending) {
+      continue;
+    }
+
+    // Queries complete in order, once the last one is available all of them are
+    GLint available = 0;
+    glGetQueryObjectiv(frame->queries[frame->used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      continue;
+    }
+
+    ProfileFrame *target = findFrame(frame->frameIndex);
+
+    for (const GpuFrame::Scope &scope : frame->scopes) {
+      GLuint64 begin = 0;
+      GLuint64 end = 0;
+      glGetQueryObjectui64v(frame->queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(frame->queries[scope.endQuery], GL_QUERY_RESULT, &end);
+      if (target == nullptr) {
+        continue;
+      }
+
+      ProfileEvent event;
+      event.name = scope.name;
+      event.start = static_cast<uint64_t>(static_cast<int64_t>(begin) + this->gpuClockOffset);
+      event.end = static_cast<uint64_t>(static_cast<int64_t>(end) + this->gpuClockOffset);
+      event.depth = scope.depth;
+      event.thread = kGpuThread;
+      target->gpuEvents.push_back(event);
+    }
+
+    if (target != nullptr) {
+      target->gpuResolved = true;
+    }
+    frame->pending = false;
+  }
+}
+
+ProfileFrame *Profiler::findFrame(uint64_t index) {
+  for (ProfileFrame &frame : this->frames) {
+    if (frame.index == index) {
+      return &frame;
+    }
+  }
+  return nullptr;
+}
+
+std::string Profiler::getThreadName(uint32_t thread) {
+  if (thread == kGpuThread) {
+    return "GPU";
+  }
+
+  std::lock_guard<std::mutex> lock(this->threadsMutex);
+  if (thread < this->threads.size()) {
+    return this->threads[thread]->name;
+  }
+  return "Thread " + std::to_string(thread);
+}
+
+static ImU32 EventColor(const char *name) {
+  // Stable color per scope name
+  uint32_t hash = 2166136261u;
+  for (const char *c = name; *c != '\0'; c++) {
+    hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+  }
+  return IM_COL32(90 + (hash & 0x7F), 90 + ((hash >> 8) & 0x7F), 90 + ((hash >> 16) & 0x7F), 255);
+}
+
+void Profiler::showWindow(bool *open) {
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  bool enabled = isEnabled();
+  if (ImGui::Checkbox("Enabled", &enabled)) {
+    setEnabled(enabled);
+  }
+  ImGui::SameLine();
+  ImGui::Checkbox("Paused", &this->paused);
+  ImGui::SameLine();
+  if (ImGui::Button("Export Trace")) {
+    this->exportMessage = exportChromeTrace("profile.json")
+                          ? "Wrote " + std::to_string(this->frames.size()) + " frames to profile.json"
+                          : "Could not write profile.json";
+  }
+  if (!this->exportMessage.empty()) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted(this->exportMessage.c_str());
+  }
+
+  if (this->frames.empty()) {
+    ImGui::Text("No frames recorded");
+    ImGui::End();
+    return;
+  }
+
+  this->frameTimes.clear();
+  float worst = 0.0f;
+  for (size_t i = 0; i < this->frames.size(); i++) {
+    const ProfileFrame &frame = getFrame(i);
+    float milliseconds = static_cast<float>(frame.end - frame.start) / 1e6f;
+    this->frameTimes.push_back(milliseconds);
+    worst = std::max(worst, milliseconds);
+  }
+  ImGui::PlotHistogram("##frames", this->frameTimes.data(), static_cast<int>(this->frameTimes.size()), 0,
+                       "Frame time (ms)", 0.0f, worst, ImVec2(ImGui::GetContentRegionAvail().x, 60.0f));
+
+  int lastFrame = static_cast<int>(this->frames.size()) - 1;
+  this->selectedFrame = std::min(std::max(this->selectedFrame, 0), lastFrame);
+  ImGui::SliderInt("Frames ago", &this->selectedFrame, 0, lastFrame);
+
+  const ProfileFrame &frame = getFrame(static_cast<size_t>(lastFrame - this->selectedFrame));
+  ImGui::Text("Frame %llu: %.3f ms, %zu CPU scopes, %zu GPU scopes%s", static_cast<unsigned long long>(frame.index),
+              (frame.end - frame.start) / 1e6, frame.cpuEvents.size(), frame.gpuEvents.size(),
+              frame.gpuResolved ? "" : " (GPU pending)");
+  ImGui::Separator();
+
+  // Lanes per thread, GPU last. The visible range covers the frame and any GPU work that finished after it.
+  uint64_t rangeStart = frame.start;
+  uint64_t rangeEnd = frame.end;
+  std::vector<uint32_t> lanes;
+  for (const ProfileEvent &event : frame.cpuEvents) {
+    if (std::find(lanes.begin(), lanes.end(), event.thread) == lanes.end()) {
+      lanes.push_back(event.thread);
+    }
+  }
+  std::sort(lanes.begin(), lanes.end());
+  if (!frame.gpuEvents.empty()) {
+    lanes.push_back(kGpuThread);
+  }
+  for (const ProfileEvent &event : frame.gpuEvents) {
+    rangeStart = std::min(rangeStart, event.start);
+    rangeEnd = std::max(rangeEnd, event.end);
+  }
+  double range = static_cast<double>(std::max<uint64_t>(rangeEnd - rangeStart, 1));
+
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+  float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+  float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+  ImVec2 mouse = ImGui::GetIO().MousePos;
+
+  for (uint32_t lane : lanes) {
+    const std::vector<ProfileEvent> &events = lane == kGpuThread ? frame.gpuEvents : frame.cpuEvents;
+    uint32_t maxDepth = 0;
+    for (const ProfileEvent &event : events) {
+      if (event.thread == lane) maxDepth = std::max(maxDepth, event.depth);
+    }
+
+    ImGui::Text("%s", getThreadName(lane).c_str());
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float height = (maxDepth + 1) * rowHeight;
+    drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(40, 40, 40, 255));
+
+    for (const ProfileEvent &event : events) {
+      if (event.thread != lane) {
+        continue;
+      }
+
+      float x0 = origin.x + static_cast<float>((event.start - rangeStart) / range) * width;
+      float x1 = origin.x + static_cast<float>((event.end - rangeStart) / range) * width;
+      x1 = std::max(x1, x0 + 1.0f);
+      float y0 = origin.y + event.depth * rowHeight;
+      ImVec2 min(x0, y0);
+      ImVec2 max(x1, y0 + rowHeight - 1.0f);
+      drawList->AddRectFilled(min, max, EventColor(event.name));
+
+      if (x1 - x0 > ImGui::CalcTextSize(event.name).x + 4.0f) {
+        drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(0, 0, 0, 255), event.name);
+      }
+      if (mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+        ImGui::SetTooltip("%s\n%.3f ms", event.name, (event.end - event.start) / 1e6);
+      }
+    }
+    ImGui::Dummy(ImVec2(width, height));
+  }
+
+  ImGui::End();
+}
+
+static void WriteJsonString(std::ofstream &stream, const std::string &value) {
+  stream << '"';
+  for (char c : value) {
+    switch (c) {
+      case '"': stream << "\\\"";
+        break;
+      case '\\': stream << "\\\\";
+        break;
+      case '\n': stream << "\\n";
+        break;
+      case '\t': stream << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          stream << escaped;
+        } else {
+          stream << c;
+        }
+    }
+  }
+  stream << '"';
+}
+
+bool Profiler::exportChromeTrace(const std::string &path) {
+  std::ofstream stream(path, std::ios::out | std::ios::trunc);
+  if (!stream.is_open()) {
+    fprintf(stderr, "Error: could not open trace file '%s'\n", path.c_str());
+    return false;
+  }
+
+  uint64_t origin = this->frames.empty() ? 0 : getFrame(0).start;
+  std::vector<uint32_t> threadIds;
+  bool first = true;
+  auto writeEvent = [&](const ProfileEvent &event) {
+    // Chrome traces use microseconds
+    double start = (static_cast<double>(event.start) - static_cast<double>(origin)) / 1000.0;
+    double duration = static_cast<double>(event.end - event.start) / 1000.0;
+    stream << (first ? "\n" : ",\n") << "{\"name\":";
+    WriteJsonString(stream, event.name);
+    stream << ",\"cat\":\"" << (event.thread == kGpuThread ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << start
+           << ",\"dur\":" << duration << ",\"pid\":0,\"tid\":" << event.thread << "}";
+    first = false;
+
+    if (std::find(threadIds.begin(), threadIds.end(), event.thread) == threadIds.end()) {
+      threadIds.push_back(event.thread);
+    }
+  };
+
+  stream.precision(3);
+  stream << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < this->frames.size(); i++) {
+    const ProfileFrame &frame = getFrame(i);
+    ProfileEvent frameEvent = {"Frame", frame.start, frame.end, 0, kGpuThread - 1};
+    writeEvent(frameEvent);
+    for (const ProfileEvent &event : frame.cpuEvents) {
+      writeEvent(event);
+    }
+    for (const ProfileEvent &event : frame.gpuEvents) {
+      writeEvent(event);
+    }
+  }
+
+  for (uint32_t thread : threadIds) {
+    std::string name = thread == kGpuThread - 1 ? "Frames" : getThreadName(thread);
+    stream << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread
+           << ",\"args\":{\"name\":";
+    WriteJsonString(stream, name);
+    stream << "}}";
+    first = false;
+  }
+  stream << "\n]}\n";
+
+  return stream.good();
+}
+
+}
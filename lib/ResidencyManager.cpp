@@ -0,0 +1,276 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <meshoptimizer.h>
+
+#include "cg/ResidencyManager.h"
+
+namespace cg {
+
+namespace {
+
+void BuildLowDetail(Span<const cg::Vertex> vertices, Span<const unsigned int> indices, float ratio, size_t minimum,
+                    std::vector<cg::Vertex> &lowVertices, std::vector<unsigned int> &lowIndices) {
+  size_t targetIndices = std::max(static_cast<size_t>(indices.size() * ratio) / 3 * 3, minimum);
+  if (vertices.empty() || targetIndices >= indices.size()) {
+    return;
+  }
+
+  // Any error is fine, the low detail version is only seen while the full mesh streams back in
+  lowIndices.resize(indices.size());
+  lowIndices.resize(meshopt_simplify(lowIndices.data(), indices.data(), indices.size(), &vertices[0].position.x,
+                                     vertices.size(), sizeof(cg::Vertex), targetIndices, 1.0f));
+  lowIndices.shrink_to_fit();
+
+  // Keep only the vertices the remaining triangles use
+  lowVertices.resize(vertices.size());
+  lowVertices.resize(meshopt_optimizeVertexFetch(lowVertices.data(), lowIndices.data(), lowIndices.size(),
+                                                 vertices.data(), vertices.size(), sizeof(cg::Vertex)));
+  lowVertices.shrink_to_fit();
+}
+
+}
+
+ResidencyManager::ResidencyManager(const ResidencySettings &settings) : settings(settings) {}
+
+ResidencyManager::~ResidencyManager() {
+  JobSystem &jobs = JobSystem::Get();
+  for (const std::unique_ptr<Entry> &entry : this->entries) {
+    jobs.wait(entry->lowDetailJob);
+    jobs.wait(entry->streamInJob);
+  }
+  for (const std::unique_ptr<Entry> &entry : this->retired) {
+    jobs.wait(entry->streamInJob);
+  }
+}
+
+void ResidencyManager::add(Mesh *mesh, MeshLoader loader) {
+  if (!mesh || this->lookup.count(mesh)) {
+    return;
+  }
+
+  this->entries.emplace_back(new Entry());
+  Entry *entry = this->entries.back().get();
+  entry->mesh = mesh;
+  entry->loader = std::move(loader);
+  entry->lastVisibleFrame = this->frame;
+  this->lookup[mesh] = this->entries.size() - 1;
+
+  // A mesh that is still uploading gets its retained data only once it is drawable, see update()
+  if (mesh->isDrawable()) {
+    startLowDetail(*entry);
+  }
+}
+
+void ResidencyManager::add(Mesh *mesh, MeshLoader loader, std::vector<cg::Vertex> &&lowVertices,
+                           std::vector<unsigned int> &&lowIndices) {
+  if (!mesh || this->lookup.count(mesh)) {
+    return;
+  }
+
+  this->entries.emplace_back(new Entry());
+  Entry *entry = this->entries.back().get();
+  entry->mesh = mesh;
+  entry->loader = std::move(loader);
+  entry->lastVisibleFrame = this->frame;
+  entry->lowVertices = std::move(lowVertices);
+  entry->lowIndices = std::move(lowIndices);
+  entry->lowDetailStarted = true;
+  entry->lowDetailReady.store(true, std::memory_order_relaxed);
+  this->lookup[mesh] = this->entries.size() - 1;
+}
+
+void ResidencyManager::buildLowDetail(Span<const cg::Vertex> vertices, Span<const unsigned int> indices,
+                                      std::vector<cg::Vertex> &lowVertices,
+                                      std::vector<unsigned int> &lowIndices) const {
+  BuildLowDetail(vertices, indices, this->settings.lowDetailRatio, this->settings.lowDetailTriangles * 3, lowVertices,
+                 lowIndices);
+}
+
+void ResidencyManager::startLowDetail(Entry &entry) {
+  entry.lowDetailStarted = true;
+  float ratio = this->settings.lowDetailRatio;
+  size_t minimum = this->settings.lowDetailTriangles * 3;
+  JobSystem::Get().run([&entry, ratio, minimum]() {
+    // The retained data never changes after the mesh was created, it can be read while the mesh is in use. Without
+    // retained data there is nothing to build from, the loader is only for streaming the mesh back in.
+    BuildLowDetail(entry.mesh->getVertices(), entry.mesh->getIndices(), ratio, minimum, entry.lowVertices,
+                   entry.lowIndices);
+    entry.lowDetailReady.store(true, std::memory_order_release);
+  }, &entry.lowDetailJob);
+}
+
+void ResidencyManager::remove(const Mesh *mesh) {
+  auto found = this->lookup.find(mesh);
+  if (found == this->lookup.end()) {
+    return;
+  }
+
+  size_t index = found->second;
+  std::unique_ptr<Entry> entry = std::move(this->entries[index]);
+  JobSystem::Get().wait(entry->lowDetailJob);
+  if (!entry->streamInJob.isDone()) {
+    this->retired.push_back(std::move(entry));
+  }
+  this->lookup.erase(found);
+
+  if (index != this->entries.size() - 1) {
+    this->entries[index] = std::move(this->entries.back());
+    this->lookup[this->entries[index]->mesh] = index;
+  }
+  this->entries.pop_back();
+}
+
+void ResidencyManager::markVisible(const Mesh *mesh) {
+  auto found = this->lookup.find(mesh);
+  if (found != this->lookup.end()) {
+    this->entries[found->second]->lastVisibleFrame = this->frame;
+  }
+}
+
+void ResidencyManager::update() {
+  this->stats.evictions = 0;
+  this->stats.streamIns = 0;
+  this->stats.streaming = 0;
+
+  this->retired.erase(std::remove_if(this->retired.begin(), this->retired.end(),
+                                     [](const std::unique_ptr<Entry> &entry) {
+                                       return entry->streamInJob.isDone();
+                                     }), this->retired.end());
+
+  size_t resident = 0;
+  for (const std::unique_ptr<Entry> &pointer : this->entries) {
+    Entry &entry = *pointer;
+    if (!entry.lowDetailStarted && entry.mesh->isDrawable()) {
+      startLowDetail(entry);
+    }
+    if (!entry.lowDetailTracked && entry.lowDetailReady.load(std::memory_order_acquire)) {
+      entry.memory.resize(entry.lowVertices.capacity() * sizeof(cg::Vertex)
+                              + entry.lowIndices.capacity() * sizeof(unsigned int), 0);
+      entry.lowDetailTracked = true;
+    }
+
+    if (entry.loading && entry.loaded.load(std::memory_order_acquire)) {
+      entry.loading = false;
+      entry.loaded.store(false, std::memory_order_relaxed);
+      if (!entry.loadFailed) {
+        entry.mesh->replaceGpuData(entry.loadedVertices, entry.loadedIndices, false);
+        this->stats.streamIns++;
+      }
+      std::vector<cg::Vertex>().swap(entry.loadedVertices);
+      std::vector<unsigned int>().swap(entry.loadedIndices);
+    }
+
+    if (entry.mesh->isLowDetail() && !entry.loading && entry.lastVisibleFrame == this->frame) {
+      startStreamIn(entry);
+    }
+    if (entry.loading) {
+      this->stats.streaming++;
+    }
+    resident += entry.mesh->getGpuSize();
+  }
+
+  if (resident > this->settings.budget) {
+    // Least recently visible first, and of those the largest
+    this->candidates.clear();
+    for (const std::unique_ptr<Entry> &entry : this->entries) {
+      if (canEvict(*entry)) {
+        this->candidates.push_back(entry.get());
+      }
+    }
+    std::sort(this->candidates.begin(), this->candidates.end(), [](const Entry *a, const Entry *b) {
+      if (a->lastVisibleFrame != b->lastVisibleFrame) {
+        return a->lastVisibleFrame < b->lastVisibleFrame;
+      }
+      return a->mesh->getGpuSize() > b->mesh->getGpuSize();
+    });
+
+    for (Entry *entry : this->candidates) {
+      if (resident <= this->settings.budget) {
+        break;
+      }
+      resident -= entry->mesh->getGpuSize();
+      entry->mesh->replaceGpuData(entry->lowVertices, entry->lowIndices, true);
+      resident += entry->mesh->getGpuSize();
+      this->stats.evictions++;
+    }
+  }
+
+  this->stats.meshes = this->entries.size();
+  this->stats.evicted = 0;
+  for (const std::unique_ptr<Entry> &entry : this->entries) {
+    if (entry->mesh->isLowDetail()) {
+      this->stats.evicted++;
+    }
+  }
+  this->stats.residentBytes = resident;
+  this->frame++;
+}
+
+void ResidencyManager::setBudget(size_t bytes) {
+  this->settings.budget = bytes;
+}
+
+const ResidencySettings &ResidencyManager::getSettings() const {
+  return this->settings;
+}
+
+const ResidencyStats &ResidencyManager::getStats() const {
+  return this->stats;
+}
+
+void ResidencyManager::startStreamIn(Entry &entry) {
+  // Retained data is already in memory, only the upload is left
+  if (!entry.mesh->getVertices().empty()) {
+    entry.mesh->replaceGpuData(entry.mesh->getVertices(), entry.mesh->getIndices(), false);
+    this->stats.streamIns++;
+    return;
+  }
+
+  if (this->stats.streaming >= this->settings.maxStreamIns) {
+    return;
+  }
+
+  entry.loading = true;
+  entry.loadFailed = false;
+  JobSystem::Get().run([&entry]() {
+    entry.loadFailed = !entry.loader(entry.loadedVertices, entry.loadedIndices);
+    entry.loaded.store(true, std::memory_order_release);
+  }, &entry.streamInJob);
+}
+
+bool ResidencyManager::canEvict(const Entry &entry) const {
+  if (entry.mesh->isLowDetail() || entry.loading || !entry.lowDetailReady.load(std::memory_order_acquire)) {
+    return false;
+  }
+  if (entry.lowIndices.empty() || this->frame - entry.lastVisibleFrame < this->settings.evictionDelay) {
+    return false;
+  }
+
+  // Without retained data or a loader an evicted mesh could never come back
+  return !entry.mesh->getVertices().empty() || static_cast<bool>(entry.loader);
+}
+
+}
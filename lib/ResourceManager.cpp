@@ -0,0 +1,252 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdio>
+
+#include "cg/ResourceManager.h"
+#include "cg/common/FileWatcher.h"
+
+namespace cg {
+
+ResourceManager::~ResourceManager() {
+  collect();
+  if (this->residency) {
+    for (const std::unique_ptr<Mesh> &mesh : this->meshes.getResources()) {
+      this->residency->remove(mesh.get());
+    }
+  }
+}
+
+std::string ResourceManager::MakeKey(const std::string &path, const std::string &settings) {
+  return FileWatcher::CanonicalPath(path) + "|" + settings;
+}
+
+void ResourceManager::setResidencyManager(ResidencyManager *residency) {
+  this->residency = residency;
+}
+
+MeshHandle ResourceManager::loadMesh(const std::string &path, unsigned int index, MeshRetention retention) {
+  std::string key =
+      MakeKey(path, "mesh " + std::to_string(index) + " retention " + std::to_string(static_cast<int>(retention)));
+  MeshHandle handle = this->meshes.find(key);
+  if (handle.isValid()) {
+    this->meshes.acquire(handle);
+    return handle;
+  }
+
+  std::vector<cg::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  if (!Mesh::ImportData(path, index, vertices, indices)) {
+    return MeshHandle();
+  }
+
+  // A mesh that drops its data gets its low detail version now, while the imported data is still here, and the file
+  // is only imported again to stream the full mesh back in after an eviction
+  bool retained = retention == MeshRetention::Keep;
+  std::vector<cg::Vertex> lowVertices;
+  std::vector<unsigned int> lowIndices;
+  if (this->residency && !retained) {
+    this->residency->buildLowDetail(vertices, indices, lowVertices, lowIndices);
+  }
+
+  Mesh *mesh = new Mesh(std::move(vertices), std::move(indices), retention);
+  mesh->setAssetName(path);
+
+  if (this->residency && retained) {
+    this->residency->add(mesh);
+  } else if (this->residency) {
+    MeshLoader loader = [path, index](std::vector<cg::Vertex> &vertices, std::vector<unsigned int> &indices) {
+      return Mesh::ImportData(path, index, vertices, indices);
+    };
+    this->residency->add(mesh, std::move(loader), std::move(lowVertices), std::move(lowIndices));
+  }
+  return this->meshes.add(key, std::unique_ptr<Mesh>(mesh));
+}
+
+MeshHandle ResourceManager::addMesh(const std::string &key, Mesh *mesh) {
+  if (!mesh) {
+    return MeshHandle();
+  }
+  if (this->residency) {
+    this->residency->add(mesh);
+  }
+
+  // A second mesh under a key that is still loaded would make find() ambiguous, store it without the key instead
+  if (!key.empty() && this->meshes.find(key).isValid()) {
+    fprintf(stderr, "Error: a mesh is already loaded as '%s', the new one is not deduplicated\n", key.c_str());
+    return this->meshes.add(std::string(), std::unique_ptr<Mesh>(mesh));
+  }
+  return this->meshes.add(key, std::unique_ptr<Mesh>(mesh));
+}
+
+MeshHandle ResourceManager::findMesh(const std::string &key) const {
+  return this->meshes.find(key);
+}
+
+ShaderHandle ResourceManager::loadShader(ShaderType type, const std::string &path) {
+  std::string key = MakeKey(path, "shader " + std::to_string(static_cast<int>(type)));
+  ShaderHandle handle = this->shaders.find(key);
+  if (handle.isValid()) {
+    this->shaders.acquire(handle);
+    return handle;
+  }
+
+  std::unique_ptr<Shader> shader(Shader::LoadFromSourceFile(type, path));
+  if (!shader || !shader->compileShader()) {
+    return ShaderHandle();
+  }
+  return this->shaders.add(key, std::move(shader));
+}
+
+ProgramHandle ResourceManager::loadProgram(const std::vector<ShaderStageFile> &stages) {
+  std::string key;
+  for (const ShaderStageFile &stage : stages) {
+    key += MakeKey(stage.path, "shader " + std::to_string(static_cast<int>(stage.type))) + ";";
+  }
+
+  ProgramHandle handle = this->programs.find(key);
+  if (handle.isValid()) {
+    this->programs.acquire(handle);
+    return handle;
+  }
+
+  std::vector<ShaderHandle> stageShaders;
+  bool compiled = true;
+  for (const ShaderStageFile &stage : stages) {
+    ShaderHandle shader = loadShader(stage.type, stage.path);
+    if (!shader.isValid()) {
+      compiled = false;
+      break;
+    }
+    stageShaders.push_back(shader);
+  }
+
+  std::unique_ptr<ShaderProgram> program;
+  if (compiled) {
+    program.reset(new ShaderProgram());
+    for (ShaderHandle shader : stageShaders) {
+      program->attachShader(get(shader));
+    }
+    if (!program->linkProgram()) {
+      program.reset();
+    } else {
+      for (ShaderHandle shader : stageShaders) {
+        program->detachShader(get(shader));
+      }
+    }
+  }
+
+  // The program does not need its shaders once linked, they only stay loaded while someone else refers to them
+  for (ShaderHandle shader : stageShaders) {
+    release(shader);
+  }
+
+  if (!program) {
+    return ProgramHandle();
+  }
+  program->setAssetName(stages.empty() ? std::string() : stages.back().path);
+  return this->programs.add(key, std::move(program));
+}
+
+Mesh *ResourceManager::get(MeshHandle handle) const {
+  return this->meshes.get(handle);
+}
+
+Shader *ResourceManager::get(ShaderHandle handle) const {
+  return this->shaders.get(handle);
+}
+
+ShaderProgram *ResourceManager::get(ProgramHandle handle) const {
+  return this->programs.get(handle);
+}
+
+void ResourceManager::acquire(MeshHandle handle) {
+  this->meshes.acquire(handle);
+}
+
+void ResourceManager::acquire(ShaderHandle handle) {
+  this->shaders.acquire(handle);
+}
+
+void ResourceManager::acquire(ProgramHandle handle) {
+  this->programs.acquire(handle);
+}
+
+void ResourceManager::release(MeshHandle handle) {
+  std::unique_ptr<Mesh> mesh = this->meshes.release(handle);
+  if (mesh) {
+    if (this->residency) {
+      this->residency->remove(mesh.get());
+    }
+    this->releasedMeshes.push_back(std::move(mesh));
+  }
+}
+
+void ResourceManager::release(ShaderHandle handle) {
+  std::unique_ptr<Shader> shader = this->shaders.release(handle);
+  if (shader) {
+    this->releasedShaders.push_back(std::move(shader));
+  }
+}
+
+void ResourceManager::release(ProgramHandle handle) {
+  std::unique_ptr<ShaderProgram> program = this->programs.release(handle);
+  if (program) {
+    this->releasedPrograms.push_back(std::move(program));
+  }
+}
+
+uint32_t ResourceManager::getReferenceCount(MeshHandle handle) const {
+  return this->meshes.getReferenceCount(handle);
+}
+
+uint32_t ResourceManager::getReferenceCount(ShaderHandle handle) const {
+  return this->shaders.getReferenceCount(handle);
+}
+
+uint32_t ResourceManager::getReferenceCount(ProgramHandle handle) const {
+  return this->programs.getReferenceCount(handle);
+}
+
+const ResourcePool<Mesh> &ResourceManager::getMeshes() const {
+  return this->meshes;
+}
+
+const ResourcePool<Shader> &ResourceManager::getShaders() const {
+  return this->shaders;
+}
+
+const ResourcePool<ShaderProgram> &ResourceManager::getPrograms() const {
+  return this->programs;
+}
+
+size_t ResourceManager::collect() {
+  size_t deleted = this->releasedMeshes.size() + this->releasedShaders.size() + this->releasedPrograms.size();
+  this->releasedMeshes.clear();
+  this->releasedShaders.clear();
+  this->releasedPrograms.clear();
+  return deleted;
+}
+
+}
@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cg/ScratchAllocator.h"
+
+namespace cg {
+
+ScratchAllocator::ScratchAllocator(size_t blockSize) : blockSize(blockSize) {}
+
+ScratchAllocator::~ScratchAllocator() {
+  for (Block &block : this->blocks) {
+    std::free(block.data);
+  }
+}
+
+ScratchAllocator &ScratchAllocator::Get() {
+  static thread_local ScratchAllocator allocator;
+  return allocator;
+}
+
+void *ScratchAllocator::allocate(size_t size, size_t alignment) {
+  // Try the current block first, then the following ones that are left over from before a rewind
+  while (this->current < this->blocks.size()) {
+    Block &block = this->blocks[this->current];
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+    uintptr_t aligned = (base + this->offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (aligned + size <= base + block.size) {
+      this->offset = aligned + size - base;
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    this->current++;
+    this->offset = 0;
+  }
+
+  // Blocks come from malloc and are aligned for any fundamental type, larger alignments need some padding
+  size_t required = size + (alignment > alignof(std::max_align_t) ? alignment : 0);
+  Block block;
+  block.size = required > this->blockSize ? required : this->blockSize;
+  block.data = static_cast<char *>(std::malloc(block.size));
+  if (!block.data) {
+    fprintf(stderr, "Error: could not allocate a scratch block of %zu bytes\n", block.size);
+    return nullptr;
+  }
+
+  this->blocks.push_back(block);
+  this->current = this->blocks.size() - 1;
+  this->offset = 0;
+  return allocate(size, alignment);
+}
+
+ScratchAllocator::Marker ScratchAllocator::getMarker() const {
+  Marker marker;
+  marker.block = this->current;
+  marker.offset = this->offset;
+  return marker;
+}
+
+void ScratchAllocator::rewind(const Marker &marker) {
+  this->current = marker.block;
+  this->offset = marker.offset;
+  releaseOversizedBlocks();
+}
+
+void ScratchAllocator::reset() {
+  this->current = 0;
+  this->offset = 0;
+  releaseOversizedBlocks();
+}
+
+void ScratchAllocator::releaseOversizedBlocks() {
+  // Only blocks past the current one are unused, regular sized ones are kept for reuse
+  size_t kept = this->current + 1;
+  for (size_t i = this->current + 1; i < this->blocks.size(); i++) {
+    if (this->blocks[i].size > this->blockSize) {
+      std::free(this->blocks[i].data);
+    } else {
+      this->blocks[kept++] = this->blocks[i];
+    }
+  }
+  if (kept < this->blocks.size()) this->blocks.resize(kept);
+}
+
+size_t ScratchAllocator::getCapacity() const {
+  size_t capacity = 0;
+  for (const Block &block : this->blocks) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+}
@@ -0,0 +1,355 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "cg/TextureStreamer.h"
+#include "cg/common/FileWatcher.h"
+
+namespace cg {
+
+Texture2D *StreamedTexture::getTexture() const {
+  return this->residentLevel < this->levelCount ? this->texture.get() : nullptr;
+}
+
+const std::string &StreamedTexture::getPath() const {
+  return this->path;
+}
+
+bool StreamedTexture::hasFailed() const {
+  return this->decoded.load(std::memory_order_acquire) && this->failed;
+}
+
+bool StreamedTexture::isComplete() const {
+  return this->levelCount > 0 && this->residentLevel == this->storageLevel;
+}
+
+int StreamedTexture::getResidentLevel() const {
+  return this->residentLevel;
+}
+
+int StreamedTexture::getLevelCount() const {
+  return this->levelCount;
+}
+
+const int TextureStreamer::kStagingBuffers;
+
+TextureStreamer::TextureStreamer(const TextureStreamingSettings &settings) : settings(settings) {
+  // At least one row of the largest texture OpenGL allows has to fit, or that texture could never be uploaded
+  this->stagingSize = std::max(settings.uploadBytesPerFrame, static_cast<size_t>(16384 * 4));
+  for (StagingBuffer &buffer : this->staging) {
+    glCreateBuffers(1, &buffer.buffer);
+    glNamedBufferData(buffer.buffer, this->stagingSize, nullptr, GL_STREAM_DRAW);
+  }
+  this->stagingMemory.resize(0, this->stagingSize * kStagingBuffers);
+}
+
+TextureStreamer::~TextureStreamer() {
+  JobSystem::Get().wait(this->decodes);
+  for (StagingBuffer &buffer : this->staging) {
+    if (buffer.fence) {
+      glDeleteSync(buffer.fence);
+    }
+    glDeleteBuffers(1, &buffer.buffer);
+  }
+}
+
+StreamedTexture *TextureStreamer::load(const std::string &path) {
+  std::string key = FileWatcher::CanonicalPath(path);
+  auto found = this->textures.find(key);
+  if (found != this->textures.end()) {
+    return found->second.get();
+  }
+
+  auto *texture = new StreamedTexture(path);
+  texture->memory.rename(path);
+  this->textures[key].reset(texture);
+  decode(texture);
+  return texture;
+}
+
+void TextureStreamer::unload(StreamedTexture *texture) {
+  auto found = this->textures.find(FileWatcher::CanonicalPath(texture->path));
+  if (found == this->textures.end() || found->second.get() != texture) {
+    return;
+  }
+
+  // The decode job still writes to the texture, keep it until the job is done
+  if (!texture->decoded.load(std::memory_order_acquire)) {
+    this->unloaded.push_back(std::move(found->second));
+  }
+  this->textures.erase(found);
+}
+
+void TextureStreamer::markUsed(StreamedTexture *texture, float screenSize) {
+  if (!texture->used || texture->lastUsedFrame != this->frame) {
+    texture->usedSize = screenSize;
+  } else {
+    texture->usedSize = std::max(texture->usedSize, screenSize);
+  }
+  texture->lastUsedFrame = this->frame;
+  texture->used = true;
+}
+
+void TextureStreamer::update() {
+  this->unloaded.erase(std::remove_if(this->unloaded.begin(), this->unloaded.end(),
+                                      [](const std::unique_ptr<StreamedTexture> &texture) {
+                                        return texture->decoded.load(std::memory_order_acquire);
+                                      }), this->unloaded.end());
+
+  this->stats.textures = this->textures.size();
+  this->stats.streaming = 0;
+  this->stats.uploadedBytes = 0;
+
+  this->active.clear();
+  size_t total = 0;
+  for (auto &entry : this->textures) {
+    StreamedTexture *texture = entry.second.get();
+    if (!texture->decoded.load(std::memory_order_acquire)) {
+      this->stats.streaming++;
+      continue;
+    }
+    if (texture->failed) {
+      continue;
+    }
+
+    if (texture->levelCount == 0) {
+      // Decoded since the last update, nothing is allocated yet
+      const std::vector<ImageLevel> &levels = texture->image.levels;
+      texture->levelCount = texture->image.getLevelCount();
+      texture->tailLevel = texture->levelCount - 1;
+      while (texture->tailLevel > 0 && std::max(levels[texture->tailLevel - 1].width,
+                                                levels[texture->tailLevel - 1].height) <= this->settings.minimumSize) {
+        texture->tailLevel--;
+      }
+      texture->storageLevel = texture->levelCount;
+      texture->residentLevel = texture->levelCount;
+      texture->memory.resize(texture->image.getSize(), 0);
+    }
+
+    // One texel per pixel on screen. A texture that got smaller keeps its levels until it is unused or the budget
+    // needs them, so a texture near a level boundary does not get reallocated back and forth.
+    int wanted = texture->tailLevel;
+    if (texture->used && this->frame - texture->lastUsedFrame <= this->settings.unusedFrames) {
+      float size = static_cast<float>(std::max(texture->image.getWidth(), texture->image.getHeight()));
+      float texelsPerPixel = std::max(size / std::max(texture->usedSize, 1.0f), 1.0f);
+      int level = static_cast<int>(std::floor(std::log2(texelsPerPixel)));
+      wanted = std::min(std::min(level, texture->tailLevel), texture->storageLevel);
+    }
+    texture->wantedLevel = wanted;
+
+    this->active.push_back(texture);
+    total += getStorageSize(texture, wanted);
+  }
+
+  if (total > this->settings.budget) {
+    // Take fine levels from the least recently used textures first, and of those from the largest
+    std::sort(this->active.begin(), this->active.end(), [this](StreamedTexture *a, StreamedTexture *b) {
+      if (a->lastUsedFrame != b->lastUsedFrame) {
+        return a->lastUsedFrame < b->lastUsedFrame;
+      }
+      return getStorageSize(a, a->wantedLevel) > getStorageSize(b, b->wantedLevel);
+    });
+
+    for (StreamedTexture *texture : this->active) {
+      while (total > this->settings.budget && texture->wantedLevel < texture->tailLevel) {
+        total -= getStorageSize(texture, texture->wantedLevel) - getStorageSize(texture, texture->wantedLevel + 1);
+        texture->wantedLevel++;
+      }
+      if (total <= this->settings.budget) {
+        break;
+      }
+    }
+  }
+
+  for (StreamedTexture *texture : this->active) {
+    if (texture->wantedLevel != texture->storageLevel) {
+      reallocate(texture, texture->wantedLevel);
+    }
+  }
+  this->stats.residentBytes = total;
+
+  upload();
+
+  for (StreamedTexture *texture : this->active) {
+    if (texture->residentLevel > texture->storageLevel) {
+      this->stats.streaming++;
+    }
+  }
+  this->frame++;
+}
+
+void TextureStreamer::setBudget(size_t bytes) {
+  this->settings.budget = bytes;
+}
+
+const TextureStreamingSettings &TextureStreamer::getSettings() const {
+  return this->settings;
+}
+
+const TextureStreamingStats &TextureStreamer::getStats() const {
+  return this->stats;
+}
+
+void TextureStreamer::decode(StreamedTexture *texture) {
+  MipFilter filter = this->settings.filter;
+  JobSystem::Get().run([texture, filter]() {
+    if (Image::Load(texture->path, texture->image)) {
+      texture->image.generateMips(filter);
+    } else {
+      texture->failed = true;
+    }
+    texture->decoded.store(true, std::memory_order_release);
+  }, &this->decodes);
+}
+
+void TextureStreamer::reallocate(StreamedTexture *texture, int storageLevel) {
+  const std::vector<ImageLevel> &levels = texture->image.levels;
+  std::unique_ptr<Texture2D> storage(new Texture2D(levels[storageLevel].width,
+                                                   levels[storageLevel].height,
+                                                   texture->levelCount - storageLevel,
+                                                   this->settings.internalFormat));
+
+  // Levels both textures have are copied on the GPU, growing only uploads the new fine levels. A partially uploaded
+  // level is not copied and starts over.
+  int resident = std::max(texture->residentLevel, storageLevel);
+  if (texture->texture) {
+    for (int level = resident; level < texture->levelCount; ++level) {
+      glCopyImageSubData(texture->texture->getHandle(), GL_TEXTURE_2D, level - texture->storageLevel, 0, 0, 0,
+                         storage->getHandle(), GL_TEXTURE_2D, level - storageLevel, 0, 0, 0,
+                         levels[level].width, levels[level].height, 1);
+    }
+    texture->texture->swap(*storage);
+  } else {
+    texture->texture = std::move(storage);
+    texture->texture->setAssetName(texture->path);
+  }
+
+  texture->storageLevel = storageLevel;
+  texture->residentLevel = resident;
+  texture->uploadRow = 0;
+  texture->texture->setLevelRange(std::min(resident, texture->levelCount - 1) - storageLevel,
+                                  texture->levelCount - 1 - storageLevel);
+}
+
+void TextureStreamer::upload() {
+  StagingBuffer &buffer = this->staging[this->stagingIndex];
+  if (buffer.fence) {
+    // The GPU still reads from this buffer, rather skip a frame of uploads than wait for it
+    if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      return;
+    }
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+  }
+
+  // Coarsest levels first over all textures, so every texture becomes usable before any gets sharp
+  auto pending = std::partition(this->active.begin(), this->active.end(), [](StreamedTexture *texture) {
+    return texture->residentLevel > texture->storageLevel;
+  });
+  if (pending == this->active.begin()) {
+    return;
+  }
+  std::sort(this->active.begin(), pending, [](StreamedTexture *a, StreamedTexture *b) {
+    if (a->residentLevel != b->residentLevel) {
+      return a->residentLevel > b->residentLevel;
+    }
+    return a->lastUsedFrame > b->lastUsedFrame;
+  });
+
+  // Synchronized by the fence above
+  auto *mapped = static_cast<uint8_t *>(glMapNamedBufferRange(buffer.buffer, 0, this->stagingSize,
+                                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+                                                                   | GL_MAP_UNSYNCHRONIZED_BIT));
+  if (!mapped && !this->mapFailed) {
+    fprintf(stderr, "Error: could not map a texture staging buffer, uploading from system memory instead\n");
+  }
+  this->mapFailed = !mapped;
+
+  this->uploads.clear();
+  size_t offset = 0;
+  bool full = false;
+  for (auto it = this->active.begin(); it != pending && !full; ++it) {
+    StreamedTexture *texture = *it;
+    while (texture->residentLevel > texture->storageLevel) {
+      int level = texture->residentLevel - 1;
+      const ImageLevel &source = texture->image.levels[level];
+      size_t rowSize = static_cast<size_t>(source.width) * 4;
+      int rows = static_cast<int>(std::min((this->stagingSize - offset) / rowSize,
+                                           static_cast<size_t>(source.height - texture->uploadRow)));
+      if (rows <= 0) {
+        full = true;
+        break;
+      }
+
+      if (mapped) {
+        std::memcpy(mapped + offset, &source.pixels[texture->uploadRow * rowSize], rows * rowSize);
+      }
+      this->uploads.push_back({texture, level, texture->uploadRow, rows, offset, false});
+      offset += rows * rowSize;
+      texture->uploadRow += rows;
+      if (texture->uploadRow < source.height) {
+        full = true;
+        break;
+      }
+
+      texture->uploadRow = 0;
+      texture->residentLevel = level;
+      this->uploads.back().completesLevel = true;
+    }
+  }
+  if (mapped) {
+    glUnmapNamedBuffer(buffer.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+  }
+  for (const Upload &upload : this->uploads) {
+    StreamedTexture *texture = upload.texture;
+    int storageLevel = texture->storageLevel;
+    const ImageLevel &source = texture->image.levels[upload.level];
+    const void *pixels = mapped ? reinterpret_cast<const void *>(upload.offset)
+                                : &source.pixels[static_cast<size_t>(upload.row) * source.width * 4];
+    texture->texture->upload(upload.level - storageLevel, 0, upload.row, source.width, upload.rows, pixels);
+    if (upload.completesLevel) {
+      // Sample the new level from now on, the commands that follow see the upload
+      texture->texture->setLevelRange(upload.level - storageLevel, texture->levelCount - 1 - storageLevel);
+    }
+  }
+  if (mapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  this->stagingIndex = (this->stagingIndex + 1) % kStagingBuffers;
+  this->stats.uploadedBytes = offset;
+}
+
+size_t TextureStreamer::getStorageSize(const StreamedTexture *texture, int storageLevel) const {
+  const ImageLevel &level = texture->image.levels[storageLevel];
+  return Texture2D::GetStorageSize(level.width, level.height, texture->levelCount - storageLevel,
+                                   this->settings.internalFormat);
+}
+
+}
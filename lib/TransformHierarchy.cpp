@@ -0,0 +1,221 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+#include "cg/JobSystem.h"
+#include "cg/TransformHierarchy.h"
+
+namespace cg {
+
+const uint32_t TransformHierarchy::kNone;
+
+// Nodes per job, small levels are not worth splitting
+static const size_t kGrain = 2048;
+
+void TransformHierarchy::reserve(size_t count) {
+  this->positions.reserve(count);
+  this->rotations.reserve(count);
+  this->scales.reserve(count);
+  this->parents.reserve(count);
+  this->flags.reserve(count);
+  this->worldMatrices.reserve(count);
+  this->order.reserve(count);
+}
+
+uint32_t TransformHierarchy::create(uint32_t parent) {
+  if (parent != kNone && parent >= size()) {
+    fprintf(stderr, "Error: transform parent %u does not exist\n", parent);
+    parent = kNone;
+  }
+
+  uint32_t node = static_cast<uint32_t>(size());
+  this->positions.emplace_back(0.0f);
+  this->rotations.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+  this->scales.emplace_back(1.0f);
+  this->parents.push_back(parent);
+  this->flags.push_back(LocalDirty);
+  this->worldMatrices.emplace_back(1.0f);
+
+  this->structureChanged = true;
+  this->anyDirty = true;
+  return node;
+}
+
+bool TransformHierarchy::setParent(uint32_t node, uint32_t parent) {
+  if (parent != kNone) {
+    if (parent >= size()) {
+      fprintf(stderr, "Error: transform parent %u does not exist\n", parent);
+      return false;
+    }
+
+    for (uint32_t ancestor = parent; ancestor != kNone; ancestor = this->parents[ancestor]) {
+      if (ancestor == node) {
+        fprintf(stderr, "Error: transform %u cannot become a child of its own subtree\n", node);
+        return false;
+      }
+    }
+  }
+
+  this->parents[node] = parent;
+  this->structureChanged = true;
+  markDirty(node);
+  return true;
+}
+
+void TransformHierarchy::setPosition(uint32_t node, const glm::vec3 &position) {
+  this->positions[node] = position;
+  markDirty(node);
+}
+
+void TransformHierarchy::setRotation(uint32_t node, const glm::quat &rotation) {
+  this->rotations[node] = rotation;
+  markDirty(node);
+}
+
+void TransformHierarchy::setScale(uint32_t node, const glm::vec3 &scale) {
+  this->scales[node] = scale;
+  markDirty(node);
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation,
+                                  const glm::vec3 &scale) {
+  this->positions[node] = position;
+  this->rotations[node] = rotation;
+  this->scales[node] = scale;
+  markDirty(node);
+}
+
+void TransformHierarchy::update(JobSystem *jobs) {
+  if (!this->anyDirty) {
+    // Nothing moved, but the changes reported by hasChanged() belong to the previous update
+    if (this->updatedCount > 0) {
+      std::fill(this->flags.begin(), this->flags.end(), 0);
+      this->updatedCount = 0;
+    }
+    return;
+  }
+
+  if (this->structureChanged) {
+    sortLevels();
+  }
+
+  std::atomic<size_t> updated(0);
+  for (size_t level = 0; level + 1 < this->levelOffsets.size(); level++) {
+    const uint32_t *nodes = this->order.data() + this->levelOffsets[level];
+    size_t count = this->levelOffsets[level + 1] - this->levelOffsets[level];
+
+    // Levels are processed one after the other, every parent is done before its children are read
+    if (jobs && count > kGrain) {
+      jobs->parallelFor(count, kGrain, [this, nodes, &updated](size_t begin, size_t end) {
+        updated.fetch_add(updateRange(nodes + begin, end - begin), std::memory_order_relaxed);
+      });
+    } else {
+      updated.fetch_add(updateRange(nodes, count), std::memory_order_relaxed);
+    }
+  }
+
+  this->updatedCount = updated.load();
+  this->anyDirty = false;
+}
+
+glm::mat4 TransformHierarchy::ComposeMatrix(const glm::vec3 &position, const glm::quat &rotation,
+                                            const glm::vec3 &scale) {
+  glm::mat3 basis = glm::mat3_cast(rotation);
+  glm::mat4 matrix;
+  matrix[0] = glm::vec4(basis[0] * scale.x, 0.0f);
+  matrix[1] = glm::vec4(basis[1] * scale.y, 0.0f);
+  matrix[2] = glm::vec4(basis[2] * scale.z, 0.0f);
+  matrix[3] = glm::vec4(position, 1.0f);
+  return matrix;
+}
+
+void TransformHierarchy::markDirty(uint32_t node) {
+  this->flags[node] |= LocalDirty;
+  this->anyDirty = true;
+}
+
+void TransformHierarchy::sortLevels() {
+  size_t count = size();
+  const uint32_t unknown = 0xFFFFFFFFu;
+  std::vector<uint32_t> depths(count, unknown);
+  std::vector<uint32_t> path;
+  uint32_t maxDepth = 0;
+
+  // Parents may have larger ids after setParent, so walk up to the first node with a known depth
+  for (uint32_t node = 0; node < count; node++) {
+    uint32_t current = node;
+    while (current != kNone && depths[current] == unknown) {
+      path.push_back(current);
+      current = this->parents[current];
+    }
+
+    uint32_t depth = current == kNone ? 0 : depths[current] + 1;
+    while (!path.empty()) {
+      depths[path.back()] = depth++;
+      path.pop_back();
+    }
+    maxDepth = std::max(maxDepth, depths[node]);
+  }
+
+  // Counting sort by depth keeps ids ascending within a level, which keeps the memory access mostly linear
+  this->levelOffsets.assign(maxDepth + 2, 0);
+  for (uint32_t node = 0; node < count; node++) {
+    this->levelOffsets[depths[node] + 1]++;
+  }
+  for (size_t level = 1; level < this->levelOffsets.size(); level++) {
+    this->levelOffsets[level] += this->levelOffsets[level - 1];
+  }
+
+  std::vector<size_t> cursor(this->levelOffsets.begin(), this->levelOffsets.end() - 1);
+  this->order.resize(count);
+  for (uint32_t node = 0; node < count; node++) {
+    this->order[cursor[depths[node]]++] = node;
+  }
+
+  this->structureChanged = false;
+}
+
+size_t TransformHierarchy::updateRange(const uint32_t *nodes, size_t count) {
+  size_t updated = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t node = nodes[i];
+    uint32_t parent = this->parents[node];
+    bool parentChanged = parent != kNone && (this->flags[parent] & WorldChanged);
+    if (!(this->flags[node] & LocalDirty) && !parentChanged) {
+      this->flags[node] = 0;
+      continue;
+    }
+
+    glm::mat4 local = ComposeMatrix(this->positions[node], this->rotations[node], this->scales[node]);
+    this->worldMatrices[node] = parent == kNone ? local : this->worldMatrices[parent] * local;
+    this->flags[node] = WorldChanged;
+    updated++;
+  }
+  return updated;
+}
+
+}
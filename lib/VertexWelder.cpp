@@ -0,0 +1,286 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cg/JobSystem.h"
+#include "cg/VertexWelder.h"
+
+namespace cg {
+
+namespace {
+
+const uint32_t kEmpty = 0xFFFFFFFFu;
+const size_t kGrain = 16384;
+const size_t kWords = sizeof(cg::Vertex) / sizeof(uint32_t);
+
+static_assert(sizeof(cg::Vertex) % sizeof(uint32_t) == 0, "vertices are hashed as 32-bit words");
+
+inline uint32_t Rotate(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+/// MurmurHash3's block mixing over the words of a key.
+class Hasher {
+ private:
+  uint32_t hash = 0;
+
+ public:
+  void add(uint32_t word) {
+    word *= 0xcc9e2d51u;
+    word = Rotate(word, 15);
+    word *= 0x1b873593u;
+    hash ^= word;
+    hash = Rotate(hash, 13);
+    hash = hash * 5 + 0xe6546b64u;
+  }
+
+  uint32_t finish() const {
+    uint32_t result = hash ^ static_cast<uint32_t>(kWords * sizeof(uint32_t));
+    result ^= result >> 16;
+    result *= 0x85ebca6bu;
+    result ^= result >> 13;
+    result *= 0xc2b2ae35u;
+    result ^= result >> 16;
+    return result;
+  }
+};
+
+/// Compares vertices bit for bit, the way meshopt_generateVertexRemap does.
+class ExactKey {
+ public:
+  uint32_t hash(const cg::Vertex &vertex) const {
+    uint32_t words[kWords];
+    std::memcpy(words, &vertex, sizeof(words));
+    Hasher hasher;
+    for (uint32_t word : words) {
+      hasher.add(word);
+    }
+    return hasher.finish();
+  }
+
+  bool equal(const cg::Vertex &a, const cg::Vertex &b) const {
+    return std::memcmp(&a, &b, sizeof(cg::Vertex)) == 0;
+  }
+};
+
+/// Compares the grid cells the attributes fall into.
+class QuantizedKey {
+ private:
+  double scale;
+
+ public:
+  explicit QuantizedKey(float epsilon) : scale(1.0 / epsilon) {}
+
+  int64_t quantize(float value) const {
+    // NaN and values too large for the grid are compared by their bits
+    double cell = std::floor(value * scale + 0.5);
+    if (!(std::fabs(cell) < 4.0e18)) {
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return static_cast<int64_t>(bits) ^ INT64_MIN;
+    }
+    return static_cast<int64_t>(cell);
+  }
+
+  uint32_t hash(const cg::Vertex &vertex) const {
+    float values[kWords];
+    std::memcpy(values, &vertex, sizeof(values));
+    Hasher hasher;
+    for (float value : values) {
+      uint64_t cell = static_cast<uint64_t>(quantize(value));
+      hasher.add(static_cast<uint32_t>(cell));
+      hasher.add(static_cast<uint32_t>(cell >> 32));
+    }
+    return hasher.finish();
+  }
+
+  bool equal(const cg::Vertex &a, const cg::Vertex &b) const {
+    float first[kWords];
+    float second[kWords];
+    std::memcpy(first, &a, sizeof(first));
+    std::memcpy(second, &b, sizeof(second));
+    for (size_t i = 0; i < kWords; ++i) {
+      if (quantize(first[i]) != quantize(second[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+void AtomicMin(std::atomic<uint32_t> &target, uint32_t value) {
+  uint32_t current = target.load(std::memory_order_relaxed);
+  while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+template<typename Key>
+size_t Weld(const Key &key, unsigned int *remap, cg::Vertex *uniqueVertices, const unsigned int *indices,
+            size_t indexCount, const cg::Vertex *vertices, size_t vertexCount) {
+  JobSystem &jobs = JobSystem::Get();
+  auto indexAt = [indices](size_t position) {
+    return indices ? indices[position] : static_cast<unsigned int>(position);
+  };
+
+  // The first position in the index buffer that refers to each vertex, kEmpty for unreferenced vertices
+  std::unique_ptr<std::atomic<uint32_t>[]> firstUse(new std::atomic<uint32_t>[vertexCount]);
+  jobs.parallelFor(vertexCount, kGrain, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; ++v) {
+      firstUse[v].store(kEmpty, std::memory_order_relaxed);
+    }
+  });
+  jobs.parallelFor(indexCount, kGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      AtomicMin(firstUse[indexAt(i)], static_cast<uint32_t>(i));
+    }
+  });
+
+  // At most half full, so probe sequences stay short
+  size_t tableSize = 1;
+  while (tableSize < vertexCount * 2) {
+    tableSize *= 2;
+  }
+  size_t mask = tableSize - 1;
+  std::unique_ptr<std::atomic<uint32_t>[]> table(new std::atomic<uint32_t>[tableSize]);
+  jobs.parallelFor(tableSize, kGrain, [&](size_t begin, size_t end) {
+    for (size_t s = begin; s < end; ++s) {
+      table[s].store(kEmpty, std::memory_order_relaxed);
+    }
+  });
+
+  // Every slot ends up with the copy of its vertex that is used first. A slot only ever changes from empty to a
+  // vertex and then between equal vertices, so a concurrent probe comparing against it sees a valid key either way.
+  std::vector<uint32_t> slots(vertexCount);
+  jobs.parallelFor(vertexCount, kGrain, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; ++v) {
+      uint32_t use = firstUse[v].load(std::memory_order_relaxed);
+      if (use == kEmpty) {
+        slots[v] = kEmpty;
+        continue;
+      }
+
+      size_t slot = key.hash(vertices[v]) & mask;
+      uint32_t current = table[slot].load(std::memory_order_relaxed);
+      for (;;) {
+        if (current == kEmpty) {
+          if (table[slot].compare_exchange_weak(current, static_cast<uint32_t>(v), std::memory_order_relaxed)) {
+            break;
+          }
+          continue;
+        }
+        if (!key.equal(vertices[current], vertices[v])) {
+          slot = (slot + 1) & mask;
+          current = table[slot].load(std::memory_order_relaxed);
+          continue;
+        }
+        while (use < firstUse[current].load(std::memory_order_relaxed)
+            && !table[slot].compare_exchange_weak(current, static_cast<uint32_t>(v), std::memory_order_relaxed)) {
+        }
+        break;
+      }
+      slots[v] = static_cast<uint32_t>(slot);
+    }
+  });
+
+  // Replace the slots by the first copy of each vertex
+  std::vector<uint32_t> &first = slots;
+  jobs.parallelFor(vertexCount, kGrain, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; ++v) {
+      if (first[v] != kEmpty) {
+        first[v] = table[first[v]].load(std::memory_order_relaxed);
+      }
+    }
+  });
+  table.reset();
+
+  // Unique vertices are numbered by the position of their first use, like meshopt does: count the first uses per
+  // block of positions, then number them from each block's offset
+  const size_t blockSize = kGrain * 4;
+  size_t blockCount = (indexCount + blockSize - 1) / blockSize;
+  std::vector<size_t> offsets(blockCount + 1, 0);
+  auto isFirstUse = [&](size_t position) {
+    unsigned int v = indexAt(position);
+    return first[v] == v && firstUse[v].load(std::memory_order_relaxed) == position;
+  };
+  jobs.parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; ++block) {
+      size_t count = 0;
+      for (size_t i = block * blockSize; i < std::min((block + 1) * blockSize, indexCount); ++i) {
+        count += isFirstUse(i) ? 1 : 0;
+      }
+      offsets[block + 1] = count;
+    }
+  });
+  for (size_t block = 0; block < blockCount; ++block) {
+    offsets[block + 1] += offsets[block];
+  }
+
+  jobs.parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; ++block) {
+      unsigned int next = static_cast<unsigned int>(offsets[block]);
+      for (size_t i = block * blockSize; i < std::min((block + 1) * blockSize, indexCount); ++i) {
+        if (!isFirstUse(i)) {
+          continue;
+        }
+        unsigned int v = indexAt(i);
+        remap[v] = next;
+        if (uniqueVertices) {
+          uniqueVertices[next] = vertices[v];
+        }
+        next++;
+      }
+    }
+  });
+
+  // The first copies hold their number already, the other copies take it from them
+  jobs.parallelFor(vertexCount, kGrain, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; ++v) {
+      if (first[v] == kEmpty) {
+        remap[v] = kEmpty;
+      } else if (first[v] != v) {
+        remap[v] = remap[first[v]];
+      }
+    }
+  });
+  return offsets[blockCount];
+}
+
+}
+
+size_t WeldVertices(unsigned int *remap, cg::Vertex *uniqueVertices, const unsigned int *indices, size_t indexCount,
+                    const cg::Vertex *vertices, size_t vertexCount, float epsilon) {
+  if (epsilon > 0.0f) {
+    return Weld(QuantizedKey(epsilon), remap, uniqueVertices, indices, indexCount, vertices, vertexCount);
+  }
+  return Weld(ExactKey(), remap, uniqueVertices, indices, indexCount, vertices, vertexCount);
+}
+
+}
@@ -0,0 +1,169 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "cg/common/FileWatcher.h"
+
+namespace cg {
+
+FileWatcher::FileWatcher() : running(true) {
+#ifdef __linux__
+  this->inotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (this->inotifyHandle < 0 || pipe(this->wakeHandles) != 0) {
+    fprintf(stderr, "Error: could not initialize inotify, file watching is disabled\n");
+    this->running = false;
+    return;
+  }
+#endif
+  this->thread = std::thread(&FileWatcher::threadMain, this);
+}
+
+FileWatcher::~FileWatcher() {
+  this->running = false;
+#ifdef __linux__
+  if (this->wakeHandles[1] >= 0) {
+    char wake = 0;
+    ssize_t written = write(this->wakeHandles[1], &wake, 1);
+    (void) written;
+  }
+#endif
+
+  if (this->thread.joinable()) {
+    this->thread.join();
+  }
+
+#ifdef __linux__
+  if (this->inotifyHandle >= 0) close(this->inotifyHandle);
+  if (this->wakeHandles[0] >= 0) close(this->wakeHandles[0]);
+  if (this->wakeHandles[1] >= 0) close(this->wakeHandles[1]);
+#endif
+}
+
+std::string FileWatcher::watch(const std::string &path) {
+  std::string canonical = CanonicalPath(path);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->watched.insert(canonical).second) {
+    return canonical;
+  }
+
+#ifdef __linux__
+  std::string::size_type separator = canonical.find_last_of('/');
+  std::string directory = separator == std::string::npos ? "." : canonical.substr(0, separator);
+  if (this->inotifyHandle >= 0 && this->watchedDirectories.insert(directory).second) {
+    int descriptor = inotify_add_watch(this->inotifyHandle, directory.c_str(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (descriptor < 0) {
+      fprintf(stderr, "Error: could not watch directory '%s'\n", directory.c_str());
+    } else {
+      this->directories[descriptor] = directory;
+    }
+  }
+#else
+  struct stat info;
+  this->modificationTimes[canonical] = stat(canonical.c_str(), &info) == 0 ? (long long) info.st_mtime : 0;
+#endif
+
+  return canonical;
+}
+
+std::vector<std::string> FileWatcher::pollChanges() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  std::vector<std::string> result(this->changed.begin(), this->changed.end());
+  this->changed.clear();
+  return result;
+}
+
+std::string FileWatcher::CanonicalPath(const std::string &path) {
+#ifdef _WIN32
+  char resolved[_MAX_PATH];
+  if (_fullpath(resolved, path.c_str(), _MAX_PATH)) {
+    return std::string(resolved);
+  }
+#else
+  char resolved[PATH_MAX];
+  if (realpath(path.c_str(), resolved)) {
+    return std::string(resolved);
+  }
+#endif
+  return path;
+}
+
+void FileWatcher::threadMain() {
+#ifdef __linux__
+  alignas(struct inotify_event) char buffer[4096];
+  pollfd handles[2] = {{this->inotifyHandle, POLLIN, 0}, {this->wakeHandles[0], POLLIN, 0}};
+
+  while (this->running) {
+    if (poll(handles, 2, -1) <= 0 || !this->running) {
+      continue;
+    }
+
+    ssize_t length;
+    while ((length = read(this->inotifyHandle, buffer, sizeof(buffer))) > 0) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      for (char *pointer = buffer; pointer < buffer + length;) {
+        auto *event = reinterpret_cast<struct inotify_event *>(pointer);
+        pointer += sizeof(struct inotify_event) + event->len;
+
+        auto directory = this->directories.find(event->wd);
+        if (directory == this->directories.end() || event->len == 0) {
+          continue;
+        }
+
+        std::string file = directory->second + "/" + event->name;
+        if (this->watched.count(file)) {
+          this->changed.insert(file);
+        }
+      }
+    }
+  }
+#else
+  while (this->running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto &file : this->modificationTimes) {
+      struct stat info;
+      if (stat(file.first.c_str(), &info) == 0 && (long long) info.st_mtime != file.second) {
+        file.second = (long long) info.st_mtime;
+        this->changed.insert(file.first);
+      }
+    }
+  }
+#endif
+}
+
+}
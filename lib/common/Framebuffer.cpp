@@ -0,0 +1,137 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <cstdio>
+#include <iostream>
+
+#include "cg/common/Framebuffer.h"
+
+namespace cg {
+
+Framebuffer::Framebuffer(int width, int height) : width(width), height(height) {
+  glCreateFramebuffers(1, &this->handle);
+  verify();
+#ifdef CG_GL_DEBUG
+  std::cout << "<Framebuffer>: Created framebuffer with id " << this->handle << "\n";
+#endif
+  allocate();
+}
+
+Framebuffer::~Framebuffer() {
+  glDeleteRenderbuffers(1, &this->colorBuffer);
+  glDeleteRenderbuffers(1, &this->depthBuffer);
+  glDeleteFramebuffers(1, &this->handle);
+}
+
+void Framebuffer::resize(int width, int height) {
+  if (width == this->width && height == this->height) {
+    return;
+  }
+
+  this->width = width;
+  this->height = height;
+  allocate();
+}
+
+bool Framebuffer::isComplete() {
+  return glCheckNamedFramebufferStatus(this->handle, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+int Framebuffer::getWidth() const {
+  return this->width;
+}
+
+int Framebuffer::getHeight() const {
+  return this->height;
+}
+
+void Framebuffer::bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, this->handle);
+  glViewport(0, 0, this->width, this->height);
+}
+
+void Framebuffer::unbind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::readPixels(std::vector<unsigned char> &pixels) {
+  pixels.resize(static_cast<size_t>(this->width) * this->height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glNamedFramebufferReadBuffer(this->handle, GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, this->handle);
+  glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+bool Framebuffer::WritePPM(const std::string &path, int width, int height, const std::vector<unsigned char> &pixels) {
+  if (pixels.size() < static_cast<size_t>(width) * height * 4) {
+    fprintf(stderr, "Error: not enough pixels for a %dx%d image\n", width, height);
+    return false;
+  }
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Error: could not open image file '%s'\n", path.c_str());
+    return false;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+  for (int y = height - 1; y >= 0; y--) {
+    const unsigned char *source = pixels.data() + static_cast<size_t>(y) * width * 4;
+    for (int x = 0; x < width; x++) {
+      row[x * 3 + 0] = source[x * 4 + 0];
+      row[x * 3 + 1] = source[x * 4 + 1];
+      row[x * 3 + 2] = source[x * 4 + 2];
+    }
+    fwrite(row.data(), 1, row.size(), file);
+  }
+
+  bool written = ferror(file) == 0;
+  fclose(file);
+  return written;
+}
+
+void Framebuffer::allocate() {
+  glDeleteRenderbuffers(1, &this->colorBuffer);
+  glDeleteRenderbuffers(1, &this->depthBuffer);
+
+  glCreateRenderbuffers(1, &this->colorBuffer);
+  glNamedRenderbufferStorage(this->colorBuffer, GL_RGBA8, this->width, this->height);
+  glCreateRenderbuffers(1, &this->depthBuffer);
+  glNamedRenderbufferStorage(this->depthBuffer, GL_DEPTH24_STENCIL8, this->width, this->height);
+
+  glNamedFramebufferRenderbuffer(this->handle, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+  glNamedFramebufferRenderbuffer(this->handle, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+  glNamedFramebufferDrawBuffer(this->handle, GL_COLOR_ATTACHMENT0);
+
+  // RGBA8 color plus 24 bit depth and 8 bit stencil
+  this->memory.resize(0, static_cast<size_t>(this->width) * this->height * 8);
+
+  if (!isComplete()) {
+    fprintf(stderr, "Error: framebuffer %u (%dx%d) is incomplete\n", this->handle, this->width, this->height);
+  }
+}
+
+}
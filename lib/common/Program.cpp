@@ -24,6 +24,10 @@
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
 
 #include "cg/common/Program.h"
 
@@ -42,6 +46,7 @@ ShaderProgram::~ShaderProgram() {
 
 void ShaderProgram::attachShader(const Shader *shader) const {
   glAttachShader(this->programHandle, shader->getHandle());
+  this->stageBits |= StageBit(shader->getShaderType());
 }
 
 void ShaderProgram::detachShader(const Shader *shader) const {
@@ -49,7 +54,11 @@ void ShaderProgram::detachShader(const Shader *shader) const {
 }
 
 const bool ShaderProgram::linkProgram() {
-  glLinkProgram(this->programHandle);
+  this->uniformLocations.clear();
+  if (!this->linkStarted) {
+    glLinkProgram(this->programHandle);
+  }
+  this->linkStarted = false;
 
   int status = 0;
   glGetProgramiv(this->programHandle, GL_LINK_STATUS, &status);
@@ -69,9 +78,96 @@ const bool ShaderProgram::linkProgram() {
     this->linked = true;
   }
 
+  trackBinarySize();
+  return this->linked;
+}
+
+void ShaderProgram::beginLink() {
+  glLinkProgram(this->programHandle);
+  this->linkStarted = true;
+}
+
+const bool ShaderProgram::isLinked() const {
+  return this->linked;
+}
+
+void ShaderProgram::setBinaryRetrievable(bool retrievable) {
+  glProgramParameteri(this->programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, retrievable ? GL_TRUE : GL_FALSE);
+}
+
+const bool ShaderProgram::loadProgramBinary(unsigned int format, const void *binary, int length,
+                                           unsigned int stageBits) {
+  glProgramBinary(this->programHandle, format, binary, length);
+  this->stageBits = stageBits;
+  this->uniformLocations.clear();
+
+  int status = 0;
+  glGetProgramiv(this->programHandle, GL_LINK_STATUS, &status);
+  this->linked = status != GL_FALSE;
+  trackBinarySize();
   return this->linked;
 }
 
+std::vector<char> ShaderProgram::getProgramBinary(unsigned int &format) const {
+  std::vector<char> binary;
+  format = 0;
+  if (!this->linked) {
+    return binary;
+  }
+
+  int length = 0;
+  glGetProgramiv(this->programHandle, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return binary;
+  }
+
+  binary.resize(length);
+  GLenum binaryFormat = 0;
+  glGetProgramBinary(this->programHandle, length, &length, &binaryFormat, &binary[0]);
+  binary.resize(length);
+  format = binaryFormat;
+  return binary;
+}
+
+void ShaderProgram::swap(ShaderProgram &other) {
+  std::swap(this->programHandle, other.programHandle);
+  std::swap(this->linked, other.linked);
+  std::swap(this->linkStarted, other.linkStarted);
+  std::swap(this->stageBits, other.stageBits);
+  this->uniformLocations.swap(other.uniformLocations);
+
+  // The names stay with the objects, only the sizes follow the programs
+  trackBinarySize();
+  other.trackBinarySize();
+}
+
+void ShaderProgram::setAssetName(const std::string &name) {
+  this->memory.rename(name);
+}
+
+void ShaderProgram::trackBinarySize() {
+  // The driver does not report what a program occupies, its binary is the closest estimate
+  int length = 0;
+  if (this->linked) {
+    glGetProgramiv(this->programHandle, GL_PROGRAM_BINARY_LENGTH, &length);
+  }
+  this->memory.resize(0, static_cast<size_t>(std::max(length, 0)));
+}
+
+void ShaderProgram::setSeparable(bool separable) {
+  glProgramParameteri(this->programHandle, GL_PROGRAM_SEPARABLE, separable ? GL_TRUE : GL_FALSE);
+}
+
+const bool ShaderProgram::isSeparable() const {
+  int separable = GL_FALSE;
+  glGetProgramiv(this->programHandle, GL_PROGRAM_SEPARABLE, &separable);
+  return separable != GL_FALSE;
+}
+
+const unsigned int ShaderProgram::getStageBits() const {
+  return this->stageBits;
+}
+
 void ShaderProgram::bindAttributeLocation(unsigned int attributeIndex, const std::string &name) {
   glBindAttribLocation(this->programHandle, attributeIndex, name.c_str());
 }
@@ -80,96 +176,237 @@ void ShaderProgram::bindFragDataLocation(unsigned int colorNumber, const std::st
   glBindFragDataLocation(this->programHandle, colorNumber, name.c_str());
 }
 
+int ShaderProgram::getUniformLocation(const char *name) {
+  for (const UniformLocation &uniform : this->uniformLocations) {
+    if (std::strcmp(uniform.name.c_str(), name) == 0) {
+      return uniform.location;
+    }
+  }
+
+  int location = glGetUniformLocation(this->programHandle, name);
+  this->uniformLocations.push_back(UniformLocation{name, location});
+  return location;
+}
+
+void ShaderProgram::setUniform1f(const char *name, float x) {
+  glProgramUniform1f(this->programHandle, this->getUniformLocation(name), x);
+}
+
+void ShaderProgram::setUniform2f(const char *name, glm::vec2 vec2) {
+  glProgramUniform2fv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+}
+
+void ShaderProgram::setUniform3f(const char *name, glm::vec3 vec3) {
+  glProgramUniform3fv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+}
+
+void ShaderProgram::setUniform4f(const char *name, glm::vec4 vec4) {
+  glProgramUniform4fv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+}
+
+void ShaderProgram::setUniform1i(const char *name, int x) {
+  glProgramUniform1i(this->programHandle, this->getUniformLocation(name), x);
+}
+
+void ShaderProgram::setUniform2i(const char *name, glm::ivec2 vec2) {
+  glProgramUniform2iv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+}
+
+void ShaderProgram::setUniform3i(const char *name, glm::ivec3 vec3) {
+  glProgramUniform3iv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+}
+
+void ShaderProgram::setUniform4i(const char *name, glm::ivec4 vec4) {
+  glProgramUniform4iv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+}
+
+void ShaderProgram::setUniform1u(const char *name, unsigned int x) {
+  glProgramUniform1ui(this->programHandle, this->getUniformLocation(name), x);
+}
+
+void ShaderProgram::setUniform2u(const char *name, glm::uvec2 vec2) {
+  glProgramUniform2uiv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+}
+
+void ShaderProgram::setUniform3u(const char *name, glm::uvec3 vec3) {
+  glProgramUniform3uiv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+}
+
+void ShaderProgram::setUniform4u(const char *name, glm::uvec4 vec4) {
+  glProgramUniform4uiv(this->programHandle, this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+}
+
+void ShaderProgram::setUniformMat2f(const char *name, glm::mat2 mat2) {
+  glProgramUniformMatrix2fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2));
+}
+
+void ShaderProgram::setUniformMat3f(const char *name, glm::mat3 mat3) {
+  glProgramUniformMatrix3fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3));
+}
+
+void ShaderProgram::setUniformMat4f(const char *name, glm::mat4 mat4) {
+  glProgramUniformMatrix4fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4));
+}
+
+void ShaderProgram::setUniformMat2x3f(const char *name, glm::mat2x3 mat2x3) {
+  glProgramUniformMatrix2x3fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2x3));
+}
+
+void ShaderProgram::setUniformMat3x2f(const char *name, glm::mat3x2 mat3x2) {
+  glProgramUniformMatrix3x2fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3x2));
+}
+
+void ShaderProgram::setUniformMat2x4f(const char *name, glm::mat2x4 mat2x4) {
+  glProgramUniformMatrix2x4fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2x4));
+}
+
+void ShaderProgram::setUniformMat4x2f(const char *name, glm::mat4x2 mat4x2) {
+  glProgramUniformMatrix4x2fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4x2));
+}
+
+void ShaderProgram::setUniformMat3x4f(const char *name, glm::mat3x4 mat3x4) {
+  glProgramUniformMatrix3x4fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3x4));
+}
+
+void ShaderProgram::setUniformMat4x3f(const char *name, glm::mat4x3 mat4x3) {
+  glProgramUniformMatrix4x3fv(this->programHandle, this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4x3));
+}
+
 int ShaderProgram::getUniformLocation(const std::string &name) {
-  return glGetUniformLocation(this->programHandle, name.c_str());
+  return this->getUniformLocation(name.c_str());
 }
 
 void ShaderProgram::setUniform1f(const std::string &name, float x) {
-  glUniform1f(this->getUniformLocation(name), x);
+  this->setUniform1f(name.c_str(), x);
 }
 
 void ShaderProgram::setUniform2f(const std::string &name, glm::vec2 vec2) {
-  glUniform2fv(this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+  this->setUniform2f(name.c_str(), vec2);
 }
 
 void ShaderProgram::setUniform3f(const std::string &name, glm::vec3 vec3) {
-  glUniform3fv(this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+  this->setUniform3f(name.c_str(), vec3);
 }
 
 void ShaderProgram::setUniform4f(const std::string &name, glm::vec4 vec4) {
-  glUniform4fv(this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+  this->setUniform4f(name.c_str(), vec4);
 }
 
 void ShaderProgram::setUniform1i(const std::string &name, int x) {
-  glUniform1i(this->getUniformLocation(name), x);
+  this->setUniform1i(name.c_str(), x);
 }
 
 void ShaderProgram::setUniform2i(const std::string &name, glm::ivec2 vec2) {
-  glUniform2iv(this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+  this->setUniform2i(name.c_str(), vec2);
 }
 
 void ShaderProgram::setUniform3i(const std::string &name, glm::ivec3 vec3) {
-  glUniform3iv(this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+  this->setUniform3i(name.c_str(), vec3);
 }
 
 void ShaderProgram::setUniform4i(const std::string &name, glm::ivec4 vec4) {
-  glUniform4iv(this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+  this->setUniform4i(name.c_str(), vec4);
 }
 
 void ShaderProgram::setUniform1u(const std::string &name, unsigned int x) {
-  glUniform1ui(this->getUniformLocation(name), x);
+  this->setUniform1u(name.c_str(), x);
 }
 
 void ShaderProgram::setUniform2u(const std::string &name, glm::uvec2 vec2) {
-  glUniform2uiv(this->getUniformLocation(name), 1, glm::value_ptr(vec2));
+  this->setUniform2u(name.c_str(), vec2);
 }
 
 void ShaderProgram::setUniform3u(const std::string &name, glm::uvec3 vec3) {
-  glUniform3uiv(this->getUniformLocation(name), 1, glm::value_ptr(vec3));
+  this->setUniform3u(name.c_str(), vec3);
 }
 
 void ShaderProgram::setUniform4u(const std::string &name, glm::uvec4 vec4) {
-  glUniform4uiv(this->getUniformLocation(name), 1, glm::value_ptr(vec4));
+  this->setUniform4u(name.c_str(), vec4);
 }
 
 void ShaderProgram::setUniformMat2f(const std::string &name, glm::mat2 mat2) {
-  glUniformMatrix2fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2));
+  this->setUniformMat2f(name.c_str(), mat2);
 }
 
 void ShaderProgram::setUniformMat3f(const std::string &name, glm::mat3 mat3) {
-  glUniformMatrix3fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3));
+  this->setUniformMat3f(name.c_str(), mat3);
 }
 
 void ShaderProgram::setUniformMat4f(const std::string &name, glm::mat4 mat4) {
-  glUniformMatrix4fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4));
+  this->setUniformMat4f(name.c_str(), mat4);
 }
 
 void ShaderProgram::setUniformMat2x3f(const std::string &name, glm::mat2x3 mat2x3) {
-  glUniformMatrix2x3fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2x3));
+  this->setUniformMat2x3f(name.c_str(), mat2x3);
 }
 
 void ShaderProgram::setUniformMat3x2f(const std::string &name, glm::mat3x2 mat3x2) {
-  glUniformMatrix3x2fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3x2));
+  this->setUniformMat3x2f(name.c_str(), mat3x2);
 }
 
 void ShaderProgram::setUniformMat2x4f(const std::string &name, glm::mat2x4 mat2x4) {
-  glUniformMatrix2x4fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat2x4));
+  this->setUniformMat2x4f(name.c_str(), mat2x4);
 }
 
 void ShaderProgram::setUniformMat4x2f(const std::string &name, glm::mat4x2 mat4x2) {
-  glUniformMatrix4x2fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4x2));
+  this->setUniformMat4x2f(name.c_str(), mat4x2);
 }
 
 void ShaderProgram::setUniformMat3x4f(const std::string &name, glm::mat3x4 mat3x4) {
-  glUniformMatrix3x4fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat3x4));
+  this->setUniformMat3x4f(name.c_str(), mat3x4);
 }
 
 void ShaderProgram::setUniformMat4x3f(const std::string &name, glm::mat4x3 mat4x3) {
-  glUniformMatrix4x3fv(this->getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4x3));
+  this->setUniformMat4x3f(name.c_str(), mat4x3);
 }
 
 const unsigned int ShaderProgram::getHandle() const {
   return this->programHandle;
 }
 
+ShaderProgram *ShaderProgram::FromSources(const std::vector<ShaderStageSource> &stages,
+                                          bool retrievable,
+                                          bool separable) {
+  std::vector<std::unique_ptr<Shader>> shaders;
+  for (const ShaderStageSource &stage : stages) {
+    std::unique_ptr<Shader> shader(new Shader(stage.type));
+    shader->setShaderSource(stage.source);
+    if (!shader->compileShader()) {
+      return nullptr;
+    }
+    shaders.push_back(std::move(shader));
+  }
+
+  auto *program = new ShaderProgram();
+  for (const std::unique_ptr<Shader> &shader : shaders) {
+    program->attachShader(shader.get());
+  }
+
+  program->setBinaryRetrievable(retrievable);
+  program->setSeparable(separable);
+  bool linked = program->linkProgram();
+  for (const std::unique_ptr<Shader> &shader : shaders) {
+    program->detachShader(shader.get());
+  }
+
+  if (!linked) {
+    delete program;
+    return nullptr;
+  }
+
+  return program;
+}
+
+unsigned int ShaderProgram::StageBit(ShaderType type) {
+  switch (type) {
+    case ShaderType::VertexShader:return GL_VERTEX_SHADER_BIT;
+    case ShaderType::TessellationControlShader:return GL_TESS_CONTROL_SHADER_BIT;
+    case ShaderType::TessellationEvaluationShader:return GL_TESS_EVALUATION_SHADER_BIT;
+    case ShaderType::GeometryShader:return GL_GEOMETRY_SHADER_BIT;
+    case ShaderType::FragmentShader:return GL_FRAGMENT_SHADER_BIT;
+    case ShaderType::ComputeShader:return GL_COMPUTE_SHADER_BIT;
+  }
+  return 0;
+}
+
 }
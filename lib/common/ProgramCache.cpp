@@ -0,0 +1,245 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "cg/common/ProgramCache.h"
+
+namespace cg {
+
+namespace {
+
+const char kCacheMagic[4] = {'R', 'P', 'B', 'C'};
+const uint32_t kCacheVersion = 2;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t keyLength;
+  uint32_t format;
+  uint32_t stageBits;
+  uint32_t binaryLength;
+};
+
+// 64-bit FNV-1a, good enough to key cache files. The file repeats the key, which only catches a file that was renamed
+// or copied, two programs whose identities hash alike would share a file; at 64 bits that is not a practical concern.
+void hashBytes(uint64_t &hash, const void *data, size_t length) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+void hashString(uint64_t &hash, const std::string &string) {
+  uint64_t length = string.size();
+  hashBytes(hash, &length, sizeof(length));
+  hashBytes(hash, string.data(), string.size());
+}
+
+std::string glString(GLenum name) {
+  const auto *string = reinterpret_cast<const char *>(glGetString(name));
+  return string ? std::string(string) : std::string();
+}
+
+/// Numbers the temporary files of this process, so two threads storing the same key never write the same file
+std::atomic<unsigned int> temporaryCounter{0};
+
+void makeDirectory(const std::string &path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0755);
+#endif
+}
+
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string &directory) : directory(directory) {
+  int formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  this->supported = formats > 0;
+
+  this->driverIdentity = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+
+  if (this->supported) {
+    makeDirectory(this->directory);
+  }
+}
+
+bool ProgramBinaryCache::isSupported() const {
+  return this->supported;
+}
+
+std::string ProgramBinaryCache::computeKey(const std::vector<ShaderStageSource> &stages,
+                                           const std::string &defines,
+                                           bool separable) const {
+  uint64_t hash = 14695981039346656037ull;
+  hashString(hash, this->driverIdentity);
+  hashString(hash, defines);
+  hashBytes(hash, &separable, sizeof(separable));
+  for (const ShaderStageSource &stage : stages) {
+    auto type = static_cast<uint32_t>(stage.type);
+    hashBytes(hash, &type, sizeof(type));
+    hashString(hash, stage.source);
+  }
+
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+  return std::string(key);
+}
+
+bool ProgramBinaryCache::loadProgram(ShaderProgram *program, const std::string &key) {
+  if (!this->supported) {
+    return false;
+  }
+
+  std::ifstream file(getCachePath(key), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    this->misses++;
+    return false;
+  }
+  uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+  file.seekg(0);
+
+  // The lengths come from disk, a corrupt file must not make us allocate more than it holds
+  CacheHeader header = {};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion
+      || header.keyLength != key.size() || header.binaryLength == 0
+      || fileSize < sizeof(header) + header.keyLength + header.binaryLength) {
+    this->misses++;
+    return false;
+  }
+
+  std::string storedKey(header.keyLength, '\0');
+  file.read(&storedKey[0], header.keyLength);
+  std::vector<char> binary(header.binaryLength);
+  file.read(&binary[0], header.binaryLength);
+  if (!file || storedKey != key) {
+    this->misses++;
+    return false;
+  }
+
+  if (!program->loadProgramBinary(header.format, &binary[0], static_cast<int>(binary.size()), header.stageBits)) {
+    // The driver may reject binaries even when its identity strings did not change, drop the stale file
+    file.close();
+    remove(getCachePath(key).c_str());
+    this->misses++;
+    return false;
+  }
+
+  this->hits++;
+  return true;
+}
+
+bool ProgramBinaryCache::storeProgram(const ShaderProgram *program, const std::string &key) const {
+  if (!this->supported) {
+    return false;
+  }
+
+  unsigned int format = 0;
+  std::vector<char> binary = program->getProgramBinary(format);
+  if (binary.empty()) {
+    return false;
+  }
+
+  // Write to a temporary file first so a crash never leaves a truncated binary behind. The loader thread and the
+  // render thread may store the same key at once, each writes a file of its own and the last rename wins.
+  std::string path = getCachePath(key);
+  std::string temporary = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))
+      + "." + std::to_string(temporaryCounter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      fprintf(stderr, "Error: could not write program binary '%s'\n", temporary.c_str());
+      return false;
+    }
+
+    CacheHeader header = {};
+    memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.keyLength = static_cast<uint32_t>(key.size());
+    header.format = format;
+    header.stageBits = program->getStageBits();
+    header.binaryLength = static_cast<uint32_t>(binary.size());
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(key.data(), key.size());
+    file.write(&binary[0], binary.size());
+    file.close();
+    if (!file) {
+      fprintf(stderr, "Error: could not write program binary '%s'\n", temporary.c_str());
+      remove(temporary.c_str());
+      return false;
+    }
+  }
+
+#ifdef _WIN32
+  // Only POSIX rename replaces an existing file
+  remove(path.c_str());
+#endif
+  if (rename(temporary.c_str(), path.c_str()) != 0) {
+    remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+ShaderProgram *ProgramBinaryCache::createProgram(const std::vector<ShaderStageSource> &stages,
+                                                 const std::string &defines,
+                                                 bool separable) {
+  std::string key = computeKey(stages, defines, separable);
+
+  std::unique_ptr<ShaderProgram> cached(new ShaderProgram());
+  if (loadProgram(cached.get(), key)) {
+    return cached.release();
+  }
+
+  ShaderProgram *program = ShaderProgram::FromSources(stages, this->supported, separable);
+  if (program) {
+    storeProgram(program, key);
+  }
+  return program;
+}
+
+std::string ProgramBinaryCache::getCachePath(const std::string &key) const {
+  return this->directory + "/" + key + ".bin";
+}
+
+}
@@ -0,0 +1,114 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <cstdio>
+#include <vector>
+
+#include "cg/common/ProgramPipeline.h"
+
+namespace cg {
+
+namespace {
+
+const ShaderType kStageTypes[6] = {ShaderType::VertexShader, ShaderType::TessellationControlShader,
+                                   ShaderType::TessellationEvaluationShader, ShaderType::GeometryShader,
+                                   ShaderType::FragmentShader, ShaderType::ComputeShader};
+
+}
+
+ProgramPipeline::ProgramPipeline() {
+  glGenProgramPipelines(1, &this->handle);
+  verify();
+#ifdef CG_GL_DEBUG
+  std::cout << "<ProgramPipeline>: Created program pipeline with id " << this->handle << "\n";
+#endif
+}
+
+ProgramPipeline::~ProgramPipeline() {
+  glDeleteProgramPipelines(1, &this->handle);
+}
+
+void ProgramPipeline::useProgramStages(ShaderProgram *program, unsigned int stageBits) {
+  glUseProgramStages(this->handle, stageBits, program ? program->getHandle() : 0);
+
+  for (int i = 0; i < 6; ++i) {
+    if (stageBits & ShaderProgram::StageBit(kStageTypes[i])) {
+      this->stagePrograms[i] = program;
+      this->stageHandles[i] = program ? program->getHandle() : 0;
+    }
+  }
+}
+
+void ProgramPipeline::useProgram(ShaderProgram *program) {
+  useProgramStages(program, program->getStageBits());
+}
+
+ShaderProgram *ProgramPipeline::getStageProgram(ShaderType type) const {
+  for (int i = 0; i < 6; ++i) {
+    if (kStageTypes[i] == type) {
+      return this->stagePrograms[i];
+    }
+  }
+  return nullptr;
+}
+
+bool ProgramPipeline::validate() {
+  glValidateProgramPipeline(this->handle);
+
+  int status = 0;
+  glGetProgramPipelineiv(this->handle, GL_VALIDATE_STATUS, &status);
+  if (status == GL_FALSE) {
+    int length = 0;
+    glGetProgramPipelineiv(this->handle, GL_INFO_LOG_LENGTH, &length);
+
+    std::vector<char> log(length > 0 ? length : 1);
+    glGetProgramPipelineInfoLog(this->handle, static_cast<int>(log.size()), &length, &log[0]);
+    std::string logString(log.begin(), log.end());
+    fprintf(stderr, "Program pipeline validation log (id = %u): %s", this->handle, logString.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void ProgramPipeline::bind() {
+  // A program bound with glUseProgram takes precedence over the bound pipeline
+  glUseProgram(0);
+
+  for (int i = 0; i < 6; ++i) {
+    ShaderProgram *program = this->stagePrograms[i];
+    if (program && program->getHandle() != this->stageHandles[i]) {
+      glUseProgramStages(this->handle, ShaderProgram::StageBit(kStageTypes[i]), program->getHandle());
+      this->stageHandles[i] = program->getHandle();
+    }
+  }
+  glBindProgramPipeline(this->handle);
+}
+
+void ProgramPipeline::unbind() {
+  glBindProgramPipeline(0);
+}
+
+}
@@ -26,7 +26,6 @@
 #include <vector>
 #include <string>
 #include <iostream>
-#include <sstream>
 #include <fstream>
 
 #include "cg/common/Shader.h"
@@ -44,13 +43,17 @@ Shader::~Shader() {
   glDeleteShader(this->shaderHandle);
 }
 
-void Shader::setShaderSource(const std::string &shaderSource) const {
-  const char *source = shaderSource.c_str();
+void Shader::setShaderSource(const std::string &shaderSource) {
+  this->shaderSource = shaderSource;
+  const char *source = this->shaderSource.c_str();
   glShaderSource(this->shaderHandle, 1, &source, nullptr);
 }
 
 bool Shader::compileShader() {
-  glCompileShader(this->shaderHandle);
+  if (!this->compileStarted) {
+    glCompileShader(this->shaderHandle);
+  }
+  this->compileStarted = false;
 
   int status = 0;
   glGetShaderiv(this->shaderHandle, GL_COMPILE_STATUS, &status);
@@ -74,6 +77,11 @@ bool Shader::compileShader() {
   return this->compiled;
 }
 
+void Shader::beginCompile() {
+  glCompileShader(this->shaderHandle);
+  this->compileStarted = true;
+}
+
 const ShaderType &Shader::getShaderType() const {
   return this->shaderType;
 }
@@ -86,6 +94,10 @@ const std::string Shader::getShaderSource() const {
   return source;
 }
 
+const std::string &Shader::getLocalShaderSource() const {
+  return this->shaderSource;
+}
+
 const int Shader::getShaderSourceLength() const {
   int length;
   glGetShaderiv(this->shaderHandle, GL_SHADER_SOURCE_LENGTH, &length);
@@ -107,21 +119,34 @@ const unsigned int Shader::getHandle() const {
 }
 
 Shader *Shader::LoadFromSourceFile(const ShaderType &type1, const std::string &path) {
-  std::ifstream file;
-  file.open(path);
-
-  if (!file.is_open()) {
+  std::string source;
+  if (!ReadSourceFile(path, source)) {
     fprintf(stderr, "Error: could not read file '%s'\n", path.c_str());
     return nullptr;
   }
 
-  std::stringstream source;
-  source << file.rdbuf();
-
   auto *shader = new Shader(type1);
-  shader->setShaderSource(source.str());
+  shader->setShaderSource(source);
 
   return shader;
 }
 
+bool Shader::ReadSourceFile(const std::string &path, std::string &source) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file.seekg(0, std::ios::end);
+  std::streamoff size = file.tellg();
+  file.seekg(0, std::ios::beg);
+
+  source.resize(size > 0 ? static_cast<size_t>(size) : 0);
+  if (!source.empty()) {
+    file.read(&source[0], size);
+  }
+
+  return true;
+}
+
 }
\ No newline at end of file
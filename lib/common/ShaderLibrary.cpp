@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "cg/LoaderThread.h"
+#include "cg/common/ShaderLibrary.h"
+
+namespace cg {
+
+ShaderLibrary::ShaderLibrary(ProgramBinaryCache *cache, LoaderThread *loader)
+    : cache(cache), loader(loader), alive(std::make_shared<bool>(true)) {}
+
+ShaderLibrary::~ShaderLibrary() {
+  *this->alive = false;
+}
+
+ShaderProgram *ShaderLibrary::load(const std::string &name,
+                                   const std::vector<ShaderStageFile> &stages,
+                                   const std::vector<std::string> &defines) {
+  // The caller gets the program right away, so the first build cannot wait for the loader thread
+  Entry &entry = this->programs[name];
+  entry.stages = stages;
+  entry.defines = defines;
+  build(name, entry, false);
+  return entry.program.get();
+}
+
+ShaderProgram *ShaderLibrary::get(const std::string &name) {
+  auto entry = this->programs.find(name);
+  return entry == this->programs.end() ? nullptr : entry->second.program.get();
+}
+
+bool ShaderLibrary::reload(const std::string &name) {
+  this->lastReloads.clear();
+
+  auto entry = this->programs.find(name);
+  if (entry == this->programs.end()) {
+    return false;
+  }
+
+  return build(name, entry->second, false);
+}
+
+size_t ShaderLibrary::update() {
+  // Rebuilds the loader thread swapped in since the last call are reported now, along with the ones done right here
+  this->lastReloads.clear();
+  this->lastReloads.swap(this->publishedReloads);
+
+  std::vector<std::string> changes = this->watcher.pollChanges();
+
+  // Collect the affected programs first, so a program depending on several changed files is only rebuilt once
+  std::set<std::string> affected;
+  for (const std::string &file : changes) {
+    auto dependents = this->dependents.find(file);
+    if (dependents != this->dependents.end()) {
+      affected.insert(dependents->second.begin(), dependents->second.end());
+    }
+  }
+
+  for (const std::string &name : affected) {
+    build(name, this->programs[name], true);
+  }
+
+  size_t reloaded = 0;
+  for (const ReloadReport &report : this->lastReloads) {
+    if (report.success) {
+      reloaded++;
+    }
+  }
+  return reloaded;
+}
+
+const std::vector<ShaderLibrary::ReloadReport> &ShaderLibrary::getLastReloads() const {
+  return this->lastReloads;
+}
+
+ShaderPreprocessor &ShaderLibrary::getPreprocessor() {
+  return this->preprocessor;
+}
+
+bool ShaderLibrary::build(const std::string &name, Entry &entry, bool async) {
+  auto start = std::chrono::steady_clock::now();
+  unsigned int generation = ++entry.generation;
+
+  std::vector<ShaderStageSource> sources;
+  std::set<std::string> dependencies;
+  bool read = true;
+  for (const ShaderStageFile &stage : entry.stages) {
+    PreprocessedShader result;
+    if (!this->preprocessor.process(stage.path, entry.defines, result)) {
+      read = false;
+    }
+
+    // A failed include still leaves the files read so far in the result, keep watching those
+    dependencies.insert(FileWatcher::CanonicalPath(stage.path));
+    dependencies.insert(result.files.begin(), result.files.end());
+    sources.push_back({stage.type, std::move(result.source)});
+  }
+
+  // Keep watching the files even if this build failed, so fixing the error triggers another reload
+  track(name, entry, dependencies);
+
+  if (!read) {
+    return finish(name, entry, nullptr, start, this->lastReloads);
+  }
+
+  std::string defines = ShaderPreprocessor::BuildDefineBlock(entry.defines);
+  if (async && this->loader && this->loader->isRunning()) {
+    // Looked up again once published, the program may have been rebuilt meanwhile
+    std::shared_ptr<bool> alive = this->alive;
+    this->loader->loadProgram(sources, [this, alive, name, generation, start](std::unique_ptr<ShaderProgram> program) {
+      if (!*alive) {
+        return;
+      }
+      auto entry = this->programs.find(name);
+      if (entry != this->programs.end() && entry->second.generation == generation) {
+        finish(name, entry->second, std::move(program), start, this->publishedReloads);
+      }
+    }, this->cache, defines);
+    return true;
+  }
+
+  std::unique_ptr<ShaderProgram> program(this->cache ? this->cache->createProgram(sources, defines)
+                                                     : ShaderProgram::FromSources(sources));
+  return finish(name, entry, std::move(program), start, this->lastReloads);
+}
+
+bool ShaderLibrary::finish(const std::string &name, Entry &entry, std::unique_ptr<ShaderProgram> program,
+                           std::chrono::steady_clock::time_point start, std::vector<ReloadReport> &reports) {
+  bool success = program != nullptr;
+  if (success) {
+    if (entry.program) {
+      // Swap in place so every pointer handed out by load() or get() now refers to the new program
+      entry.program->swap(*program);
+    } else {
+      entry.program = std::move(program);
+      entry.program->setAssetName(name);
+    }
+  }
+
+  double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  reports.push_back({name, milliseconds, success});
+  if (!success) {
+    fprintf(stderr, "Error: could not build program '%s', keeping the previous version\n", name.c_str());
+  }
+#ifdef CG_GL_DEBUG
+  else {
+    std::cout << "<ShaderLibrary>: Built program '" << name << "' in " << milliseconds << " ms\n";
+  }
+#endif
+
+  return success;
+}
+
+void ShaderLibrary::track(const std::string &name, Entry &entry, const std::set<std::string> &dependencies) {
+  for (const std::string &file : entry.dependencies) {
+    this->dependents[file].erase(name);
+  }
+
+  entry.dependencies.clear();
+  for (const std::string &file : dependencies) {
+    entry.dependencies.insert(this->watcher.watch(file));
+  }
+
+  for (const std::string &file : entry.dependencies) {
+    this->dependents[file].insert(name);
+  }
+}
+
+}
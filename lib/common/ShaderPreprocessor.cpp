@@ -0,0 +1,257 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include "cg/common/FileWatcher.h"
+#include "cg/common/Shader.h"
+#include "cg/common/ShaderPreprocessor.h"
+
+namespace cg {
+
+namespace {
+
+bool startsWithDirective(const std::string &line, size_t start, const char *directive) {
+  size_t length = strlen(directive);
+  return line.compare(start, length, directive) == 0
+      && (line.size() == start + length || isspace(static_cast<unsigned char>(line[start + length])));
+}
+
+/// \return true if nothing but whitespace or a line comment follows position
+bool isRestBlank(const std::string &line, size_t position) {
+  size_t next = line.find_first_not_of(" \t\r", position);
+  return next == std::string::npos || line.compare(next, 2, "//") == 0;
+}
+
+/// \return true if the pragma at start is exactly "#pragma once"
+bool isPragmaOnce(const std::string &line, size_t start) {
+  size_t token = line.find_first_not_of(" \t", start + 6);
+  return token != std::string::npos && startsWithDirective(line, token, "once") && isRestBlank(line, token + 4);
+}
+
+/// Parses the name of an include, "name" or <name> with nothing after it.
+/// \return false if the include is malformed
+bool parseInclude(const std::string &line, size_t start, std::string &name) {
+  size_t open = line.find_first_not_of(" \t", start + 7);
+  if (open == std::string::npos || (line[open] != '"' && line[open] != '<')) {
+    return false;
+  }
+
+  size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+  if (close == std::string::npos || close == open + 1 || !isRestBlank(line, close + 1)) {
+    return false;
+  }
+  name = line.substr(open + 1, close - open - 1);
+  return true;
+}
+
+std::string directoryOf(const std::string &path) {
+  std::string::size_type separator = path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string(".") : path.substr(0, separator);
+}
+
+std::string lineDirective(size_t line, size_t fileIndex) {
+  return "#line " + std::to_string(line) + " " + std::to_string(fileIndex) + "\n";
+}
+
+}
+
+void ShaderPreprocessor::addIncludeDirectory(const std::string &directory) {
+  this->includeDirectories.push_back(directory);
+}
+
+bool ShaderPreprocessor::process(const std::string &path,
+                                 const std::vector<std::string> &defines,
+                                 PreprocessedShader &result) const {
+  std::string source;
+  if (!Shader::ReadSourceFile(path, source)) {
+    fprintf(stderr, "Error: could not read file '%s'\n", path.c_str());
+    return false;
+  }
+
+  return processSource(source, path, defines, result);
+}
+
+bool ShaderPreprocessor::processSource(const std::string &source,
+                                       const std::string &path,
+                                       const std::vector<std::string> &defines,
+                                       PreprocessedShader &result) const {
+  result.source.clear();
+  result.source.reserve(source.size());
+  std::string root = FileWatcher::CanonicalPath(path);
+  result.files.assign(1, root);
+
+  std::string defineBlock = BuildDefineBlock(defines);
+  bool definesInjected = defineBlock.empty();
+  std::set<std::string> onceFiles;
+  std::vector<std::string> includeStack(1, root);
+
+  if (!expand(source, root, 0, defineBlock, definesInjected, result, onceFiles, includeStack)) {
+    return false;
+  }
+
+  // Without a '#version' line the defines simply go first
+  if (!definesInjected) {
+    result.source = defineBlock + lineDirective(1, 0) + result.source;
+  }
+
+  return true;
+}
+
+std::string ShaderPreprocessor::BuildDefineBlock(const std::vector<std::string> &defines) {
+  std::string block;
+  for (std::string define : defines) {
+    // Only the first '=' separates name and value, the value itself may contain more (e.g. "CMP(a,b)=(a)==(b)")
+    size_t separator = define.find('=');
+    if (separator != std::string::npos) {
+      define[separator] = ' ';
+    }
+    block += "#define " + define + "\n";
+  }
+  return block;
+}
+
+bool ShaderPreprocessor::expand(const std::string &source,
+                                const std::string &path,
+                                size_t fileIndex,
+                                const std::string &defineBlock,
+                                bool &definesInjected,
+                                PreprocessedShader &result,
+                                std::set<std::string> &onceFiles,
+                                std::vector<std::string> &includeStack) const {
+  size_t lineNumber = 0;
+  size_t position = 0;
+  while (position < source.size()) {
+    size_t end = source.find('\n', position);
+    if (end == std::string::npos) {
+      end = source.size();
+    }
+
+    std::string line = source.substr(position, end - position);
+    position = end + 1;
+    lineNumber++;
+
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] != '#') {
+      result.source += line;
+      result.source += '\n';
+      continue;
+    }
+
+    start = line.find_first_not_of(" \t", start + 1);
+    if (start == std::string::npos) {
+      result.source += line;
+      result.source += '\n';
+      continue;
+    }
+
+    if (startsWithDirective(line, start, "version") && fileIndex == 0 && !definesInjected) {
+      result.source += line;
+      result.source += '\n';
+      result.source += defineBlock;
+      result.source += lineDirective(lineNumber + 1, fileIndex);
+      definesInjected = true;
+    } else if (startsWithDirective(line, start, "pragma") && isPragmaOnce(line, start)) {
+      onceFiles.insert(path);
+      result.source += '\n';
+    } else if (startsWithDirective(line, start, "include")) {
+      std::string name;
+      if (!parseInclude(line, start, name)) {
+        fprintf(stderr, "Error: malformed include in '%s' line %zu: %s\n", path.c_str(), lineNumber, line.c_str());
+        return false;
+      }
+
+      std::string resolved;
+      if (!resolve(name, path, resolved)) {
+        fprintf(stderr, "Error: could not resolve include '%s' in '%s' line %zu\n", name.c_str(), path.c_str(),
+                lineNumber);
+        return false;
+      }
+
+      if (onceFiles.count(resolved)) {
+        result.source += '\n';
+        continue;
+      }
+
+      if (std::find(includeStack.begin(), includeStack.end(), resolved) != includeStack.end()) {
+        fprintf(stderr, "Error: recursive include of '%s' in '%s' line %zu\n", resolved.c_str(), path.c_str(),
+                lineNumber);
+        return false;
+      }
+
+      std::string included;
+      if (!Shader::ReadSourceFile(resolved, included)) {
+        fprintf(stderr, "Error: could not read file '%s'\n", resolved.c_str());
+        return false;
+      }
+
+      size_t includedIndex = result.files.size();
+      result.files.push_back(resolved);
+      result.source += lineDirective(1, includedIndex);
+
+      includeStack.push_back(resolved);
+      if (!expand(included, resolved, includedIndex, defineBlock, definesInjected, result, onceFiles,
+                  includeStack)) {
+        return false;
+      }
+      includeStack.pop_back();
+
+      result.source += lineDirective(lineNumber + 1, fileIndex);
+    } else {
+      result.source += line;
+      result.source += '\n';
+    }
+  }
+
+  return true;
+}
+
+bool ShaderPreprocessor::resolve(const std::string &name, const std::string &includer, std::string &resolved) const {
+  std::vector<std::string> candidates;
+  if (!name.empty() && (name[0] == '/' || name.find(':') != std::string::npos)) {
+    candidates.push_back(name);
+  } else {
+    candidates.push_back(directoryOf(includer) + "/" + name);
+    for (const std::string &directory : this->includeDirectories) {
+      candidates.push_back(directory + "/" + name);
+    }
+  }
+
+  for (const std::string &candidate : candidates) {
+    FILE *file = fopen(candidate.c_str(), "rb");
+    if (file) {
+      fclose(file);
+      resolved = FileWatcher::CanonicalPath(candidate);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}
@@ -0,0 +1,215 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glad/glad.h>
+#include <algorithm>
+
+#include "cg/JobSystem.h"
+#include "cg/common/ShaderVariantCache.h"
+
+namespace cg {
+
+namespace {
+
+struct PreprocessedVariant {
+  uint64_t mask;
+  bool success;
+  std::vector<ShaderStageSource> sources;
+  std::vector<std::string> files;
+};
+
+struct PendingVariant {
+  uint64_t mask;
+  std::string key;
+  std::vector<std::unique_ptr<Shader>> shaders;
+  std::unique_ptr<ShaderProgram> program;
+};
+
+}
+
+ShaderVariantCache::ShaderVariantCache(const std::vector<ShaderStageFile> &stages,
+                                       const std::vector<std::string> &features,
+                                       const ShaderPreprocessor &preprocessor,
+                                       ProgramBinaryCache *cache,
+                                       bool separable)
+    : stages(stages), features(features), preprocessor(preprocessor), cache(cache), separable(separable) {
+  if (this->features.size() > 64) {
+    fprintf(stderr, "Error: a variant cache supports at most 64 features, ignoring the rest\n");
+    this->features.resize(64);
+  }
+}
+
+ShaderProgram *ShaderVariantCache::get(uint64_t mask) {
+  auto variant = this->variants.find(mask);
+  if (variant != this->variants.end()) {
+    return variant->second.get();
+  }
+
+  prewarm(std::vector<uint64_t>(1, mask));
+  return this->variants[mask].get();
+}
+
+void ShaderVariantCache::prewarm(const std::vector<uint64_t> &masks) {
+  std::vector<PreprocessedVariant> preprocessed;
+  for (uint64_t mask : masks) {
+    bool pending = std::any_of(preprocessed.begin(), preprocessed.end(),
+                               [mask](const PreprocessedVariant &variant) { return variant.mask == mask; });
+    if (!contains(mask) && !pending) {
+      preprocessed.push_back({mask, false, {}, {}});
+    }
+  }
+
+  if (preprocessed.empty()) {
+    return;
+  }
+
+  // Preprocessing is plain file and string work, spread it over the job workers
+  JobSystem::Get().parallelFor(preprocessed.size(), 1, [this, &preprocessed](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      PreprocessedVariant &variant = preprocessed[i];
+      variant.success = preprocess(variant.mask, variant.sources, variant.files);
+    }
+  });
+
+  if (GLAD_GL_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+  }
+
+  // Issue every compile before asking for any result, so the driver can work on them concurrently
+  bool retrievable = this->cache && this->cache->isSupported();
+  std::vector<PendingVariant> pending;
+  for (PreprocessedVariant &variant : preprocessed) {
+    if (!variant.success) {
+      this->variants[variant.mask] = nullptr;
+      continue;
+    }
+
+    this->dependencies.insert(variant.files.begin(), variant.files.end());
+
+    PendingVariant build;
+    build.mask = variant.mask;
+    build.program.reset(new ShaderProgram());
+    if (this->cache) {
+      build.key = this->cache->computeKey(variant.sources,
+                                          ShaderPreprocessor::BuildDefineBlock(getDefines(variant.mask)),
+                                          this->separable);
+      if (this->cache->loadProgram(build.program.get(), build.key)) {
+        this->variants[variant.mask] = std::move(build.program);
+        continue;
+      }
+    }
+
+    for (const ShaderStageSource &source : variant.sources) {
+      std::unique_ptr<Shader> shader(new Shader(source.type));
+      shader->setShaderSource(source.source);
+      shader->beginCompile();
+      build.shaders.push_back(std::move(shader));
+    }
+    pending.push_back(std::move(build));
+  }
+
+  for (PendingVariant &build : pending) {
+    bool compiled = true;
+    for (const std::unique_ptr<Shader> &shader : build.shaders) {
+      compiled = shader->compileShader() && compiled;
+    }
+
+    if (!compiled) {
+      build.program.reset();
+      continue;
+    }
+
+    for (const std::unique_ptr<Shader> &shader : build.shaders) {
+      build.program->attachShader(shader.get());
+    }
+    build.program->setBinaryRetrievable(retrievable);
+    build.program->setSeparable(this->separable);
+    build.program->beginLink();
+  }
+
+  for (PendingVariant &build : pending) {
+    if (build.program) {
+      bool linked = build.program->linkProgram();
+      for (const std::unique_ptr<Shader> &shader : build.shaders) {
+        build.program->detachShader(shader.get());
+      }
+
+      if (!linked) {
+        build.program.reset();
+      } else if (this->cache) {
+        this->cache->storeProgram(build.program.get(), build.key);
+      }
+    }
+
+    if (!build.program) {
+      fprintf(stderr, "Error: could not build shader variant 0x%llx\n", static_cast<unsigned long long>(build.mask));
+    }
+    this->variants[build.mask] = std::move(build.program);
+  }
+}
+
+bool ShaderVariantCache::contains(uint64_t mask) const {
+  return this->variants.count(mask) != 0;
+}
+
+void ShaderVariantCache::clear() {
+  this->variants.clear();
+  this->dependencies.clear();
+}
+
+size_t ShaderVariantCache::size() const {
+  return this->variants.size();
+}
+
+std::vector<std::string> ShaderVariantCache::getDefines(uint64_t mask) const {
+  std::vector<std::string> defines;
+  for (size_t i = 0; i < this->features.size(); ++i) {
+    if (mask & (1ull << i)) {
+      defines.push_back(this->features[i]);
+    }
+  }
+  return defines;
+}
+
+const std::set<std::string> &ShaderVariantCache::getDependencies() const {
+  return this->dependencies;
+}
+
+bool ShaderVariantCache::preprocess(uint64_t mask,
+                                    std::vector<ShaderStageSource> &sources,
+                                    std::vector<std::string> &files) const {
+  std::vector<std::string> defines = getDefines(mask);
+  for (const ShaderStageFile &stage : this->stages) {
+    PreprocessedShader result;
+    if (!this->preprocessor.process(stage.path, defines, result)) {
+      return false;
+    }
+
+    sources.push_back({stage.type, std::move(result.source)});
+    files.insert(files.end(), result.files.begin(), result.files.end());
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,149 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Yoram
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "cg/common/Texture.h"
+
+namespace cg {
+
+namespace {
+
+size_t GetBytesPerPixel(GLenum internalFormat) {
+  switch (internalFormat) {
+    case GL_R8:return 1;
+    case GL_RG8:return 2;
+    case GL_RGBA16F:return 8;
+    case GL_RGBA32F:return 16;
+    default:return 4;
+  }
+}
+
+}
+
+Texture2D::Texture2D(int width, int height, int levels, GLenum internalFormat)
+    : width(width), height(height), levels(levels), internalFormat(internalFormat) {
+  glCreateTextures(GL_TEXTURE_2D, 1, &this->handle);
+  verify();
+#ifdef CG_GL_DEBUG
+  std::cout << "<Texture2D>: Created texture with id " << this->handle << "\n";
+#endif
+  glTextureStorage2D(this->handle, levels, internalFormat, width, height);
+  glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  trackStorageSize();
+}
+
+Texture2D::~Texture2D() {
+  glDeleteTextures(1, &this->handle);
+}
+
+void Texture2D::upload(int level, int x, int y, int width, int height, const void *pixels) {
+  glTextureSubImage2D(this->handle, level, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+void Texture2D::setLevelRange(int base, int max) {
+  glTextureParameteri(this->handle, GL_TEXTURE_BASE_LEVEL, base);
+  glTextureParameteri(this->handle, GL_TEXTURE_MAX_LEVEL, max);
+}
+
+void Texture2D::setFilter(GLenum minFilter, GLenum magFilter) {
+  glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, minFilter);
+  glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, magFilter);
+}
+
+void Texture2D::setWrap(GLenum wrap) {
+  glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, wrap);
+  glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, wrap);
+}
+
+void Texture2D::setUnit(unsigned int unit) {
+  this->unit = unit;
+}
+
+void Texture2D::bind() {
+  glBindTextureUnit(this->unit, this->handle);
+}
+
+void Texture2D::unbind() {
+  glBindTextureUnit(this->unit, 0);
+}
+
+int Texture2D::getWidth() const {
+  return this->width;
+}
+
+int Texture2D::getHeight() const {
+  return this->height;
+}
+
+int Texture2D::getLevelCount() const {
+  return this->levels;
+}
+
+GLenum Texture2D::getInternalFormat() const {
+  return this->internalFormat;
+}
+
+void Texture2D::swap(Texture2D &other) {
+  std::swap(this->handle, other.handle);
+  std::swap(this->width, other.width);
+  std::swap(this->height, other.height);
+  std::swap(this->levels, other.levels);
+  std::swap(this->internalFormat, other.internalFormat);
+
+  // The names and units stay with the objects, only the sizes follow the textures
+  trackStorageSize();
+  other.trackStorageSize();
+}
+
+void Texture2D::setAssetName(const std::string &name) {
+  this->memory.rename(name);
+}
+
+int Texture2D::GetLevelCount(int width, int height) {
+  int levels = 1;
+  int size = std::max(width, height);
+  while (size > 1) {
+    size /= 2;
+    levels++;
+  }
+  return levels;
+}
+
+size_t Texture2D::GetStorageSize(int width, int height, int levels, GLenum internalFormat) {
+  size_t pixels = 0;
+  for (int level = 0; level < levels; ++level) {
+    pixels += static_cast<size_t>(std::max(width >> level, 1)) * static_cast<size_t>(std::max(height >> level, 1));
+  }
+  return pixels * GetBytesPerPixel(internalFormat);
+}
+
+void Texture2D::trackStorageSize() {
+  this->memory.resize(0, GetStorageSize(this->width, this->height, this->levels, this->internalFormat));
+}
+
+}
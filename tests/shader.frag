@@ -0,0 +1,15 @@
+#version 450 core
+// Written by the demo from MaterialTable::getGlslDeclarations(), it may enable an extension so it comes first
+#include "materials.glsl"
+
+in vec3 worldNormal;
+in vec2 textureCoordinates;
+
+out vec4 fragColor;
+
+void main() {
+  Material material = materials[E_MATERIAL];
+  vec4 color = material.baseColor * SampleBaseColor(material, textureCoordinates);
+  float light = max(dot(normalize(worldNormal), normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+  fragColor = vec4(color.rgb * (0.2 + 0.8 * light), color.a);
+}
@@ -0,0 +1,18 @@
+#version 450 core
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+uniform mat4 E_MODEL;
+uniform mat4 E_VIEW;
+uniform mat4 E_PROJ;
+
+out vec3 worldNormal;
+out vec2 textureCoordinates;
+
+void main() {
+  worldNormal = mat3(E_MODEL) * normal;
+  textureCoordinates = uv;
+  gl_Position = E_PROJ * E_VIEW * E_MODEL * vec4(position, 1.0);
+}
@@ -26,12 +26,26 @@
 #define CG_GL_VERIFY
 
 #include <cg/Application.h>
+#include <cg/Camera.h>
 #include <cg/GUIComponent.h>
+#include <cg/HeapStatistics.h>
+#include <cg/JobSystem.h>
+#include <cg/MaterialTable.h>
+#include <cg/MemoryTracker.h>
 #include <cg/Mesh.h>
+#include <cg/MeshUploader.h>
+#include <cg/Profiler.h>
+#include <cg/ResourceManager.h>
+#include <cg/TransformHierarchy.h>
+#include <cg/TripleBuffer.h>
 #include <cg/common/Shader.h>
 #include <cg/common/Program.h>
+#include <cg/common/ProgramCache.h>
+#include <cg/common/ShaderLibrary.h>
 #include <cg/common/VertexArray.h>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <filesystem>
 #include <cg/Vertex.h>
 #include <glm/glm.hpp>
@@ -53,303 +67,30 @@ void APIENTRY message(GLenum source, GLenum tyoe, GLuint id,
   std::cout << "OpenGL: " << message << "\n";
 }
 
-class Camera {
- private:
-
- public:
-  glm::vec3 position;
-  float rot[3] = {-20.0f, -0.0f, 0.0f};
-  glm::vec3 scale;
-
-  glm::vec3 up;
-  glm::vec3 forward;
-  glm::vec3 right;
-
-  Camera(float fov, float n, float f) : fov(fov), nearPlane(n), farPlane(f) {
-    this->up = glm::vec3(0.0f, 1.0f, 0.0f);
-    this->forward = glm::vec3(0.0f, 0.0f, -1.0f);
-    this->right = glm::vec3(1.0f, 0.0f, 0.0f);
-    this->position = glm::vec3(0.0f, 9.0f, 15.0f);
-    this->projection = glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
-  }
-
-  void showDebugWindow() {
-    ImGui::Begin("Camera");
-    ImGui::SliderFloat("Field of View", &fov, 1.0f, 180.0f);
-    ImGui::SliderFloat("Near Clipping Plane", &nearPlane, 0.01f, 10.0f);
-    ImGui::SliderFloat("Far Clipping Plane", &farPlane, 0.0001f, 10000.0f);
-    ImGui::SliderFloat3("Position", glm::value_ptr(position), -5.0f, 5.0f);
-    ImGui::SliderFloat3("Rotation", rot, -45.0f, 45.0f);
-    if (ImGui::Button("Reset Transform")) {
-      rot[0] = 0.0f;
-      rot[1] = -20.0f;
-      rot[2] = 0.0f;
-      position.x = 0.0f;
-      position.y = 1.0f;
-      position.z = 3.0f;
-    }
-    ImGui::End();
-
-    this->projection = glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
-  }
-
-  glm::mat4 *getProjectionMatrix() {
-    return &this->projection;
-  }
-
-  glm::mat4 getViewMatrix() {
-    glm::quat rotX = glm::inverse(glm::angleAxis(glm::radians(rot[0]), glm::vec3(1.0f, 0.0f, 0.0f)));
-    glm::quat rotY = glm::angleAxis(glm::radians(rot[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::quat rotZ = glm::angleAxis(glm::radians(rot[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    glm::quat rotateDirection = rotX*rotY*rotZ;
-    rotateDirection = glm::normalize(rotateDirection);
-
-    glm::mat4 rotation = glm::mat4_cast(rotateDirection);
-    glm::mat4 translation = glm::inverse(glm::translate(position));
-
-    return rotation*translation;
-  }
-
- private:
-  glm::mat4 projection;
-
-  float aspect = 1280.0f/720.0f;
-  float fov;
-  float nearPlane;
-  float farPlane;
-};
-
-class Transform {
- protected:
-  glm::vec3 position;
-  glm::quat rotation;
-  glm::vec3 scale;
-
-  glm::vec3 forward;
-  glm::vec3 up;
-  glm::vec3 right;
-  glm::vec3 angles;
-
-  glm::mat4x4 transformation;
-
-  virtual void UpdateMatrix() {
-    transformation = glm::translate(position)*glm::mat4_cast(rotation)*glm::scale(scale);
-  }
-
-  static const glm::vec3 zero() {
-    return glm::vec3(0.0f, 0.0f, 0.0f);
-  }
-
-  static const glm::vec3 one() {
-    return glm::vec3(1.0f, 1.0f, 1.0f);
-  }
-
- public:
-  Transform() {
-    position = Transform::zero();
-    rotation = glm::quat(Transform::zero());
-    scale = Transform::one();
-
-    forward = glm::vec3(0.0f, 0.0f, 1.0f);
-    up = glm::vec3(0.0f, 1.0f, 0.0f);
-    right = glm::cross(glm::normalize(up), glm::normalize(forward));
-
-    angles = Transform::zero();
-    UpdateMatrix();
-    UpdateCoordinateVectors();
-  }
-
-  void UpdateCoordinateVectors() {
-    forward = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f)*rotation);
-    up = glm::normalize(glm::vec3(0.0f, 1.0f, 0.0f)*rotation);
-    right = glm::normalize(glm::vec3(1.0f, 0.0f, 0.0f)*rotation);
-  }
-
-  void setPosition(const glm::vec3 &pos) {
-    position = pos;
-    UpdateCoordinateVectors();
-    UpdateMatrix();
-  }
-
-  void setRotation(const glm::quat &rot) {
-    UpdateCoordinateVectors();
-    rotation = rot;
-
-    UpdateMatrix();
-  }
-
-  void setRotation(const glm::vec3 &angles) {
-    glm::quat r = glm::quat(glm::vec3(glm::radians(angles.x), glm::radians(angles.y), glm::radians(angles.z)));
-    forward = glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f)*r);
-    up = glm::normalize(glm::vec3(0.0f, 1.0f, 0.0f)*r);
-    right = glm::normalize(glm::vec3(2.0f, 0.0f, 0.0f)*r);
-
-    auto x = glm::angleAxis(glm::radians(angles.x), right);
-    auto y = glm::angleAxis(glm::radians(angles.y), up);
-    auto z = glm::angleAxis(glm::radians(angles.z), forward);
-
-    rotation = glm::normalize(z*x*y);
-
-    UpdateMatrix();
-  }
-
-  void setScale(const glm::vec3 &scl) {
-    scale = scl;
-    //UpdateCoordinateVectors();
-    UpdateMatrix();
-  }
-
-  glm::vec3 &getPosition() {
-    return position;
-  }
-
-  glm::quat &getRotation() {
-    return rotation;
-  }
-
-  glm::vec3 &getScale() {
-    return scale;
-  }
-
-  glm::vec3 &getUp() {
-    return up;
-  }
-
-  glm::vec3 &getForward() {
-    return forward;
-  }
-
-  glm::vec3 &getRight() {
-    return right;
-  }
-};
-
-class FreeCamera : public Transform {
- private:
-  glm::mat4 projection;
+/// What the render needs from the simulation, published once per update
+struct SceneState {
+  glm::mat4 model;
   glm::mat4 view;
-  glm::mat4 inverseView;
-  glm::mat4 viewProjection;
-
-  float fov = 0.0f;
-  float aspect = 1280.0f/720.0f;
-  float nearPlane;
-  float farPlane;
-
-  void UpdateMatrix() override {
-
-    view = glm::lookAt(getPosition(), getPosition() + forward, up);
-    inverseView = glm::inverse(view);
-    viewProjection = projection*view;
-  }
-
-  void UpdateProjection() {
-    projection = glm::perspective(glm::radians(this->fov), this->aspect, this->nearPlane, this->farPlane);
-  }
-
- public:
-  FreeCamera(float fov, float aspect, float nearPlane, float farPlane)
-      : fov(fov), aspect(aspect), nearPlane(nearPlane), farPlane(farPlane) {
-    projection = glm::perspective(glm::radians(this->fov), this->aspect, this->nearPlane, this->farPlane);
-  }
-
-  void setFov(float degrees) {
-    fov = glm::radians(degrees);
-  }
-
-  void setAspectRatio(float ratio) {
-    aspect = ratio;
-  }
-
-  void setAspectRatio(float width, float height) {
-    aspect = width/height;
-  }
-
-  void setNearPlane(float nearPlane) {
-    this->nearPlane = nearPlane;
-  }
-
-  void setFarPlane(float farPlane) {
-    this->farPlane = farPlane;
-  }
-
-  float getFov() { return fov; }
-  float getAspectRatio() { return aspect; }
-  float getNearPlane() { return this->nearPlane; }
-  float getFarPlane() { return this->farPlane; }
-
-  glm::mat4 getViewMatrix() {
-    return view;
-  }
-
-  glm::mat4 getInverseViewMatrix() {
-    return inverseView;
-  }
-
-  glm::mat4 getViewProjectionMatrix() {
-    return viewProjection;
-  }
-
-  glm::mat4 getProjectionMatrix() {
-    return projection;
-  }
-
-  glm::vec3 angles;
-
-  void MoveForward(float delta, float speed) {
-    position += forward*(speed*delta);
-  }
-
-  void MoveBackward(float delta, float speed) {
-    position -= forward*(speed*delta);
-  }
-
-  void MoveLeft(float delta, float speed) {
-    position += right*(speed*delta);
-  }
-
-  void MoveRight(float delta, float speed) {
-    position -= right*(speed*delta);
-  }
-
-  void showCameraControls() {
-    ImGui::Begin("Free Camera");
-    ImGui::Text("Camera Properties");
-    ImGui::Spacing();
-    ImGui::SliderFloat("Field of View", &fov, 0.1f, 100.0f);
-    ImGui::SliderFloat("Near plane", &nearPlane, 0.001f, 100000.0f);
-    ImGui::SliderFloat("Far plane", &farPlane, 0.001f, 100000.0f);
-    ImGui::Spacing();
-    ImGui::SliderFloat3("Position", glm::value_ptr(position), -100.0f, 100.0f);
-    if (ImGui::SliderFloat4("Rotation", glm::value_ptr(angles), -100.0f, 100.0f)) {
-      std::cout << "Rotating...\n";
-      this->setRotation(angles);
-    }
-
-    ImGui::Spacing();
-    ImGui::Separator();
-    ImGui::Spacing();
-
-    ImGui::Text("Aspect Ratio: %f", aspect);
-    ImGui::Text("Forward: %f, %f, %f", forward.x, forward.y, forward.z);
-    ImGui::End();
-
-    UpdateProjection();
-    UpdateMatrix();
-  }
+  glm::mat4 projection;
 };
 
 class Triangle : public cg::Application {
  private:
-  cg::Shader *vert;
-  cg::Shader *frag;
   cg::ShaderProgram *shader;
+  std::unique_ptr<cg::ProgramBinaryCache> programCache;
+  std::unique_ptr<cg::ShaderLibrary> shaders;
   cg::AsyncInfoImporter imp;
 
-  cg::Mesh *m;
-  Camera *c;
-  FreeCamera *free_camera_;
+  std::unique_ptr<cg::MeshUploader> uploader;
+  cg::ResidencyManager residency;
+  cg::ResourceManager resources;
+  std::unique_ptr<cg::MaterialTable> materials;
+  uint32_t material = 0;
+  cg::MeshHandle mesh;
+  cg::MeshHandle uploading;
+  std::string meshName;
+  std::string importKey;
+  cg::Camera camera;
 
   float fov = 45.0f;
   float cubeX = 0.0f;
@@ -358,7 +99,9 @@ class Triangle : public cg::Application {
 
   float speed = 0.2f;
 
-  glm::mat4 model;
+  cg::TransformHierarchy transforms;
+  uint32_t cube;
+  cg::TripleBuffer<SceneState> scene;
   bool showWireFrame = false;
   bool cull = true;
 
@@ -367,117 +110,156 @@ class Triangle : public cg::Application {
   float error = 0.0f;
 
  public:
-  Triangle() : cg::Application(4, 5, "Triangle", 1280, 720) {}
+  explicit Triangle(const cg::HeadlessSettings &headless = cg::HeadlessSettings())
+      : cg::Application(4, 5, "Triangle", 1280, 720, headless) {}
 
  protected:
   void onInit() override {
     Application::onInit();
+    resources.setResidencyManager(&residency);
+    uploader.reset(new cg::MeshUploader());
     currentPath = fs::current_path();
     glDebugMessageCallback(message, nullptr);
 
-    c = new Camera(60.0f, 0.1f, 1000.0f);
-    free_camera_ = new FreeCamera(60.0f, 1280.0f/720.0f, 0.1f, 10000.0f);
-    free_camera_->setRotation(glm::quat(45.0f, 0.0f, 0.0f, 0.0f));
-    free_camera_->setPosition(glm::vec3(0.0f, 5.0f, -20.0f));
-    imp.LoadAsync("dragon.obj");
+    camera = cg::Camera::InfinitePerspective(60.0f, 1280.0f/720.0f, 0.1f);
+    camera.setPosition(glm::vec3(0.0f, 5.0f, -20.0f));
+    camera.lookAt(glm::vec3(0.0f));
+    loadMeshFile("dragon.obj");
+
+    materials.reset(new cg::MaterialTable());
+    cg::Material orange;
+    orange.baseColor = glm::vec4(1.0f, 0.7f, 0.3f, 1.0f);
+    material = materials->add(orange);
+
+    // shader.frag includes the table declarations, which depend on whether bindless textures are supported
+    std::ofstream("materials.glsl") << materials->getGlslDeclarations();
+
+    programCache.reset(new cg::ProgramBinaryCache("shader_cache"));
+    shaders.reset(new cg::ShaderLibrary(programCache.get(), &getLoader()));
+    this->shader = shaders->load("default", {{cg::ShaderType::VertexShader, "shader.vert"},
+                                             {cg::ShaderType::FragmentShader, "shader.frag"}});
+    setMesh(resources.loadMesh("cube.obj", 0));
+
+    cube = transforms.create();
+    transforms.setPosition(cube, glm::vec3(cubeX, cubeY, cubeZ));
+    transforms.update(nullptr);
+    publishScene();
+    // Reversed Z for the infinite projection: depth 1 at the near plane falling towards 0, see cg::Camera
+    glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+    glClearDepth(0.0);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GREATER);
+  }
+
+  /// Shows a mesh file, reusing it if it is already loaded and importing it in the background if not.
+  void loadMeshFile(const std::string &path) {
+    std::string key = cg::ResourceManager::MakeKey(path, "import");
+    cg::MeshHandle loaded = resources.findMesh(key);
+    meshName = path;
+    if (loaded.isValid()) {
+      resources.acquire(loaded);
+      setMesh(loaded);
+      return;
+    }
 
-    recompileShader();
+    importKey = key;
+    imp.LoadAsync(path);
+  }
 
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(cubeX, cubeY, cubeZ));
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+  /// Takes over a reference to the mesh to draw and drops the one to the previous mesh.
+  void setMesh(cg::MeshHandle handle) {
+    resources.release(mesh);
+    mesh = handle;
   }
 
   void recompileShader() {
-    this->vert = cg::Shader::LoadFromSourceFile(cg::ShaderType::VertexShader, "shader.vert");
-    this->frag = cg::Shader::LoadFromSourceFile(cg::ShaderType::FragmentShader, "shader.frag");
-
-    m = cg::Mesh::LoadMesh("cube.obj", 0);
-
-    vert->compileShader();
-    frag->compileShader();
-
-    this->shader = new cg::ShaderProgram();
-    this->shader->attachShader(vert);
-    this->shader->attachShader(frag);
-    this->shader->linkProgram();
-
-    Transform t;
+    shaders->reload("default");
   }
 
   void onViewportResize(int width, int height) override {
     Application::onViewportResize(width, height);
+    camera.setAspectRatio(static_cast<float>(width), static_cast<float>(height));
     glViewport(0, 0, width, height);
   }
 
   float deltaTime = 0;
   float moveSpeed = 0.50;
+  glm::vec2 look = glm::vec2(0.0f);
 
-  void onKeyInput(int key, int scancode, KeyInputType action, int mods) override {
-    Application::onKeyInput(key, scancode, action, mods);
-
-    if (key==GLFW_KEY_W) {
-      free_camera_->MoveForward(deltaTime, moveSpeed);
-    } else if (key==GLFW_KEY_S) {
-      free_camera_->MoveBackward(deltaTime, moveSpeed);
-    } else if (key==GLFW_KEY_A) {
-      free_camera_->MoveLeft(deltaTime, moveSpeed);
-    } else if (key==GLFW_KEY_D) {
-      free_camera_->MoveRight(deltaTime, moveSpeed);
-    } else if (key==GLFW_KEY_Q) {
-      c->position.y -= moveSpeed*deltaTime;
-    } else if (key==GLFW_KEY_E) {
-      c->position.y += moveSpeed*deltaTime;
+  void onFrame(const cg::Input &input) override {
+    // Look around while the right mouse button is held, all cursor movement of the frame arrives as one delta. Frames
+    // without a simulation step keep it for the next one.
+    if (input.isMouseButtonDown(GLFW_MOUSE_BUTTON_RIGHT)) {
+      look += input.getMouseDelta();
     }
-
-
-
   }
 
-  bool mm = true;
-  float lx;
-  float ly;
-
-  void onMouseMove(double x, double y) override {
-    Application::onMouseMove(x, y);
-
-    if (mm) {
-      lx = x;
-      ly = y;
-      mm = false;
+  void onUpdate(float delta) override {
+    Application::onUpdate(delta);
+    deltaTime = delta;
+    transforms.setRotation(cube, transforms.getRotation(cube)*glm::angleAxis(speed*delta, glm::vec3(0, 1, 0)));
+
+    const cg::Input &input = getInput();
+    glm::vec3 move(0.0f);
+    if (input.isKeyDown(GLFW_KEY_W)) move.z += 1.0f;
+    if (input.isKeyDown(GLFW_KEY_S)) move.z -= 1.0f;
+    if (input.isKeyDown(GLFW_KEY_D)) move.x += 1.0f;
+    if (input.isKeyDown(GLFW_KEY_A)) move.x -= 1.0f;
+    if (input.isKeyDown(GLFW_KEY_E)) move.y += 1.0f;
+    if (input.isKeyDown(GLFW_KEY_Q)) move.y -= 1.0f;
+    if (move != glm::vec3(0.0f)) {
+      camera.moveLocal(move*(moveSpeed*delta));
     }
 
-    float ox = x - lx;
-    float oy = y = ly;
-    lx = x;
-    ly = y;
+    // The look collected since the last step is applied once, however many steps this frame runs
+    if (look.x != 0.0f || look.y != 0.0f) {
+      float sensitivity = 0.005f;
+      glm::quat yaw = glm::angleAxis(-look.x*sensitivity, glm::vec3(0.0f, 1.0f, 0.0f));
+      glm::quat pitch = glm::angleAxis(-look.y*sensitivity, glm::vec3(1.0f, 0.0f, 0.0f));
+      camera.setRotation(glm::normalize(yaw*camera.getRotation()*pitch));
+      look = glm::vec2(0.0f);
+    }
 
-    float s = 5.0f;
-    ox *= s;
-    oy *= s;
+    transforms.update(&cg::JobSystem::Get());
+    publishScene();
+  }
 
-    glm::quat rotX = glm::rotate(ox, free_camera_->getUp());
-    glm::quat rotY = glm::rotate(oy, free_camera_->getRight());
-    glm::quat rot = glm::normalize(rotX * rotY);
-    free_camera_->setRotation(rot + free_camera_->getRotation());
+  void publishScene() {
+    SceneState &state = scene.getWriteBuffer();
+    state.model = transforms.getWorldMatrix(cube);
+    state.view = camera.getViewMatrix();
+    state.projection = camera.getProjectionMatrix();
+    scene.publish();
   }
 
-  void onUpdate(float delta) override {
-    Application::onUpdate(delta);
-    deltaTime = delta;
+  void onRender(float alpha) override {
+    Application::onRender(alpha);
+    shaders->update();
+    // Nothing refers to the meshes released last frame anymore
+    resources.collect();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(1.0, 0.2, 0.3, 1.0);
 
-    if (imp.IsReady()) {
-      cg::MeshInfo info = imp.Get();
-      delete m;
-      m = new cg::Mesh(info.Vertices(), info.Indices());
+    // Upload imported meshes on the loader thread, or over the next frames without one, and keep showing the
+    // previous mesh until the new one is complete
+    cg::MeshInfo info;
+    if (imp.TryGet(info)) {
+      cg::Mesh *imported = getLoader().isRunning()
+          ? getLoader().uploadMesh(info.ReleaseVertices(), info.ReleaseIndices(), cg::MeshRetention::Keep)
+          : uploader->upload(info.ReleaseVertices(), info.ReleaseIndices(), cg::MeshRetention::Keep);
+      resources.release(uploading);
+      uploading = resources.addMesh(importKey, imported);
+      resources.get(uploading)->setAssetName(meshName);
+    }
+    uploader->update();
+    if (resources.get(uploading) && resources.get(uploading)->isDrawable()) {
+      setMesh(uploading);
+      uploading = cg::MeshHandle();
     }
 
-    model = glm::rotate(model, speed*delta, glm::vec3(0, 1, 0));
-    //glm::mat4 view = c->getViewMatrix();
-    glm::mat4 view = free_camera_->getViewMatrix();
-    glm::mat4 proj = free_camera_->getProjectionMatrix();
+    // Draw from the last published snapshot, the simulation may be writing the next one right now
+    scene.acquire();
+    const SceneState &state = scene.getReadBuffer();
 
     if (showWireFrame)
       glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -491,7 +273,14 @@ class Triangle : public cg::Application {
       glDisable(GL_CULL_FACE);
     }
 
-    if (m) m->draw(this->shader, model, view, proj);
+    materials->update();
+    materials->bind();
+    cg::Mesh *m = resources.get(mesh);
+    if (m) {
+      m->draw(this->shader, state.model, state.view, state.projection, material);
+      residency.markVisible(m);
+    }
+    residency.update();
   }
 
   std::vector<char> pathBuffer;
@@ -529,7 +318,7 @@ class Triangle : public cg::Application {
           } else if (ends_with(entry.path().filename().string(), ".obj")
               || ends_with(entry.path().filename().string(), ".fbx")) {
             //m = importer.Import(entry.path().string());
-            imp.LoadAsync(entry.path().string());
+            loadMeshFile(entry.path().string());
           }
         } else {
           if (ImGui::IsMouseClicked(1)) {
@@ -564,18 +353,61 @@ class Triangle : public cg::Application {
 
     ImGui::Text("File type: %s", fileType.c_str());
 
-    ImGui::ProgressBar(imp.GetProgress());
+    const cg::ImportStatus &status = imp.GetStatus();
+    ImGui::ProgressBar(status.GetProgress(), ImVec2(-1.0f, 0.0f), cg::GetImportStageName(status.GetStage()));
+    if (imp.IsBusy()) {
+      ImGui::Text("%s: %.1f of %.1f MB", cg::GetImportStageName(status.GetStage()),
+                  status.GetBytesProcessed() / (1024.0 * 1024.0), status.GetBytesTotal() / (1024.0 * 1024.0));
+      double eta = status.GetEtaSeconds();
+      if (eta >= 0.0) {
+        ImGui::Text("%.1f s elapsed, about %.1f s left", status.GetElapsedSeconds(), eta);
+      }
+      if (ImGui::Button("Cancel import")) {
+        imp.Cancel();
+      }
+    }
+    ImGui::Separator();
+
+  }
+
+  void showCameraControls() {
+    ImGui::Begin("Free Camera");
+    ImGui::Text("Camera Properties");
+    ImGui::Spacing();
+
+    // The camera only recomputes its matrices when one of these actually changes
+    float fov = camera.getFov();
+    if (ImGui::SliderFloat("Field of View", &fov, 1.0f, 120.0f)) {
+      camera.setFov(fov);
+    }
+    float nearPlane = camera.getNearPlane();
+    if (ImGui::SliderFloat("Near plane", &nearPlane, 0.001f, 10.0f)) {
+      camera.setNearPlane(nearPlane);
+    }
+    glm::vec3 position = camera.getPosition();
+    if (ImGui::SliderFloat3("Position", glm::value_ptr(position), -100.0f, 100.0f)) {
+      camera.setPosition(position);
+    }
+
+    ImGui::Spacing();
     ImGui::Separator();
+    ImGui::Spacing();
 
+    glm::vec3 forward = camera.getForward();
+    ImGui::Text("Aspect Ratio: %f", camera.getAspectRatio());
+    ImGui::Text("Forward: %f, %f, %f", forward.x, forward.y, forward.z);
+    ImGui::Text("Frustum planes: %d", camera.getFrustum().getPlaneCount());
+    ImGui::End();
   }
 
   bool showScene = false;
   bool showModels = false;
+  bool showProfiler = false;
+  bool showMemory = false;
 
   void onGui() override {
     Application::onGui();
-    //c->showDebugWindow();
-    free_camera_->showCameraControls();
+    showCameraControls();
 
     if (ImGui::BeginMainMenuBar()) {
       if (ImGui::BeginMenu("View")) {
@@ -586,11 +418,27 @@ class Triangle : public cg::Application {
         if (ImGui::MenuItem("Camera")) {
           showModels = true;
         }
+
+        if (ImGui::MenuItem("Profiler")) {
+          showProfiler = true;
+        }
+
+        if (ImGui::MenuItem("Memory")) {
+          showMemory = true;
+        }
         ImGui::EndMenu();
       }
       ImGui::EndMainMenuBar();
     }
 
+    if (showProfiler) {
+      cg::Profiler::Get().showWindow(&showProfiler);
+    }
+
+    if (showMemory) {
+      cg::MemoryTracker::Get().showWindow(&showMemory);
+    }
+
     if (showScene) {
       if (!ImGui::Begin("Scene", &showScene, ImGuiWindowFlags_NoCollapse)) {
         ImGui::End();
@@ -602,6 +450,37 @@ class Triangle : public cg::Application {
         if (ImGui::Button("Recompile Shaders")) {
           recompileShader();
         }
+
+        ImGui::Separator();
+        cg::FrameLoopSettings settings = getFrameLoopSettings();
+        const char *presentModes[] = {"VSync", "Adaptive VSync", "Uncapped", "Limited"};
+        int presentMode = static_cast<int>(settings.presentMode);
+        float targetFrameRate = static_cast<float>(settings.targetFrameRate);
+        bool changed = ImGui::Combo("Present Mode", &presentMode, presentModes, 4);
+        changed |= ImGui::SliderFloat("Target FPS", &targetFrameRate, 10.0f, 500.0f);
+        changed |= ImGui::Checkbox("Fixed Timestep", &settings.fixedTimestep);
+        changed |= ImGui::Checkbox("Threaded Simulation", &settings.threadedSimulation);
+        if (changed) {
+          settings.presentMode = static_cast<cg::PresentMode>(presentMode);
+          settings.targetFrameRate = targetFrameRate;
+          setFrameLoopSettings(settings);
+        }
+
+        const cg::FrameTimings &timings = getFrameTimings();
+        ImGui::Text("Frame %.2f ms (update %.2f, render %.2f, gui %.2f, swap %.2f, wait %.2f)", timings.total,
+                    timings.update, timings.render, timings.gui, timings.swap, timings.wait);
+        if (cg::HeapStatistics::IsTracking()) {
+          ImGui::Text("Heap allocations: %llu", static_cast<unsigned long long>(timings.allocations));
+        }
+        const cg::ResidencyStats &residencyStats = residency.getStats();
+        ImGui::Text("Meshes %zu resident (%.1f MB), %zu evicted, %zu streaming, %u evictions, %u stream-ins",
+                    residencyStats.meshes - residencyStats.evicted, residencyStats.residentBytes / (1024.0 * 1024.0),
+                    residencyStats.evicted, residencyStats.streaming, residencyStats.evictions,
+                    residencyStats.streamIns);
+        const cg::MeshUploadStats &uploadStats = uploader->getStats();
+        ImGui::Text("Uploads %zu pending (%.1f MB), %zu completing, %.1f MB this frame, %llu stalls",
+                    uploadStats.pending, uploadStats.pendingBytes / (1024.0 * 1024.0), uploadStats.completing,
+                    uploadStats.uploadedBytes / (1024.0 * 1024.0), static_cast<unsigned long long>(uploadStats.stalls));
         ImGui::End();
       }
     }
@@ -650,14 +529,26 @@ class Triangle : public cg::Application {
                              ImVec2(150, 75));
         ImGui::InputInt("Reduction", reinterpret_cast<int *>(&reduction));
         ImGui::InputFloat("Error", &error);
-        if (ImGui::Button("Optimize")) {
-          cg::MeshInfo info(m->vertices, m->indices);
+        cg::Mesh *m = resources.get(mesh);
+        if (m && ImGui::Button("Optimize")) {
+          // Simplify works on a copy, the mesh keeps its own data (MeshRetention::Keep)
+          cg::Span<const cg::Vertex> vertices = m->getVertices();
+          cg::Span<const unsigned int> indices = m->getIndices();
+          cg::MeshInfo info(std::vector<cg::Vertex>(vertices.begin(), vertices.end()),
+                            std::vector<unsigned int>(indices.begin(), indices.end()));
           std::cout << info.Simplify(reduction, error) << "\n";
-          delete m;
-          m = new cg::Mesh(info.Vertices(), info.Indices());
+
+          // The simplified mesh is no longer what the file contains, so it is not found by its key
+          cg::MeshHandle simplified =
+              resources.addMesh(std::string(), new cg::Mesh(info.ReleaseVertices(), info.ReleaseIndices()));
+          resources.get(simplified)->setAssetName(meshName);
+          setMesh(simplified);
+          m = resources.get(mesh);
+        }
+        if (m) {
+          ImGui::Text("Vertices: %zu", m->getVertexCount());
+          ImGui::Text("Indices: %zu", m->getIndexCount());
         }
-        ImGui::Text("Vertices: %i", m->vertices.size());
-        ImGui::Text("Indices: %i", m->indices.size());
         ImGui::EndTabItem();
       }
 
@@ -669,6 +560,15 @@ class Triangle : public cg::Application {
 };
 
 int main(int argc, char **argv) {
+  // triangle_shader --headless <frames> [dump directory]
+  cg::HeadlessSettings headless;
+  if (argc > 2 && std::string(argv[1]) == "--headless") {
+    headless.enabled = true;
+    headless.maxFrames = std::stoull(argv[2]);
+    if (argc > 3) {
+      headless.dumpDirectory = argv[3];
+    }
+  }
 
-  Triangle().run();
+  Triangle(headless).run();
 }